@@ -26,9 +26,22 @@
 #include "3dsystem/phd_math.h"
 #include "3dsystem/scalespr.h"
 #include "specific/hwr.h"
+#include "specific/init.h"
 #include "specific/room.h"
 #include "global/vars.h"
 
+#ifdef FEATURE_NOLEGACY_OPTIONS
+#include "modding/thread_utils.h"
+#endif // FEATURE_NOLEGACY_OPTIONS
+
+#ifdef FEATURE_VERTEX_SIMD
+#include "3dsystem/phd_simd.h"
+#endif // FEATURE_VERTEX_SIMD
+
+#ifdef FEATURE_RENDER_INTERPOLATION
+#include "game/interp.h"
+#endif // FEATURE_RENDER_INTERPOLATION
+
 PHD_VECTOR CamPos;
 
  // related to POLYTYPE enum
@@ -49,9 +62,17 @@ SORT_ITEM SortBuffer[16000];
 short Info3dBuffer[480000];
 #endif // defined(FEATURE_EXTENDED_LIMITS) || defined(FEATURE_VIEW_IMPROVED)
 
+#ifdef FEATURE_VIEW_IMPROVED
+static SORT_ITEM SortScratchBuffer[ARRAY_SIZE(SortBuffer)];
+DWORD PolySortMode = POLYSORT_Radix;
+#endif // FEATURE_VIEW_IMPROVED
+
 #ifdef FEATURE_EXTENDED_LIMITS
 PHD_SPRITE PhdSpriteInfo[2048];
 D3DTLVERTEX HWR_VertexBuffer[32768];
+// The default vertex buffer is used until a level needs a bigger one
+static __declspec(align(16)) PHD_VBUF PhdVBufDefault[1500];
+PHD_VBUF* PhdVBuf = PhdVBufDefault;
 #endif // FEATURE_EXTENDED_LIMITS
 
 int PhdFov;
@@ -100,12 +121,18 @@ int CalculateFogShade(int depth) {
 #include "modding/mod_utils.h"
 
 extern DWORD ReflectionMode;
-static POLYFILTER ReflectFilter;
+static POLYFILTER BuiltinReflectFilter;
+static POLYFILTER* ReflectFilter = NULL; // NULL reflects all polys
 static D3DCOLOR ReflectTint = 0;
 static bool IsReflect = false;
 
+static void SetBuiltinReflectFilter() {
+	memset(&BuiltinReflectFilter, 0, sizeof(BuiltinReflectFilter));
+	ReflectFilter = &BuiltinReflectFilter;
+}
+
 void ClearMeshReflectState() {
-	memset(&ReflectFilter, 0, sizeof(ReflectFilter));
+	ReflectFilter = NULL;
 	ReflectTint = RGBA_MAKE(0xFF, 0xFF, 0xFF, 0x80);
 	IsReflect = false;
 }
@@ -125,25 +152,9 @@ void SetMeshReflectState(int objID, int meshIdx) {
 #ifdef FEATURE_MOD_CONFIG
 	// Check if config is presented
 	if (Mod.reflect.isLoaded) {
-		POLYFILTER_NODE* node = NULL;
-		if (meshIdx < 0) {
-			for (node = Mod.reflect.statics; node != NULL; node = node->next) {
-				if (node->id == objID) {
-					ReflectFilter = node->filter;
-					IsReflect = true;
-					break;
-				}
-			}
-		}
-		else if (objID >= 0 && objID < ID_NUMBER_OBJECTS) {
-			POLYFILTER_NODE** obj = Mod.reflect.objects;
-			for (node = obj[objID]; node != NULL; node = node->next) {
-				if (node->id == meshIdx) {
-					ReflectFilter = node->filter;
-					IsReflect = true;
-					break;
-				}
-			}
+		if (meshIdx < 0 || (objID >= 0 && objID < ID_NUMBER_OBJECTS)) {
+			ReflectFilter = FindReflectFilter(objID, meshIdx);
+			IsReflect = (ReflectFilter != NULL);
 		}
 		return;
 	}
@@ -162,18 +173,19 @@ void SetMeshReflectState(int objID, int meshIdx) {
 		// Reflect the windshield only (skidoo body is mesh #0)
 		if (meshIdx == 0) {
 			// Set filter conditions
-			ReflectFilter.n_vtx = 59;
-			ReflectFilter.n_gt4 = 14;
-			ReflectFilter.n_gt3 = 73;
-			ReflectFilter.n_g4 = 0;
-			ReflectFilter.n_g3 = 17;
+			SetBuiltinReflectFilter();
+			ReflectFilter->n_vtx = 59;
+			ReflectFilter->n_gt4 = 14;
+			ReflectFilter->n_gt3 = 73;
+			ReflectFilter->n_g4 = 0;
+			ReflectFilter->n_g3 = 17;
 			// All colored triangles are reflective
 			// The only reflective textured triangle is 48
-			ReflectFilter.gt3[0].idx = 48;
-			ReflectFilter.gt3[0].num = 1;
+			ReflectFilter->gt3[0].idx = 48;
+			ReflectFilter->gt3[0].num = 1;
 			// Quads are not reflective
-			ReflectFilter.gt4[0].idx = ~0;
-			ReflectFilter.g4[0].idx = ~0;
+			ReflectFilter->gt4[0].idx = ~0;
+			ReflectFilter->g4[0].idx = ~0;
 			IsReflect = true;
 		}
 		break;
@@ -182,19 +194,20 @@ void SetMeshReflectState(int objID, int meshIdx) {
 		// Reflect the windshield only (skidoo body is mesh #0)
 		if (meshIdx == 0) {
 			// Set filter conditions
-			ReflectFilter.n_vtx = 88;
-			ReflectFilter.n_gt4 = 45;
-			ReflectFilter.n_gt3 = 60;
-			ReflectFilter.n_g4 = 0;
-			ReflectFilter.n_g3 = 0;
+			SetBuiltinReflectFilter();
+			ReflectFilter->n_vtx = 88;
+			ReflectFilter->n_gt4 = 45;
+			ReflectFilter->n_gt3 = 60;
+			ReflectFilter->n_g4 = 0;
+			ReflectFilter->n_g3 = 0;
 			// The reflective textured quads are 21..22, 34..47
-			ReflectFilter.gt4[0].idx = 21;
-			ReflectFilter.gt4[0].num = 2;
-			ReflectFilter.gt3[0].idx = 34;
-			ReflectFilter.gt3[0].num = 14;
+			ReflectFilter->gt4[0].idx = 21;
+			ReflectFilter->gt4[0].num = 2;
+			ReflectFilter->gt3[0].idx = 34;
+			ReflectFilter->gt3[0].num = 14;
 			// Other polys are not reflective
-			ReflectFilter.g4[0].idx = ~0;
-			ReflectFilter.g3[0].idx = ~0;
+			ReflectFilter->g4[0].idx = ~0;
+			ReflectFilter->g3[0].idx = ~0;
 			IsReflect = true;
 		}
 		break;
@@ -202,26 +215,28 @@ void SetMeshReflectState(int objID, int meshIdx) {
 		// Reflect the black glass mask of flamethrower buddy (his head is mesh #15)
 		if (meshIdx == 15) {
 			// Set filter conditions
-			ReflectFilter.n_vtx = 38;
-			ReflectFilter.n_gt4 = 30;
-			ReflectFilter.n_gt3 = 12;
-			ReflectFilter.n_g4 = 0;
-			ReflectFilter.n_g3 = 0;
+			SetBuiltinReflectFilter();
+			ReflectFilter->n_vtx = 38;
+			ReflectFilter->n_gt4 = 30;
+			ReflectFilter->n_gt3 = 12;
+			ReflectFilter->n_g4 = 0;
+			ReflectFilter->n_g3 = 0;
 			// The reflective textured quads are 22..26
-			ReflectFilter.gt4[0].idx = 22;
-			ReflectFilter.gt4[0].num = 5;
+			ReflectFilter->gt4[0].idx = 22;
+			ReflectFilter->gt4[0].num = 5;
 			// Other polys are not reflective
-			ReflectFilter.gt3[0].idx = ~0;
-			ReflectFilter.g4[0].idx = ~0;
-			ReflectFilter.g3[0].idx = ~0;
+			ReflectFilter->gt3[0].idx = ~0;
+			ReflectFilter->g4[0].idx = ~0;
+			ReflectFilter->g3[0].idx = ~0;
 			IsReflect = true;
 		}
 		break;
 	case ID_SPINNING_BLADE:
 		if (meshIdx == 0) {
 			// Reflect only quads, not triangles
-			ReflectFilter.gt3[0].idx = ~0;
-			ReflectFilter.g3[0].idx = ~0;
+			SetBuiltinReflectFilter();
+			ReflectFilter->gt3[0].idx = ~0;
+			ReflectFilter->g3[0].idx = ~0;
 			IsReflect = true;
 		}
 		break;
@@ -285,7 +300,7 @@ static void phd_PutEnvmapPolygons(short* ptrEnv) {
 		uv[i].v = PHD_ONE / PHD_IONE * (y + PHD_IONE) / 2;
 		ptrObj += 3;
 	}
-	EnumeratePolysObjects(ptrEnv, InsertEnvmap, &ReflectFilter, (LPVOID)uv);
+	EnumeratePolysObjects(ptrEnv, InsertEnvmap, ReflectFilter, (LPVOID)uv);
 	delete[] uv;
 }
 #endif // FEATURE_VIDEOFX_IMPROVED
@@ -331,6 +346,9 @@ void phd_LookAt(int xsrc, int ysrc, int zsrc, int xtar, int ytar, int ztar, shor
 	CamPos.x = xsrc;
 	CamPos.y = ysrc;
 	CamPos.z = zsrc;
+#ifdef FEATURE_RENDER_INTERPOLATION
+	INTERP_RecordView(xsrc, ysrc, zsrc, xtar, ytar, ztar, roll);
+#endif // FEATURE_RENDER_INTERPOLATION
 }
 
 void phd_GetVectorAngles(int x, int y, int z, VECTOR_ANGLES* angles) {
@@ -548,22 +566,201 @@ void S_InsertInvBgnd(short* ptrObj) {
 	// Main S_InsertInvBgnd() logic is similar to S_InsertBackground();
 }
 
-short* calc_object_vertices(short* ptrObj) {
-	float xv, yv, zv, persp, baseZ;
-	int vtxCount;
-	BYTE totalClip, clipFlags;
+#ifdef FEATURE_VERTEX_SIMD
+// The vertices are transformed by four at once with SSE2. Every step repeats
+// the scalar code: the int transform wraps the same way, and the float math
+// is done in the same order and precision, so the results are exactly the
+// same. The only difference is that the screen coordinates and RHW are also
+// written for the vertices behind the near plane, these are never used.
+// The water and wibble effects need table lookups for every vertex, so they
+// stay on the scalar path.
+static inline __m128 SelectPS(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
 
-	baseZ = 0.0;
-#ifndef FEATURE_VIEW_IMPROVED
-	if (SavedAppSettings.RenderMode == RM_Software || !SavedAppSettings.ZBuffer) {
-		baseZ = (double)(MidSort << (W2V_SHIFT + 8));
+static inline __m128i SelectSI(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// The int to short truncation of the scalar code
+static inline __m128i WrapShort(__m128i a) {
+	return _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+}
+
+// Screen clip flags, the same as the if/else chain of the scalar code
+static inline __m128i ScreenClip4(__m128 xs, __m128 ys) {
+	__m128 left = _mm_cmplt_ps(xs, _mm_set1_ps(FltWinLeft));
+	__m128 right = _mm_andnot_ps(left, _mm_cmpgt_ps(xs, _mm_set1_ps(FltWinRight)));
+	__m128 top = _mm_cmplt_ps(ys, _mm_set1_ps(FltWinTop));
+	__m128 bottom = _mm_andnot_ps(top, _mm_cmpgt_ps(ys, _mm_set1_ps(FltWinBottom)));
+	__m128i clip = _mm_and_si128(_mm_castps_si128(left), _mm_set1_epi32(0x01));
+	clip = _mm_or_si128(clip, _mm_and_si128(_mm_castps_si128(right), _mm_set1_epi32(0x02)));
+	clip = _mm_or_si128(clip, _mm_and_si128(_mm_castps_si128(top), _mm_set1_epi32(0x04)));
+	return _mm_or_si128(clip, _mm_and_si128(_mm_castps_si128(bottom), _mm_set1_epi32(0x08)));
+}
+
+// Truncated division of the float lanes by a double, like (int)((double)a / b)
+static inline __m128i DivTrunc4(__m128 a, double b) {
+	__m128d div = _mm_set1_pd(b);
+	__m128i lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtps_pd(a), div));
+	__m128i hi = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), div));
+	return _mm_unpacklo_epi64(lo, hi);
+}
+
+#ifdef FEATURE_VIEW_IMPROVED
+// CalculateFogShade() for four depths, with the regular fog
+static inline __m128i CalculateFogShade4(__m128i depth) {
+	__m128i below = _mm_cmplt_epi32(depth, _mm_set1_epi32(FogBeginDepth));
+	__m128i above = _mm_xor_si128(_mm_cmplt_epi32(depth, _mm_set1_epi32(FogEndDepth)), _mm_set1_epi32(-1));
+	__m128i dist = phd_MulLo32(_mm_sub_epi32(depth, _mm_set1_epi32(FogBeginDepth)), _mm_set1_epi32(0x1FFF));
+	// The operands are positive ints, so the double division is exact enough
+	// to give the same truncated quotient as the int division
+	__m128d range = _mm_set1_pd((double)(FogEndDepth - FogBeginDepth));
+	__m128i lo = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(dist), range));
+	__m128i hi = _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(dist, _MM_SHUFFLE(3, 2, 3, 2))), range));
+	__m128i shade = _mm_andnot_si128(below, _mm_unpacklo_epi64(lo, hi));
+	return SelectSI(above, _mm_set1_epi32(0x1FFF), shade);
+}
+#endif // FEATURE_VIEW_IMPROVED
+
+static short* calc_object_vertices_simd(short* ptrObj, int vtxCount, float baseZ) {
+	__declspec(align(16)) int pos[3][4];
+	__declspec(align(16)) float out[6][4];
+	__declspec(align(16)) int clip[4];
+	PHD_MATRIX* m = PhdMatrixPtr;
+	BYTE totalClip = 0xFF;
+
+	for (int i = 0; i < vtxCount; i += 4) {
+		int n = MIN(4, vtxCount - i);
+		for (int k = 0; k < 4; ++k) {
+			if (k < n) {
+				pos[0][k] = ptrObj[0];
+				pos[1][k] = ptrObj[1];
+				pos[2][k] = ptrObj[2];
+				ptrObj += 3;
+			}
+			else {
+				pos[0][k] = pos[1][k] = pos[2][k] = 0;
+			}
+		}
+		__m128i x = _mm_load_si128((__m128i*)pos[0]);
+		__m128i y = _mm_load_si128((__m128i*)pos[1]);
+		__m128i z = _mm_load_si128((__m128i*)pos[2]);
+		__m128 xv = _mm_cvtepi32_ps(_mm_add_epi32(phd_Dot4(x, y, z, m->_00, m->_01, m->_02), _mm_set1_epi32(m->_03)));
+		__m128 yv = _mm_cvtepi32_ps(_mm_add_epi32(phd_Dot4(x, y, z, m->_10, m->_11, m->_12), _mm_set1_epi32(m->_13)));
+		__m128 zv = _mm_cvtepi32_ps(_mm_add_epi32(phd_Dot4(x, y, z, m->_20, m->_21, m->_22), _mm_set1_epi32(m->_23)));
+
+		__m128 isNear = _mm_cmplt_ps(zv, _mm_set1_ps(FltNearZ));
+		__m128 isFar = _mm_cmpge_ps(zv, _mm_set1_ps(FltFarZ));
+		__m128 zClip = SelectPS(isFar, _mm_set1_ps(FltFarZ), zv);
+		__m128 zOut = SelectPS(isNear, zv, SelectPS(isFar, zClip, _mm_add_ps(zv, _mm_set1_ps(baseZ))));
+		__m128 persp = _mm_div_ps(_mm_set1_ps(FltPersp), zClip);
+		__m128 xs = _mm_add_ps(_mm_mul_ps(persp, xv), _mm_set1_ps(FltWinCenterX));
+		__m128 ys = _mm_add_ps(_mm_mul_ps(persp, yv), _mm_set1_ps(FltWinCenterY));
+		__m128 rhw = _mm_mul_ps(persp, _mm_set1_ps(FltRhwOPersp));
+		__m128i clipFlags = SelectSI(_mm_castps_si128(isNear), _mm_set1_epi32(0x80), ScreenClip4(xs, ys));
+
+		// the rows become xv, yv, zv and rhw of every vertex
+		_MM_TRANSPOSE4_PS(xv, yv, zOut, rhw);
+		_mm_store_ps(out[0], xv);
+		_mm_store_ps(out[1], yv);
+		_mm_store_ps(out[2], zOut);
+		_mm_store_ps(out[3], rhw);
+		_mm_store_ps(out[4], xs);
+		_mm_store_ps(out[5], ys);
+		_mm_store_si128((__m128i*)clip, clipFlags);
+		for (int k = 0; k < n; ++k) {
+			PHD_VBUF* vbuf = &PhdVBuf[i + k];
+			_mm_storeu_ps(&vbuf->xv, _mm_load_ps(out[k]));
+			vbuf->xs = out[4][k];
+			vbuf->ys = out[5][k];
+			vbuf->clip = clip[k];
+			totalClip &= clip[k];
+		}
 	}
-#endif // !FEATURE_VIEW_IMPROVED
+	return (totalClip == 0) ? ptrObj : NULL;
+}
 
-	totalClip = 0xFF;
+static void calc_room_vertices_simd(ROOM_DATA* ptrObj, BYTE farClip, float baseZ) {
+	__declspec(align(16)) float out[6][4];
+	__declspec(align(16)) short shorts[8];
+	__declspec(align(16)) int lightAdder[4];
+	PHD_MATRIX* m = PhdMatrixPtr;
+	int blockSize = (ptrObj->vtxSize + 3) & ~3;
+	const int* soaX = ptrObj->vtxSoA;
+	const int* soaY = soaX + blockSize;
+	const int* soaZ = soaY + blockSize;
+
+	for (int i = 0; i < ptrObj->vtxSize; i += 4) {
+		int n = MIN(4, ptrObj->vtxSize - i);
+		for (int k = 0; k < 4; ++k) {
+			lightAdder[k] = (k < n) ? ptrObj->vertices[i + k].lightAdder : 0;
+		}
+		__m128i x = _mm_load_si128((const __m128i*)&soaX[i]);
+		__m128i y = _mm_load_si128((const __m128i*)&soaY[i]);
+		__m128i z = _mm_load_si128((const __m128i*)&soaZ[i]);
+		__m128i zi = _mm_add_epi32(phd_Dot4(x, y, z, m->_20, m->_21, m->_22), _mm_set1_epi32(m->_23));
+		__m128 xv = _mm_cvtepi32_ps(_mm_add_epi32(phd_Dot4(x, y, z, m->_00, m->_01, m->_02), _mm_set1_epi32(m->_03)));
+		__m128 yv = _mm_cvtepi32_ps(_mm_add_epi32(phd_Dot4(x, y, z, m->_10, m->_11, m->_12), _mm_set1_epi32(m->_13)));
+		__m128 zv = _mm_cvtepi32_ps(zi);
+
+		__m128 isNear = _mm_cmplt_ps(zv, _mm_set1_ps(FltNearZ));
+		__m128 persp = _mm_div_ps(_mm_set1_ps(FltPersp), zv);
+		__m128i depth = _mm_srai_epi32(zi, W2V_SHIFT);
+		__m128i g = _mm_load_si128((__m128i*)lightAdder);
+#if defined(FEATURE_VIEW_IMPROVED)
+		__m128i isFar = _mm_xor_si128(_mm_cmplt_epi32(depth, _mm_set1_epi32(PhdViewDistance)), _mm_set1_epi32(-1));
+		__m128 rhw = _mm_mul_ps(persp, _mm_set1_ps(FltRhwOPersp));
+		__m128 zOut = SelectPS(isNear, zv, _mm_add_ps(zv, _mm_set1_ps(baseZ)));
+		__m128i fog = CalculateFogShade4(depth);
+#else // !FEATURE_VIEW_IMPROVED
+		__m128i isFar = _mm_xor_si128(_mm_cmplt_epi32(depth, _mm_set1_epi32(DEPTHQ_END)), _mm_set1_epi32(-1));
+		__m128 rhw = _mm_andnot_ps(_mm_castsi128_ps(isFar), _mm_mul_ps(persp, _mm_set1_ps(FltRhwOPersp)));
+		__m128 zOut = SelectPS(isNear, zv, SelectPS(_mm_castsi128_ps(isFar), _mm_set1_ps(FltFarZ), _mm_add_ps(zv, _mm_set1_ps(baseZ))));
+		__m128i fog = _mm_sub_epi32(depth, _mm_set1_epi32(DEPTHQ_START));
+		fog = _mm_and_si128(fog, _mm_cmpgt_epi32(fog, _mm_setzero_si128()));
+#endif // FEATURE_VIEW_IMPROVED
+		__m128i isNearI = _mm_castps_si128(isNear);
+		__m128i gLit = SelectSI(isFar, _mm_set1_epi32(0x1FFF), WrapShort(_mm_add_epi32(g, fog)));
+		g = SelectSI(isNearI, g, gLit);
+
+		__m128 xs = _mm_add_ps(_mm_mul_ps(persp, xv), _mm_set1_ps(FltWinCenterX));
+		__m128 ys = _mm_add_ps(_mm_mul_ps(persp, yv), _mm_set1_ps(FltWinCenterY));
+		__m128i clip = _mm_and_si128(isFar, _mm_set1_epi32(farClip));
+		clip = _mm_or_si128(clip, ScreenClip4(xs, ys));
+		__m128i zClip = _mm_and_si128(DivTrunc4(zOut, 0x155555.p0), _mm_set1_epi32(0xFF));
+		clip = _mm_or_si128(clip, _mm_slli_epi32(_mm_xor_si128(zClip, _mm_set1_epi32(0xFF)), 8));
+		clip = SelectSI(isNearI, _mm_set1_epi32(0xFF80), clip);
+
+		// clip and g as shorts, g is clamped to 0..8191
+		__m128i packed = _mm_packs_epi32(WrapShort(clip), WrapShort(g));
+		__m128i clamped = _mm_min_epi16(_mm_max_epi16(packed, _mm_setzero_si128()), _mm_set1_epi16(8191));
+		packed = _mm_unpacklo_epi64(packed, _mm_unpackhi_epi64(clamped, clamped));
+		_mm_store_si128((__m128i*)shorts, packed);
+
+		// the rows become xv, yv, zv and rhw of every vertex
+		_MM_TRANSPOSE4_PS(xv, yv, zOut, rhw);
+		_mm_store_ps(out[0], xv);
+		_mm_store_ps(out[1], yv);
+		_mm_store_ps(out[2], zOut);
+		_mm_store_ps(out[3], rhw);
+		_mm_store_ps(out[4], xs);
+		_mm_store_ps(out[5], ys);
+		for (int k = 0; k < n; ++k) {
+			PHD_VBUF* vbuf = &PhdVBuf[i + k];
+			_mm_storeu_ps(&vbuf->xv, _mm_load_ps(out[k]));
+			vbuf->xs = out[4][k];
+			vbuf->ys = out[5][k];
+			vbuf->clip = shorts[k];
+			vbuf->g = shorts[4 + k];
+		}
+	}
+}
+#endif // FEATURE_VERTEX_SIMD
 
-	ptrObj++; // skip poly counter
-	vtxCount = *(ptrObj++); // get vertex counter
+static short* calc_object_vertices_scalar(short* ptrObj, int vtxCount, float baseZ) {
+	float xv, yv, zv, persp;
+	BYTE totalClip = 0xFF, clipFlags;
 
 	for (int i = 0; i < vtxCount; ++i) {
 		xv = (float)(PhdMatrixPtr->_00 * ptrObj[0] +
@@ -626,6 +823,27 @@ short* calc_object_vertices(short* ptrObj) {
 	return (totalClip == 0) ? ptrObj : NULL;
 }
 
+short* calc_object_vertices(short* ptrObj) {
+	float baseZ = 0.0;
+	int vtxCount;
+
+#ifndef FEATURE_VIEW_IMPROVED
+	if (SavedAppSettings.RenderMode == RM_Software || !SavedAppSettings.ZBuffer) {
+		baseZ = (double)(MidSort << (W2V_SHIFT + 8));
+	}
+#endif // !FEATURE_VIEW_IMPROVED
+
+	ptrObj++; // skip poly counter
+	vtxCount = *(ptrObj++); // get vertex counter
+
+#ifdef FEATURE_VERTEX_SIMD
+	if (!IsWaterEffect) {
+		return calc_object_vertices_simd(ptrObj, vtxCount, baseZ);
+	}
+#endif // FEATURE_VERTEX_SIMD
+	return calc_object_vertices_scalar(ptrObj, vtxCount, baseZ);
+}
+
 short* calc_vertice_light(short* ptrObj) {
 	int i, xv, yv, zv;
 	short shade;
@@ -670,19 +888,12 @@ short* calc_vertice_light(short* ptrObj) {
 	return ptrObj;
 }
 
-void calc_room_vertices(ROOM_DATA* ptrObj, BYTE farClip) {
+static void calc_room_vertices_scalar(ROOM_DATA* ptrObj, BYTE farClip, float baseZ) {
 	PHD_VBUF* vbuf;
 	ROOM_VERTEX* vtx;
 	float xv, yv, zv, persp, depth;
-	float baseZ = 0.0;
 	int zv_int;
 
-#if !defined(FEATURE_VIEW_IMPROVED)
-	if (SavedAppSettings.RenderMode == RM_Software || !SavedAppSettings.ZBuffer) {
-		baseZ = (double)(MidSort << (W2V_SHIFT + 8));
-	}
-#endif // !FEATURE_VIEW_IMPROVED
-
 	for (int i = 0; i < ptrObj->vtxSize; ++i)
 	{
 		vtx = &ptrObj->vertices[i];
@@ -756,6 +967,56 @@ void calc_room_vertices(ROOM_DATA* ptrObj, BYTE farClip) {
 	}
 }
 
+void calc_room_vertices(ROOM_DATA* ptrObj, BYTE farClip) {
+	float baseZ = 0.0;
+
+#if !defined(FEATURE_VIEW_IMPROVED)
+	if (SavedAppSettings.RenderMode == RM_Software || !SavedAppSettings.ZBuffer) {
+		baseZ = (double)(MidSort << (W2V_SHIFT + 8));
+	}
+#endif // !FEATURE_VIEW_IMPROVED
+
+#ifdef FEATURE_VERTEX_SIMD
+	if (!IsWaterEffect && !IsWibbleEffect && ptrObj->vtxSoA != NULL) {
+		calc_room_vertices_simd(ptrObj, farClip, baseZ);
+		return;
+	}
+#endif // FEATURE_VERTEX_SIMD
+	calc_room_vertices_scalar(ptrObj, farClip, baseZ);
+}
+
+#if defined(FEATURE_VERTEX_SIMD) && defined(FEATURE_BENCHMARK)
+// The benchmark transforms the same vertices by both paths and compares them
+short* calc_object_vertices_path(short* ptrObj, int vtxCount, float baseZ, bool isSIMD) {
+	if (isSIMD) {
+		return calc_object_vertices_simd(ptrObj, vtxCount, baseZ);
+	}
+	return calc_object_vertices_scalar(ptrObj, vtxCount, baseZ);
+}
+
+void calc_room_vertices_path(ROOM_DATA* ptrObj, BYTE farClip, float baseZ, bool isSIMD) {
+	if (isSIMD) {
+		calc_room_vertices_simd(ptrObj, farClip, baseZ);
+		return;
+	}
+	calc_room_vertices_scalar(ptrObj, farClip, baseZ);
+}
+#endif // defined(FEATURE_VERTEX_SIMD) && defined(FEATURE_BENCHMARK)
+
+#ifdef FEATURE_EXTENDED_LIMITS
+void phd_InitVertexBuffer(DWORD vtxCount) {
+	if (vtxCount <= ARRAY_SIZE(PhdVBufDefault)) {
+		PhdVBuf = PhdVBufDefault;
+		return;
+	}
+	// The level memory is released with the level, so the buffer is
+	// allocated again on every level load. The game_malloc() alignment
+	// is just 4 bytes, so the pointer is aligned here.
+	BYTE* ptr = (BYTE*)game_malloc(sizeof(PHD_VBUF) * vtxCount + 12, GBUF_PolygonBuffers);
+	PhdVBuf = (PHD_VBUF*)(((DWORD)ptr + 15) & ~15);
+}
+#endif // FEATURE_EXTENDED_LIMITS
+
 void phd_RotateLight(short yRot, short xRot) {
 	int xcos, ysin, wcos, wsin;
 	int ls_x, ls_y, ls_z;
@@ -785,6 +1046,49 @@ void phd_InitPolyList() {
 		HWR_VertexPtr = HWR_VertexBuffer;
 }
 
+#ifdef FEATURE_VIEW_IMPROVED
+// Since the surface index is packed into the lowest bits of every key,
+// all keys are unique and both sorting methods produce the same order.
+static void RadixSortPolyList(DWORD count) {
+	static DWORD histogram[sizeof(UINT64)][256];
+	SORT_ITEM* src = SortBuffer;
+	SORT_ITEM* dst = SortScratchBuffer;
+	SORT_ITEM* swapPtr;
+
+	// The list is drawn back to front, so the keys are sorted
+	// in descending order, i.e. ascending order of inverted keys
+	memset(histogram, 0, sizeof(histogram));
+	for (DWORD i = 0; i < count; ++i) {
+		UINT64 key = ~src[i]._1;
+		for (DWORD d = 0; d < sizeof(UINT64); ++d) {
+			++histogram[d][(key >> (d * 8)) & 0xFF];
+		}
+	}
+
+	for (DWORD d = 0; d < sizeof(UINT64); ++d) {
+		DWORD* bucket = histogram[d];
+		DWORD shift = d * 8;
+		// Skip the pass if all keys have the same digit here
+		if (bucket[(~src[0]._1 >> shift) & 0xFF] == count) continue;
+
+		DWORD offset = 0;
+		for (DWORD b = 0; b < 256; ++b) {
+			DWORD num = bucket[b];
+			bucket[b] = offset;
+			offset += num;
+		}
+		for (DWORD i = 0; i < count; ++i) {
+			dst[bucket[(~src[i]._1 >> shift) & 0xFF]++] = src[i];
+		}
+		SWAP(src, dst, swapPtr);
+	}
+
+	if (src != SortBuffer) {
+		memcpy(SortBuffer, src, sizeof(SORT_ITEM) * count);
+	}
+}
+#endif // FEATURE_VIEW_IMPROVED
+
 void phd_SortPolyList() {
 	if (SurfaceCount) {
 		for (DWORD i = 0; i < SurfaceCount; ++i) {
@@ -793,6 +1097,12 @@ void phd_SortPolyList() {
 #endif // FEATURE_VIEW_IMPROVED
 			SortBuffer[i]._1 += i;
 		}
+#ifdef FEATURE_VIEW_IMPROVED
+		if (PolySortMode == POLYSORT_Radix) {
+			RadixSortPolyList(SurfaceCount);
+			return;
+		}
+#endif // FEATURE_VIEW_IMPROVED
 		do_quickysorty(0, SurfaceCount - 1);
 	}
 }
@@ -822,10 +1132,36 @@ void do_quickysorty(int left, int right) {
 		do_quickysorty(i, right);
 }
 
+#ifdef FEATURE_NOLEGACY_OPTIONS
+// Every band replays the whole sorted list, but draws its own rows only,
+// so the painter's order is kept without any locking between threads.
+static void PrintPolyListBand(int index, int count, LPVOID param) {
+	short polyType, * bufPtr;
+	int height = GetHeightSWR();
+
+	BeginBandSWR(index, height * index / count, height * (index + 1) / count);
+	for (DWORD i = 0; i < SurfaceCount; ++i) {
+		bufPtr = (short*)SortBuffer[i]._0;
+		polyType = *(bufPtr++);
+		PolyDrawRoutines[polyType](bufPtr);
+	}
+	EndBandSWR();
+}
+#endif // FEATURE_NOLEGACY_OPTIONS
+
 void phd_PrintPolyList(BYTE* surfacePtr) {
 	short polyType, * bufPtr;
 	PrintSurfacePtr = surfacePtr;
 
+#ifdef FEATURE_NOLEGACY_OPTIONS
+	int bands = JOB_GetThreadsCount();
+	CLAMPG(bands, SWR_MAX_BANDS);
+	if (bands > 1) {
+		JOB_Run(PrintPolyListBand, bands, NULL);
+		return;
+	}
+#endif // FEATURE_NOLEGACY_OPTIONS
+
 	for (DWORD i = 0; i < SurfaceCount; ++i) {
 		bufPtr = (short*)SortBuffer[i]._0;
 		polyType = *(bufPtr++); // poly has type as routine index in first word
@@ -50,6 +50,13 @@ void S_InsertInvBgnd(short* ptrObj); // ----------
 short* calc_object_vertices(short* ptrObj); // 0x00401D50
 short* calc_vertice_light(short* ptrObj); // 0x00401F30
 void calc_room_vertices(ROOM_DATA* ptrObj, BYTE farClip); // 0x004020A0
+#if defined(FEATURE_VERTEX_SIMD) && defined(FEATURE_BENCHMARK)
+short* calc_object_vertices_path(short* ptrObj, int vtxCount, float baseZ, bool isSIMD);
+void calc_room_vertices_path(ROOM_DATA* ptrObj, BYTE farClip, float baseZ, bool isSIMD);
+#endif // defined(FEATURE_VERTEX_SIMD) && defined(FEATURE_BENCHMARK)
+#ifdef FEATURE_EXTENDED_LIMITS
+void phd_InitVertexBuffer(DWORD vtxCount);
+#endif // FEATURE_EXTENDED_LIMITS
 void phd_RotateLight(short yRot, short xRot); // 0x00402320
 void phd_InitPolyList(); // 0x004023F0
 void phd_SortPolyList(); // 0x00402420
@@ -22,6 +22,8 @@
 #include "precompiled.h"
 #include "3dsystem/3d_out.h"
 #include "global/vars.h"
+#include <immintrin.h>
+#include <intrin.h>
 
 #pragma pack(push, 1)
 
@@ -94,27 +96,86 @@ typedef struct {
 #ifdef FEATURE_NOLEGACY_OPTIONS
 static int SwrPitch = 0;
 static int SwrHeight = 0;
-static void* XBuffer = NULL;
+static void* XBufferMain = NULL;
+static void* XBufferBands[SWR_MAX_BANDS];
+
+// Every rendering thread has its own edge buffer and band of the surface rows
+thread_local int XGen_y0 = 0;
+thread_local int XGen_y1 = 0;
+static thread_local void* XBuffer = NULL;
+static thread_local bool SwrBandActive = false;
+static thread_local int SwrBandY0 = 0;
+static thread_local int SwrBandY1 = 0;
 
 int GetPitchSWR() {
 	return SwrPitch;
 }
 
+int GetHeightSWR() {
+	return SwrHeight;
+}
+
 void PrepareSWR(int pitch, int height) {
 	if (pitch != 0) {
 		SwrPitch = pitch;
 	}
-	if (height != 0 && (XBuffer == NULL || SwrHeight != height)) {
+	if (height != 0 && (XBufferMain == NULL || SwrHeight != height)) {
 		SwrHeight = height;
-		if (XBuffer != NULL) free(XBuffer);
-		XBuffer = malloc(sizeof(XBUF_XGUVP) * height);
+		if (XBufferMain != NULL) free(XBufferMain);
+		XBufferMain = malloc(sizeof(XBUF_XGUVP) * height);
+		// band buffers are reallocated on demand
+		for (int i = 0; i < SWR_MAX_BANDS; ++i) {
+			if (XBufferBands[i] != NULL) {
+				free(XBufferBands[i]);
+				XBufferBands[i] = NULL;
+			}
+		}
+	}
+	XBuffer = XBufferMain;
+}
+
+void BeginBandSWR(int band, int y0, int y1) {
+	if (XBufferBands[band] == NULL) {
+		XBufferBands[band] = malloc(sizeof(XBUF_XGUVP) * SwrHeight);
 	}
+	XBuffer = XBufferBands[band];
+	SwrBandY0 = y0;
+	SwrBandY1 = y1;
+	SwrBandActive = true;
+}
+
+void EndBandSWR() {
+	SwrBandActive = false;
+	XBuffer = XBufferMain;
+}
+
+bool ClipBandSWR(int* y0, int* y1) {
+	if (SwrBandActive) {
+		CLAMPL(*y0, SwrBandY0);
+		CLAMPG(*y1, SwrBandY1);
+	}
+	return *y0 < *y1;
 }
 #else // FEATURE_NOLEGACY_OPTIONS
 #define SwrPitch PhdScreenWidth // NOTE: this is the original game bug!
 static int XBuffer[1200 * sizeof(XBUF_XGUVP) / sizeof(int)]; // maximum safe resolution is 1200 pixels
 #endif // FEATURE_NOLEGACY_OPTIONS
 
+static inline BOOL xgen_range(int yMin, int yMax) {
+	if (yMin == yMax)
+		return FALSE;
+
+#ifdef FEATURE_NOLEGACY_OPTIONS
+	// Rows outside of the band of this thread are drawn by other threads
+	if (!ClipBandSWR(&yMin, &yMax))
+		return FALSE;
+#endif // FEATURE_NOLEGACY_OPTIONS
+
+	XGen_y0 = yMin;
+	XGen_y1 = yMax;
+	return TRUE;
+}
+
 void draw_poly_line(short* bufPtr) {
 	int i, j;
 	int x0, y0, x1, y1;
@@ -170,7 +231,19 @@ void draw_poly_line(short* bufPtr) {
 	xSize = x1 - x0;
 	ySize = y1 - y0;
 
+#ifdef FEATURE_NOLEGACY_OPTIONS
+	BYTE* bandPtr0 = PrintSurfacePtr;
+	BYTE* bandPtr1 = PrintSurfacePtr + SwrPitch * SwrHeight;
+	if (SwrBandActive) {
+		bandPtr0 = PrintSurfacePtr + SwrPitch * SwrBandY0;
+		bandPtr1 = PrintSurfacePtr + SwrPitch * SwrBandY1;
+	}
+#endif // FEATURE_NOLEGACY_OPTIONS
+
 	if ((xSize | ySize) == 0) {
+#ifdef FEATURE_NOLEGACY_OPTIONS
+		if (drawPtr >= bandPtr0 && drawPtr < bandPtr1)
+#endif // FEATURE_NOLEGACY_OPTIONS
 		*drawPtr = colorIdx;
 		return;
 	}
@@ -209,6 +282,9 @@ void draw_poly_line(short* bufPtr) {
 
 	while (i--) {
 		partTotal += part;
+#ifdef FEATURE_NOLEGACY_OPTIONS
+		if (drawPtr >= bandPtr0 && drawPtr < bandPtr1)
+#endif // FEATURE_NOLEGACY_OPTIONS
 		*drawPtr = colorIdx;
 		drawPtr += colAdd;
 		if (partTotal >= PHD_ONE) {
@@ -293,12 +369,7 @@ BOOL xgen_x(short* bufPtr) {
 		}
 	}
 
-	if (yMin == yMax)
-		return FALSE;
-
-	XGen_y0 = yMin;
-	XGen_y1 = yMax;
-	return TRUE;
+	return xgen_range(yMin, yMax);
 }
 
 BOOL xgen_xg(short* bufPtr) {
@@ -363,12 +434,7 @@ BOOL xgen_xg(short* bufPtr) {
 		}
 	}
 
-	if (yMin == yMax)
-		return FALSE;
-
-	XGen_y0 = yMin;
-	XGen_y1 = yMax;
-	return TRUE;
+	return xgen_range(yMin, yMax);
 }
 
 BOOL xgen_xguv(short* bufPtr) {
@@ -453,12 +519,7 @@ BOOL xgen_xguv(short* bufPtr) {
 		}
 	}
 
-	if (yMin == yMax)
-		return FALSE;
-
-	XGen_y0 = yMin;
-	XGen_y1 = yMax;
-	return TRUE;
+	return xgen_range(yMin, yMax);
 }
 
 BOOL xgen_xguvpersp_fp(short* bufPtr) {
@@ -556,16 +617,168 @@ BOOL xgen_xguvpersp_fp(short* bufPtr) {
 		}
 	}
 
-	if (yMin == yMax)
-		return FALSE;
+	return xgen_range(yMin, yMax);
+}
 
-	XGen_y0 = yMin;
-	XGen_y1 = yMax;
-	return TRUE;
+// The AVX2 span path needs the CPU and the OS support of the YMM registers
+bool IsAVX2Supported() {
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	// OSXSAVE and AVX, then the OS must save the XMM and YMM state
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+	if ((_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+
+static const bool SpanAVX2 = IsAVX2Supported();
+
+// The plain per-pixel loop of an affine segment of a perspective textured span.
+// The colour key leaves transparent pixels as they are. Every texel is drawn
+// SCALE times in a row (the low-detail path of the perspective batches).
+template<bool COLORKEY, int SCALE>
+static inline void gtmap_span_scalar(BYTE*& linePtr, int count, int& g, int& u, int& v, int gAdd, int uAdd, int vAdd, BYTE* texPage) {
+	BYTE colorIdx;
+
+	for (; count > 0; --count) {
+		colorIdx = texPage[BYTE2(v) * 256 + BYTE2(u)];
+		if (!COLORKEY || colorIdx != 0) {
+			colorIdx = DepthQTable[BYTE2(g)].index[colorIdx];
+			for (int i = 0; i < SCALE; ++i) {
+				linePtr[i] = colorIdx;
+			}
+		}
+		linePtr += SCALE;
+		g += gAdd;
+		u += uAdd;
+		v += vAdd;
+	}
+}
+
+// Writes 8 shades (SCALE times each) to the line, the colour key is applied
+// with a byte mask, so transparent pixels keep the surface content
+template<bool COLORKEY, int SCALE>
+static inline void gtmap_span_store(BYTE* linePtr, __m128i px, __m128i tx) {
+	if (SCALE == 2) px = _mm_unpacklo_epi8(px, px);
+	if (COLORKEY) {
+		if (SCALE == 2) tx = _mm_unpacklo_epi8(tx, tx);
+		__m128i keyMask = _mm_cmpeq_epi8(tx, _mm_setzero_si128());
+		__m128i dst = (SCALE == 2) ? _mm_loadu_si128((__m128i*)linePtr) : _mm_loadl_epi64((__m128i*)linePtr);
+		px = _mm_or_si128(_mm_and_si128(keyMask, dst), _mm_andnot_si128(keyMask, px));
+	}
+	if (SCALE == 2) {
+		_mm_storeu_si128((__m128i*)linePtr, px);
+	}
+	else {
+		_mm_storel_epi64((__m128i*)linePtr, px);
+	}
+}
+
+// SSE2 path: texel and DepthQTable addresses are generated for 8 texels per
+// step, the table lookups themselves are scalar (SSE2 has no gathers)
+template<bool COLORKEY, int SCALE>
+static inline void gtmap_span_sse2(BYTE*& linePtr, int& count, int& g, int& u, int& v, int gAdd, int uAdd, int vAdd, BYTE* texPage) {
+	BYTE* dqTable = (BYTE*)DepthQTable;
+	alignas(16) int texIdx[8];
+	alignas(16) int dqIdx[8];
+	alignas(16) BYTE texels[8];
+	alignas(16) BYTE shades[8];
+	__m128i gv = _mm_setr_epi32(g, g + gAdd, g + gAdd * 2, g + gAdd * 3);
+	__m128i uv = _mm_setr_epi32(u, u + uAdd, u + uAdd * 2, u + uAdd * 3);
+	__m128i vv = _mm_setr_epi32(v, v + vAdd, v + vAdd * 2, v + vAdd * 3);
+	__m128i gStep = _mm_set1_epi32(gAdd * 4);
+	__m128i uStep = _mm_set1_epi32(uAdd * 4);
+	__m128i vStep = _mm_set1_epi32(vAdd * 4);
+	__m128i maskLo = _mm_set1_epi32(0x00FF);
+	__m128i maskHi = _mm_set1_epi32(0xFF00);
+
+	do {
+		for (int i = 0; i < 8; i += 4) {
+			// BYTE2(v) * 256 + BYTE2(u), BYTE2(g) * sizeof(DEPTHQ_ENTRY)
+			__m128i ti = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(vv, 8), maskHi), _mm_and_si128(_mm_srli_epi32(uv, 16), maskLo));
+			__m128i di = _mm_and_si128(_mm_srli_epi32(gv, 8), maskHi);
+			_mm_store_si128((__m128i*)&texIdx[i], ti);
+			_mm_store_si128((__m128i*)&dqIdx[i], di);
+			gv = _mm_add_epi32(gv, gStep);
+			uv = _mm_add_epi32(uv, uStep);
+			vv = _mm_add_epi32(vv, vStep);
+		}
+		for (int i = 0; i < 8; ++i) {
+			texels[i] = texPage[texIdx[i]];
+			shades[i] = dqTable[dqIdx[i] + texels[i]];
+		}
+		gtmap_span_store<COLORKEY, SCALE>(linePtr, _mm_loadl_epi64((__m128i*)shades), _mm_loadl_epi64((__m128i*)texels));
+		linePtr += 8 * SCALE;
+		count -= 8;
+	} while (count >= 8);
+
+	g = _mm_cvtsi128_si32(gv);
+	u = _mm_cvtsi128_si32(uv);
+	v = _mm_cvtsi128_si32(vv);
+}
+
+// AVX2 path: both lookups are dword gathers of 8 texels, the wanted byte is
+// the lowest one. A gather reads up to 3 bytes past the texel: the texture
+// pages are taken from the game memory before the rooms, and DepthQTable is
+// followed by DepthQIndex, so these bytes are always there.
+template<bool COLORKEY, int SCALE>
+static inline void gtmap_span_avx2(BYTE*& linePtr, int& count, int& g, int& u, int& v, int gAdd, int uAdd, int vAdd, BYTE* texPage) {
+	const int* dqTable = (const int*)DepthQTable;
+	__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i gv = _mm256_add_epi32(_mm256_set1_epi32(g), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(gAdd)));
+	__m256i uv = _mm256_add_epi32(_mm256_set1_epi32(u), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(uAdd)));
+	__m256i vv = _mm256_add_epi32(_mm256_set1_epi32(v), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(vAdd)));
+	__m256i gStep = _mm256_set1_epi32(gAdd * 8);
+	__m256i uStep = _mm256_set1_epi32(uAdd * 8);
+	__m256i vStep = _mm256_set1_epi32(vAdd * 8);
+	__m256i maskLo = _mm256_set1_epi32(0x00FF);
+	__m256i maskHi = _mm256_set1_epi32(0xFF00);
+	// the lowest byte of every dword to the lowest 4 bytes of every 128 bit half
+	__m256i packBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	do {
+		__m256i ti = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(vv, 8), maskHi), _mm256_and_si256(_mm256_srli_epi32(uv, 16), maskLo));
+		__m256i tx = _mm256_and_si256(_mm256_i32gather_epi32((const int*)texPage, ti, 1), maskLo);
+		__m256i di = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(gv, 8), maskHi), tx);
+		__m256i px = _mm256_shuffle_epi8(_mm256_i32gather_epi32(dqTable, di, 1), packBytes);
+		tx = _mm256_shuffle_epi8(tx, packBytes);
+		gtmap_span_store<COLORKEY, SCALE>(linePtr,
+			_mm_unpacklo_epi32(_mm256_castsi256_si128(px), _mm256_extracti128_si256(px, 1)),
+			_mm_unpacklo_epi32(_mm256_castsi256_si128(tx), _mm256_extracti128_si256(tx, 1)));
+		gv = _mm256_add_epi32(gv, gStep);
+		uv = _mm256_add_epi32(uv, uStep);
+		vv = _mm256_add_epi32(vv, vStep);
+		linePtr += 8 * SCALE;
+		count -= 8;
+	} while (count >= 8);
+
+	g = _mm256_extract_epi32(gv, 0);
+	u = _mm256_extract_epi32(uv, 0);
+	v = _mm256_extract_epi32(vv, 0);
+}
+
+// Draws an affine segment of a perspective textured span, 8 texels per step
+// with AVX2 gathers if the CPU has them, or with SSE2 otherwise. The rest of
+// the segment goes through the scalar loop. The output is identical to the
+// plain per-pixel loop, the benchspan benchmark checks that.
+template<bool COLORKEY, int SCALE>
+static inline void gtmap_span(BYTE*& linePtr, int count, int& g, int& u, int& v, int gAdd, int uAdd, int vAdd, BYTE* texPage) {
+	if (count >= 8) {
+		if (SpanAVX2) {
+			gtmap_span_avx2<COLORKEY, SCALE>(linePtr, count, g, u, v, gAdd, uAdd, vAdd, texPage);
+		}
+		else {
+			gtmap_span_sse2<COLORKEY, SCALE>(linePtr, count, g, u, v, gAdd, uAdd, vAdd, texPage);
+		}
+	}
+	gtmap_span_scalar<COLORKEY, SCALE>(linePtr, count, g, u, v, gAdd, uAdd, vAdd, texPage);
 }
 
 void gtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
-	int batchSize, batchCounter;
+	int batchSize;
 	int x, xSize, ySize;
 	int g, u0, u1, v0, v1, gAdd, u0Add, v0Add;
 	double u, v, rhw, uAdd, vAdd, rhwAdd;
@@ -616,26 +829,10 @@ void gtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
 				v0Add = (v1 - v0) / batchSize;
 
 				if ((ABS(u0Add) + ABS(v0Add)) < (PHD_ONE / 2)) {
-					batchCounter = batchSize / 2;
-					do {
-						colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-						colorIdx = DepthQTable[BYTE2(g)].index[colorIdx];
-						*(linePtr++) = colorIdx;
-						*(linePtr++) = colorIdx;
-						g += gAdd * 2;
-						u0 += u0Add * 2;
-						v0 += v0Add * 2;
-					} while (--batchCounter);
+					gtmap_span<false, 2>(linePtr, batchSize / 2, g, u0, v0, gAdd * 2, u0Add * 2, v0Add * 2, texPage);
 				}
 				else {
-					batchCounter = batchSize;
-					do {
-						colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-						*(linePtr++) = DepthQTable[BYTE2(g)].index[colorIdx];
-						g += gAdd;
-						u0 += u0Add;
-						v0 += v0Add;
-					} while (--batchCounter);
+					gtmap_span<false, 1>(linePtr, batchSize, g, u0, v0, gAdd, u0Add, v0Add, texPage);
 				}
 
 				u0 = u1;
@@ -654,26 +851,10 @@ void gtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
 			xSize -= batchSize;
 
 			if ((ABS(u0Add) + ABS(v0Add)) < (PHD_ONE / 2)) {
-				batchCounter = batchSize / 2;
-				do {
-					colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-					colorIdx = DepthQTable[BYTE2(g)].index[colorIdx];
-					*(linePtr++) = colorIdx;
-					*(linePtr++) = colorIdx;
-					g += gAdd * 2;
-					u0 += u0Add * 2;
-					v0 += v0Add * 2;
-				} while (--batchCounter);
+				gtmap_span<false, 2>(linePtr, batchSize / 2, g, u0, v0, gAdd * 2, u0Add * 2, v0Add * 2, texPage);
 			}
 			else {
-				batchCounter = batchSize;
-				do {
-					colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-					*(linePtr++) = DepthQTable[BYTE2(g)].index[colorIdx];
-					g += gAdd;
-					u0 += u0Add;
-					v0 += v0Add;
-				} while (--batchCounter);
+				gtmap_span<false, 1>(linePtr, batchSize, g, u0, v0, gAdd, u0Add, v0Add, texPage);
 			}
 		}
 
@@ -685,7 +866,7 @@ void gtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
 }
 
 void wgtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
-	int batchSize, batchCounter;
+	int batchSize;
 	int x, xSize, ySize;
 	int g, u0, u1, v0, v1, gAdd, u0Add, v0Add;
 	double u, v, rhw, uAdd, vAdd, rhwAdd;
@@ -736,32 +917,10 @@ void wgtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
 				v0Add = (v1 - v0) / batchSize;
 
 				if ((ABS(u0Add) + ABS(v0Add)) < (PHD_ONE / 2)) {
-					batchCounter = batchSize / 2;
-					do {
-						colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-						if (colorIdx != 0) {
-							colorIdx = DepthQTable[BYTE2(g)].index[colorIdx];
-							linePtr[0] = colorIdx;
-							linePtr[1] = colorIdx;
-						}
-						linePtr += 2;
-						g += gAdd * 2;
-						u0 += u0Add * 2;
-						v0 += v0Add * 2;
-					} while (--batchCounter);
+					gtmap_span<true, 2>(linePtr, batchSize / 2, g, u0, v0, gAdd * 2, u0Add * 2, v0Add * 2, texPage);
 				}
 				else {
-					batchCounter = batchSize;
-					do {
-						colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-						if (colorIdx != 0) {
-							*linePtr = DepthQTable[BYTE2(g)].index[colorIdx];
-						}
-						linePtr++;
-						g += gAdd;
-						u0 += u0Add;
-						v0 += v0Add;
-					} while (--batchCounter);
+					gtmap_span<true, 1>(linePtr, batchSize, g, u0, v0, gAdd, u0Add, v0Add, texPage);
 				}
 
 				u0 = u1;
@@ -780,32 +939,10 @@ void wgtmap_persp32_fp(int y0, int y1, BYTE* texPage) {
 			xSize -= batchSize;
 
 			if ((ABS(u0Add) + ABS(v0Add)) < (PHD_ONE / 2)) {
-				batchCounter = batchSize / 2;
-				do {
-					colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-					if (colorIdx != 0) {
-						colorIdx = DepthQTable[BYTE2(g)].index[colorIdx];
-						linePtr[0] = colorIdx;
-						linePtr[1] = colorIdx;
-					}
-					linePtr += 2;
-					g += gAdd * 2;
-					u0 += u0Add * 2;
-					v0 += v0Add * 2;
-				} while (--batchCounter);
+				gtmap_span<true, 2>(linePtr, batchSize / 2, g, u0, v0, gAdd * 2, u0Add * 2, v0Add * 2, texPage);
 			}
 			else {
-				batchCounter = batchSize;
-				do {
-					colorIdx = texPage[BYTE2(v0) * 256 + BYTE2(u0)];
-					if (colorIdx != 0) {
-						*linePtr = DepthQTable[BYTE2(g)].index[colorIdx];
-					}
-					linePtr++;
-					g += gAdd;
-					u0 += u0Add;
-					v0 += v0Add;
-				} while (--batchCounter);
+				gtmap_span<true, 1>(linePtr, batchSize, g, u0, v0, gAdd, u0Add, v0Add, texPage);
 			}
 		}
 
@@ -988,6 +1125,33 @@ void __fastcall wgtmapA(int y0, int y1, BYTE* texPage) {
 	}
 }
 
+#ifdef FEATURE_BENCHMARK
+// Draws a perspective batch with one span path: 0 - scalar, 1 - SSE2, 2 - AVX2
+template<bool COLORKEY, int SCALE>
+static inline void DrawSpanPath(int path, BYTE* linePtr, SPAN_PARAMS* span, BYTE* texPage) {
+	int count = (SCALE == 2) ? 16 : 32; // the perspective batches are 32 pixels
+	if (path == 1) {
+		gtmap_span_sse2<COLORKEY, SCALE>(linePtr, count, span->g, span->u, span->v, span->gAdd, span->uAdd, span->vAdd, texPage);
+	}
+	else if (path == 2) {
+		gtmap_span_avx2<COLORKEY, SCALE>(linePtr, count, span->g, span->u, span->v, span->gAdd, span->uAdd, span->vAdd, texPage);
+	}
+	gtmap_span_scalar<COLORKEY, SCALE>(linePtr, count, span->g, span->u, span->v, span->gAdd, span->uAdd, span->vAdd, texPage);
+}
+
+// The benchmark draws the same spans by every path and compares them
+void DrawSpanBatch(int path, bool colorKey, bool isDouble, BYTE* linePtr, SPAN_PARAMS* span, BYTE* texPage) {
+	if (colorKey) {
+		if (isDouble) DrawSpanPath<true, 2>(path, linePtr, span, texPage);
+		else DrawSpanPath<true, 1>(path, linePtr, span, texPage);
+	}
+	else {
+		if (isDouble) DrawSpanPath<false, 2>(path, linePtr, span, texPage);
+		else DrawSpanPath<false, 1>(path, linePtr, span, texPage);
+	}
+}
+#endif // FEATURE_BENCHMARK
+
 /*
  * Inject function
  */
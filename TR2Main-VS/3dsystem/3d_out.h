@@ -24,9 +24,30 @@
 
 #include "global/types.h"
 
+#ifdef FEATURE_NOLEGACY_OPTIONS
+// Maximum number of horizontal bands for multithreaded software rendering
+#define SWR_MAX_BANDS (16)
+#endif // FEATURE_NOLEGACY_OPTIONS
+
+#ifdef FEATURE_BENCHMARK
+typedef struct SpanParams_t {
+	int g, u, v;
+	int gAdd, uAdd, vAdd;
+} SPAN_PARAMS;
+#endif // FEATURE_BENCHMARK
+
  /*
   * Function list
   */
+#ifdef FEATURE_NOLEGACY_OPTIONS
+int GetPitchSWR();
+int GetHeightSWR();
+void PrepareSWR(int pitch, int height);
+void BeginBandSWR(int band, int y0, int y1);
+void EndBandSWR();
+bool ClipBandSWR(int* y0, int* y1);
+#endif // FEATURE_NOLEGACY_OPTIONS
+
 void draw_poly_line(short* bufPtr); // 0x00402960
 void draw_poly_flat(short* bufPtr); // 0x00402B00
 void draw_poly_trans(short* bufPtr); // 0x00402B40
@@ -46,5 +67,9 @@ void __fastcall transA(int y0, int y1, BYTE depthQ); // 0x004575C5
 void __fastcall gourA(int y0, int y1, BYTE colorIdx); // 0x004576FF
 void __fastcall gtmapA(int y0, int y1, BYTE* texPage); // 0x0045785F
 void __fastcall wgtmapA(int y0, int y1, BYTE* texPage); // 0x00457B5C
+bool IsAVX2Supported();
+#ifdef FEATURE_BENCHMARK
+void DrawSpanBatch(int path, bool colorKey, bool isDouble, BYTE* linePtr, SPAN_PARAMS* span, BYTE* texPage);
+#endif // FEATURE_BENCHMARK
 
 #endif // _3DOUT_H_INCLUDED
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PHD_SIMD_H_INCLUDED
+#define PHD_SIMD_H_INCLUDED
+
+#include "global/types.h"
+#include <emmintrin.h>
+
+// SSE2 has no 32 bit multiplication, so the even and the odd lanes are
+// multiplied separately. The low halves of the products are the same for
+// the signed numbers, so the result wraps exactly like the int multiplication.
+static inline __m128i phd_MulLo32(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// One matrix row multiplied by four vectors
+static inline __m128i phd_Dot4(__m128i x, __m128i y, __m128i z, int m0, int m1, int m2) {
+	return _mm_add_epi32(_mm_add_epi32(phd_MulLo32(x, _mm_set1_epi32(m0)), phd_MulLo32(y, _mm_set1_epi32(m1))), phd_MulLo32(z, _mm_set1_epi32(m2)));
+}
+
+#endif // PHD_SIMD_H_INCLUDED
@@ -21,6 +21,7 @@
 
 #include "precompiled.h"
 #include "3dsystem/scalespr.h"
+#include "3dsystem/3d_out.h"
 #include "specific/output.h"
 #include "global/vars.h"
 
@@ -237,7 +238,6 @@ void S_DrawScreenSprite(int sx, int sy, int sz, int scaleH, int scaleV, short sp
 
 void draw_scaled_spriteC(short* ptrObj) {
 #ifdef FEATURE_NOLEGACY_OPTIONS
-	extern int GetPitchSWR();
 	int pitch = GetPitchSWR();
 #else // FEATURE_NOLEGACY_OPTIONS
 	int pitch = PhdScreenWidth; // NOTE: this is the original game bug!
@@ -284,6 +284,17 @@ void draw_scaled_spriteC(short* ptrObj) {
 	CLAMPG(x2, PhdWinMaxX + 1);
 	CLAMPG(y2, PhdWinMaxY + 1);
 
+#ifdef FEATURE_NOLEGACY_OPTIONS
+	// Rows outside of the band of this thread are drawn by other threads
+	int bandY0 = PhdWinMinY + y1;
+	int bandY1 = PhdWinMinY + y2;
+	if (!ClipBandSWR(&bandY0, &bandY1))
+		return;
+	vBase += vAdd * (bandY0 - PhdWinMinY - y1);
+	y1 = bandY0 - PhdWinMinY;
+	y2 = bandY1 - PhdWinMinY;
+#endif // FEATURE_NOLEGACY_OPTIONS
+
 	width = x2 - x1;
 	height = y2 - y1;
 
@@ -122,7 +122,7 @@ int SearchLOT(LOT_INFO* LOT, int expansion)
 
 	for (int i = 0; i < expansion; i++)
 	{
-		if (LOT->head == -1)
+		if (LOT->head == (UINT16)-1)
 		{
 			LOT->tail = -1;
 			return 0;
@@ -139,7 +139,7 @@ int SearchLOT(LOT_INFO* LOT, int expansion)
 			if (box_number & END_BIT)
 			{
 				done = 1;
-				box_number &= 0xFFFF;
+				box_number &= ~END_BIT;
 			}
 
 			if (zone[LOT->head] != zone[box_number])
@@ -175,7 +175,7 @@ int SearchLOT(LOT_INFO* LOT, int expansion)
 				}
 			}
 
-			if (expand->nextExpansion == -1 && box_number != LOT->tail)
+			if (expand->nextExpansion == (UINT16)-1 && box_number != LOT->tail)
 			{
 				LOT->node[LOT->tail].nextExpansion = box_number;
 				LOT->tail = box_number;
@@ -189,6 +189,31 @@ int SearchLOT(LOT_INFO* LOT, int expansion)
 	return 1;
 }
 
+int UpdateLOT(LOT_INFO* LOT, int expansion)
+{
+	if (LOT->requiredBox != (UINT16)-1 && LOT->requiredBox != LOT->targetBox)
+	{
+		LOT->targetBox = LOT->requiredBox;
+		BOX_NODE* expand = &LOT->node[LOT->targetBox];
+		if (expand->nextExpansion == (UINT16)-1 && LOT->tail != LOT->targetBox)
+		{
+			expand->nextExpansion = LOT->head;
+			if (LOT->head == (UINT16)-1)
+				LOT->tail = LOT->targetBox;
+			LOT->head = LOT->targetBox;
+		}
+		expand->searchNumber = ++LOT->searchNumber;
+		expand->exitBox = -1;
+	}
+#ifdef FEATURE_PATH_SCHEDULER
+	// a new or pending search may be finished by the box graph or another creature
+	if (LOT->head != (UINT16)-1 && SharePathSearch(LOT))
+		return 0;
+	expansion = GetPathExpansion(LOT, expansion);
+#endif // FEATURE_PATH_SCHEDULER
+	return SearchLOT(LOT, expansion);
+}
+
 void TargetBox(LOT_INFO* LOT, UINT16 boxNumber)
 {
 	BOX_INFO* box = &Boxes[boxNumber];
@@ -224,7 +249,7 @@ void CreatureMood(ITEM_INFO* item, AI_INFO* ai, BOOL isViolent)
 	if (LOT->node[item->boxNumber].searchNumber == (LOT->searchNumber | 0x8000))
 		LOT->requiredBox = -1;
 
-	if (creature->mood != MOOD_ATTACK && LOT->requiredBox != -1)
+	if (creature->mood != MOOD_ATTACK && LOT->requiredBox != (UINT16)-1)
 	{
 		if (!ValidBox(item, ai->zoneNumber, LOT->targetBox))
 		{
@@ -324,7 +349,7 @@ void CreatureMood(ITEM_INFO* item, AI_INFO* ai, BOOL isViolent)
 				TargetBox(LOT, boxNumber);
 				creature->mood = MOOD_STALK;
 			}
-			else if (LOT->requiredBox == -1)
+			else if (LOT->requiredBox == (UINT16)-1)
 				TargetBox(LOT, boxNumber);
 		}
 		break;
@@ -339,7 +364,7 @@ void CreatureMood(ITEM_INFO* item, AI_INFO* ai, BOOL isViolent)
 				{
 					TargetBox(LOT, boxNumber);
 				}
-				else if (LOT->requiredBox == -1)
+				else if (LOT->requiredBox == (UINT16)-1)
 				{
 					TargetBox(LOT, boxNumber);
 					if (ai->zoneNumber != ai->enemyZone)
@@ -350,7 +375,7 @@ void CreatureMood(ITEM_INFO* item, AI_INFO* ai, BOOL isViolent)
 		break;
 	case MOOD_ESCAPE:
 		boxNumber = LOT->node[LOT->zoneCount * GetRandomControl() >> 15].boxNumber;
-		if (ValidBox(item, ai->zoneNumber, boxNumber) && LOT->requiredBox == -1)
+		if (ValidBox(item, ai->zoneNumber, boxNumber) && LOT->requiredBox == (UINT16)-1)
 		{
 			if (EscapeBox(item, enemy, boxNumber))
 			{
@@ -365,7 +390,7 @@ void CreatureMood(ITEM_INFO* item, AI_INFO* ai, BOOL isViolent)
 		break;
 	}
 
-	if (LOT->targetBox == -1)
+	if (LOT->targetBox == (UINT16)-1)
 		TargetBox(LOT, item->boxNumber);
 	CalculateTarget(&creature->target, item, LOT);
 }
@@ -849,10 +874,10 @@ void GetBaddieTarget(short creatureItemNumber, BaddieTargetType flags)
 		return;
 
 	bestdistance = 0x7FFFFFFF;
-	for (int i = 0; i < MAX_CREATURES; i++)
+	for (int slot = GetNextCreatureSlot(-1); slot >= 0; slot = GetNextCreatureSlot(slot))
 	{
-		baddy = &BaddiesSlots[i];
-		if (baddy->itemNumber == -1 || creatureItemNumber == baddy->itemNumber)
+		baddy = &BaddiesSlots[slot];
+		if (creatureItemNumber == baddy->itemNumber)
 			continue;
 
 		targetItem = &Items[baddy->itemNumber];
@@ -1011,7 +1036,7 @@ void Inject_Box() {
 	INJECT(0x0040E1C0, CreatureActive);
 	INJECT(0x0040E210, CreatureAIInfo);
 	INJECT(0x0040E470, SearchLOT);
-	//INJECT(0x0040E670, UpdateLOT);
+	INJECT(0x0040E670, UpdateLOT);
 	INJECT(0x0040E6E0, TargetBox);
 	//INJECT(0x0040E780, StalkBox);
 	//INJECT(0x0040E880, EscapeBox);
@@ -50,7 +50,8 @@ int CreatureActive(short itemNumber); // 0x0040E1C0
 void CreatureAIInfo(ITEM_INFO* item, AI_INFO* AI); // 0x0040E210
 int SearchLOT(LOT_INFO* LOT, int expansion); // 0x0040E470
 //#define SearchLOT ((int(__cdecl*)(LOT_INFO*,int)) 0x0040E470)
-#define UpdateLOT ((int(__cdecl*)(LOT_INFO*,int)) 0x0040E670)
+int UpdateLOT(LOT_INFO* LOT, int expansion); // 0x0040E670
+//#define UpdateLOT ((int(__cdecl*)(LOT_INFO*,int)) 0x0040E670)
 void TargetBox(LOT_INFO* LOT, UINT16 boxNum); // 0x0040E6E0
 #define StalkBox ((int(__cdecl*)(ITEM_INFO*,ITEM_INFO*,short)) 0x0040E780)
 #define EscapeBox ((int(__cdecl*)(ITEM_INFO*,ITEM_INFO*,short)) 0x0040E880)
@@ -27,21 +27,26 @@
 #include "game/effects.h"
 #include "game/draw.h"
 #include "game/hair.h"
+#include "game/interp.h"
 #include "game/items.h"
 #include "game/inventory.h"
 #include "game/laramisc.h"
 #include "game/traps.h"
 #include "game/lot.h"
+#include "game/particle.h"
 #include "game/moveblock.h"
 #include "game/pickup.h"
 #include "game/sound.h"
 #include "game/savegame.h"
+#include "game/weather.h"
+#include "game/visibility.h"
 #include "specific/game.h"
 #include "specific/input.h"
 #include "specific/smain.h"
 #include "specific/sndpc.h"
 #include "specific/winmain.h"
 #include "global/vars.h"
+#include "modding/profiler.h"
 
 #ifdef FEATURE_BACKGROUND_IMPROVED
 #include "modding/pause.h"
@@ -51,12 +56,61 @@
 #include "modding/joy_output.h"
 #endif // FEATURE_INPUT_IMPROVED
 
-int ControlPhase(int nTicks, BOOL demoMode) {
-	static int tickCount = 0;
+// The gameplay part of one tick: items, effects, Lara, camera and sounds.
+// NOTE: this is a part of ControlPhase in the original game. The benchmark
+// calls it too, and its callback times the subsystems one by one.
+void ControlTick(void (*markSubsystem)(CONTROL_SUBSYSTEM subsystem)) {
 	ITEM_INFO* item = NULL;
 	FX_INFO* fx = NULL;
 	int id = -1;
 	int next = -1;
+
+	DynamicLightCount = 0;
+#ifdef FEATURE_PATH_SCHEDULER
+	SchedulePathSearch();
+#endif // FEATURE_PATH_SCHEDULER
+
+	for (id = NextItemActive; id >= 0; id = next) {
+		item = &Items[id];
+		LogDebug("ControlPhase: animating item %d, objectId: %d", id, item->objectID);
+		// NOTE: there is no IFL_CLEARBODY check in the original code
+		if (Objects[item->objectID].control != NULL && !CHK_ANY(item->flags, IFL_CLEARBODY)) {
+			Objects[item->objectID].control(id);
+		}
+		next = item->nextActive;
+	}
+	if (markSubsystem != NULL) markSubsystem(CTRL_Items);
+
+	for (id = NextEffectActive; id >= 0; id = next) {
+		fx = &Effects[id];
+		if (Objects[fx->objectID].control != NULL) {
+			Objects[fx->objectID].control(id);
+		}
+		next = fx->nextActive;
+	}
+#ifdef FEATURE_PARTICLES
+	PARTICLE_Update();
+#endif // FEATURE_PARTICLES
+	if (markSubsystem != NULL) markSubsystem(CTRL_Effects);
+
+	LaraControl();
+	if (markSubsystem != NULL) markSubsystem(CTRL_Lara);
+	HairControl(FALSE);
+	if (markSubsystem != NULL) markSubsystem(CTRL_Hair);
+	CalculateCamera();
+	if (markSubsystem != NULL) markSubsystem(CTRL_Camera);
+	SoundEffects();
+	if (markSubsystem != NULL) markSubsystem(CTRL_Sound);
+	--HealthBarTimer;
+
+	// Update statistics timer for normal levels
+	if (CurrentLevel != 0 || IsAssaultTimerActive) {
+		++SaveGame.statistics.timer;
+	}
+}
+
+int ControlPhase(int nTicks, BOOL demoMode) {
+	static int tickCount = 0;
 	int result = 0;
 
 	CLAMPG(nTicks, 5 * TICKS_PER_FRAME);
@@ -158,36 +212,12 @@ int ControlPhase(int nTicks, BOOL demoMode) {
 		}
 #endif // FEATURE_BACKGROUND_IMPROVED
 
-		DynamicLightCount = 0;
-
-		for (id = NextItemActive; id >= 0; id = next) {
-			item = &Items[id];
-			LogDebug("ControlPhase: animating item %d, objectId: %d", id, item->objectID);
-			// NOTE: there is no IFL_CLEARBODY check in the original code
-			if (Objects[item->objectID].control != NULL && !CHK_ANY(item->flags, IFL_CLEARBODY)) {
-				Objects[item->objectID].control(id);
-			}
-			next = item->nextActive;
-		}
-
-		for (id = NextEffectActive; id >= 0; id = next) {
-			fx = &Effects[id];
-			if (Objects[fx->objectID].control != NULL) {
-				Objects[fx->objectID].control(id);
-			}
-			next = fx->nextActive;
-		}
-
-		LaraControl();
-		HairControl(FALSE);
-		CalculateCamera();
-		SoundEffects();
-		--HealthBarTimer;
-
-		// Update statistics timer for normal levels
-		if (CurrentLevel != 0 || IsAssaultTimerActive) {
-			++SaveGame.statistics.timer;
-		}
+#ifdef FEATURE_RENDER_INTERPOLATION
+		INTERP_SaveTick();
+#endif // FEATURE_RENDER_INTERPOLATION
+		PROF_BEGIN(PROF_Control);
+		ControlTick(NULL);
+		PROF_END(PROF_Control);
 	}
 #ifdef FEATURE_INPUT_IMPROVED
 	UpdateJoyOutput(!IsDemoLevelType);
@@ -1341,6 +1371,9 @@ void FlipMap()
 		memcpy(&temp, r, sizeof(ROOM_INFO));
 		memcpy(r, flipped, sizeof(ROOM_INFO));
 		memcpy(flipped, &temp, sizeof(ROOM_INFO));
+#ifdef FEATURE_VISIBILITY_CACHE
+		VIS_SwapRooms(i, (int)(flipped - Rooms));
+#endif // FEATURE_VISIBILITY_CACHE
 
 		r->flippedRoom = flipped->flippedRoom;
 		flipped->flippedRoom = -1;
@@ -1351,6 +1384,12 @@ void FlipMap()
 	}
 
 	FlipStatus = !FlipStatus;
+#ifdef FEATURE_PATH_SCHEDULER
+	InvalidatePathSearch();
+#endif // FEATURE_PATH_SCHEDULER
+#if defined(FEATURE_MOD_CONFIG)
+	WEATHER_BuildEmitters();
+#endif
 }
 
 void RemoveRoomFlipItems(ROOM_INFO* room)
@@ -24,10 +24,22 @@
 
 #include "global/types.h"
 
+// The subsystems of the gameplay tick, in their order
+typedef enum {
+	CTRL_Items,
+	CTRL_Effects,
+	CTRL_Lara,
+	CTRL_Hair,
+	CTRL_Camera,
+	CTRL_Sound,
+	CTRL_Count,
+} CONTROL_SUBSYSTEM;
+
  /*
   * Function list
   */
 
+void ControlTick(void (*markSubsystem)(CONTROL_SUBSYSTEM subsystem));
 int ControlPhase(int nTicks, BOOL demoMode); // 0x00414370
 void AnimateItem(ITEM_INFO* item); // 0x004146C0
 BOOL GetChange(ITEM_INFO* item, ANIM_STRUCT* anim); // 0x00414A30
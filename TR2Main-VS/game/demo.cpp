@@ -52,6 +52,35 @@ int DoDemoSequence(int levelID) {
 	return GF_DoLevelSequence(levelID, GFL_DEMO);
 }
 
+// Loads the level for its demo with the fixed seeds. The start of the level
+// is changed for the demo, so the caller has to keep a copy of it.
+// NOTE: this is a part of StartDemo in the original game
+BOOL InitialiseDemoLevel(int levelID) {
+	START_INFO* start = &SaveGame.start[levelID];
+	start->available = 1;
+	start->pistolAmmo = 1000;
+	start->gunStatus = LGS_Armless;
+	start->gunType = LGT_Pistols;
+	SeedRandomDraw(RANDOM_SEED);
+	SeedRandomControl(RANDOM_SEED);
+	IsTitleLoaded = FALSE;
+
+	if (!InitialiseLevel(levelID, GFL_DEMO)) {
+		return FALSE;
+	}
+	IsLevelComplete = FALSE;
+	return TRUE;
+}
+
+// Puts Lara to the demo start and seeds the random numbers again
+// NOTE: this is a part of StartDemo in the original game
+void BeginDemoPlayback() {
+	LoadLaraDemoPos();
+	LaraCheatGetStuff();
+	SeedRandomDraw(RANDOM_SEED);
+	SeedRandomControl(RANDOM_SEED);
+}
+
 int StartDemo(int levelID) {
 	static int DemoLevelID = 0;
 
@@ -71,30 +100,17 @@ int StartDemo(int levelID) {
 
 	START_INFO* start = &SaveGame.start[levelID];
 	START_INFO startBackup = *start;
-	start->available = 1;
-	start->pistolAmmo = 1000;
-	start->gunStatus = LGS_Armless;
-	start->gunType = LGT_Pistols;
-	SeedRandomDraw(RANDOM_SEED);
-	SeedRandomControl(RANDOM_SEED);
-	IsTitleLoaded = FALSE;
-
-	if (!InitialiseLevel(levelID, GFL_DEMO)) {
+	if (!InitialiseDemoLevel(levelID)) {
 		return GF_EXIT_GAME;
 	}
 
-	IsLevelComplete = FALSE;
-
 	if (!IsDemoLoaded) {
 		char str[64];
 		sprintf(str, "Level '%s' has no demo data!", GF_LevelFilesStringTable[levelID]);
 		S_ExitSystem(str);
 	}
 
-	LoadLaraDemoPos();
-	LaraCheatGetStuff();
-	SeedRandomDraw(RANDOM_SEED);
-	SeedRandomControl(RANDOM_SEED);
+	BeginDemoPlayback();
 
 #ifdef FEATURE_HUD_IMPROVED
 	TEXT_STR_INFO* bottomText = NULL;
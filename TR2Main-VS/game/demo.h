@@ -31,5 +31,7 @@ int DoDemoSequence(int levelID); // 0x004168E0
 int StartDemo(int levelID); // 0x00416940
 void LoadLaraDemoPos(); // 0x00416AF0
 void GetDemoInput(); // 0x00416BC0
+BOOL InitialiseDemoLevel(int levelID);
+void BeginDemoPlayback();
 
 #endif // DEMO_H_INCLUDED
@@ -27,11 +27,16 @@
 #include "game/laraswim.h"
 #include "game/hair.h"
 #include "game/health.h"
+#include "game/interp.h"
 #include "game/weather.h"
+#include "game/particle.h"
+#include "game/visibility.h"
 #include "game/secrets.h"
 #include "specific/game.h"
 #include "specific/output.h"
+#include "specific/utils.h"
 #include "global/vars.h"
+#include "modding/profiler.h"
 
 #if defined(FEATURE_MOD_CONFIG)
 #include "modding/mod_utils.h"
@@ -63,13 +68,87 @@ int DrawPhaseCinematic()
 	return Camera.numberFrames;
 }
 
+#ifdef FEATURE_RENDER_INTERPOLATION
+// The frames are drawn until the next game tick is due, each one blends the
+// last two ticks by the time passed since the previous tick. The first frame
+// updates the HUD counters as usual, the extra frames don't touch them, and
+// the textures are animated once for the whole tick. The frame rate is capped
+// by RenderFrameLimit (or the display refresh rate), the pacer sleeps between
+// the extra frames instead of drawing the same blend again and again.
+#ifdef FEATURE_FRAME_PACER
+static double GetFrameTicks()
+{
+	DEVMODE devMode;
+	DWORD frameLimit = RenderFrameLimit;
+
+	if (frameLimit == 0) {
+		memset(&devMode, 0, sizeof(devMode));
+		devMode.dmSize = sizeof(devMode);
+		if (EnumDisplaySettings(NULL, ENUM_CURRENT_SETTINGS, &devMode) && devMode.dmDisplayFrequency > 1) {
+			frameLimit = devMode.dmDisplayFrequency;
+		} else {
+			frameLimit = 60;
+		}
+	}
+	CLAMP(frameLimit, FRAMES_PER_SECOND, 1000);
+	return (double)TICKS_PER_SECOND / (double)frameLimit;
+}
+#endif // FEATURE_FRAME_PACER
+
+static int DrawPhaseGameInterpolated()
+{
+	int numberFrames = Camera.numberFrames;
+	bool extraFrame = false;
+#ifdef FEATURE_FRAME_PACER
+	double frameTicks = GetFrameTicks();
+#endif // FEATURE_FRAME_PACER
+
+	while (true) {
+		double ticks = PeekTicks();
+		int blend = (ticks < TICKS_PER_FRAME) ? (int)(ticks * PHD_ONE / TICKS_PER_FRAME) : PHD_ONE;
+		Camera.numberFrames = extraFrame ? 0 : numberFrames;
+		DrawRooms(INTERP_BeginFrame(blend, extraFrame));
+		DrawGameInfo(TRUE);
+		S_OutputPolyList();
+		INTERP_EndFrame();
+		if (PeekTicks() >= TICKS_PER_FRAME) {
+			break;
+		}
+		PROF_BEGIN(PROF_Present);
+		ScreenPartialDump();
+		PROF_END(PROF_Present);
+#ifdef FEATURE_PROFILER
+		PROF_EndFrame();
+#endif // FEATURE_PROFILER
+#ifdef FEATURE_FRAME_PACER
+		SyncFrameTicks(MIN(ticks + frameTicks, (double)TICKS_PER_FRAME));
+#endif // FEATURE_FRAME_PACER
+		extraFrame = true;
+	}
+	Camera.numberFrames = S_DumpScreen();
+	S_AnimateTextures(Camera.numberFrames);
+#ifdef FEATURE_PROFILER
+	PROF_EndFrame();
+#endif // FEATURE_PROFILER
+	return Camera.numberFrames;
+}
+#endif // FEATURE_RENDER_INTERPOLATION
+
 int DrawPhaseGame()
 {
+#ifdef FEATURE_RENDER_INTERPOLATION
+	if (RenderInterpolation) {
+		return DrawPhaseGameInterpolated();
+	}
+#endif // FEATURE_RENDER_INTERPOLATION
 	DrawRooms(Camera.pos.roomNumber);
 	DrawGameInfo(TRUE);
 	S_OutputPolyList();
 	Camera.numberFrames = S_DumpScreen();
 	S_AnimateTextures(Camera.numberFrames);
+#ifdef FEATURE_PROFILER
+	PROF_EndFrame();
+#endif // FEATURE_PROFILER
 	return Camera.numberFrames;
 }
 
@@ -102,7 +181,20 @@ void DrawRooms(short currentRoom) {
 	}
 
 	UnderwaterCamera = room->flags & ROOM_UNDERWATER;
+	PROF_BEGIN(PROF_RoomBounds);
+#ifdef FEATURE_VISIBILITY_CACHE
+	if (!VIS_RestoreRoomBounds(currentRoom)) {
+		GetRoomBounds();
+		VIS_StoreRoomBounds(currentRoom);
+	}
+#else // FEATURE_VISIBILITY_CACHE
 	GetRoomBounds();
+#endif // FEATURE_VISIBILITY_CACHE
+	PROF_END(PROF_RoomBounds);
+#if defined(FEATURE_VISIBILITY_CACHE) && defined(FEATURE_PROFILER)
+	PROF_SetCounter(PROF_VisibleRooms, VIS_GetStats()->visibleRooms);
+	PROF_SetCounter(PROF_PortalTests, VIS_GetStats()->portalTests);
+#endif // defined(FEATURE_VISIBILITY_CACHE) && defined(FEATURE_PROFILER)
 	MidSort = 0;
 
 	// Draw Skybox
@@ -141,6 +233,7 @@ void DrawRooms(short currentRoom) {
 	}
 
 	// Draw Lara
+	PROF_BEGIN(PROF_Objects);
 	if (Objects[ID_LARA].loaded && !(LaraItem->flags & IFL_ONESHOT)) {
 		if (Rooms[LaraItem->roomNumber].flags & ROOM_UNDERWATER) {
 			S_SetupBelowWater(UnderwaterCamera);
@@ -151,13 +244,19 @@ void DrawRooms(short currentRoom) {
 		MidSort = Rooms[LaraItem->roomNumber].boundActive >> 8;
 		if (MidSort) --MidSort;
 #if defined(FEATURE_VIDEOFX_IMPROVED)
-		if (Lara.mesh_effects) {
-			if (GoldenLaraAlpha < 0xFF) GoldenLaraAlpha += 8;
-			CLAMPG(GoldenLaraAlpha, 0xFF);
-		}
-		else {
-			if (GoldenLaraAlpha > 0) GoldenLaraAlpha -= 8;
-			CLAMPL(GoldenLaraAlpha, 0);
+#ifdef FEATURE_RENDER_INTERPOLATION
+		// the golden fade steps once per game tick, the extra frames keep it
+		if (!INTERP_IsExtraFrame())
+#endif // FEATURE_RENDER_INTERPOLATION
+		{
+			if (Lara.mesh_effects) {
+				if (GoldenLaraAlpha < 0xFF) GoldenLaraAlpha += 8;
+				CLAMPG(GoldenLaraAlpha, 0xFF);
+			}
+			else {
+				if (GoldenLaraAlpha > 0) GoldenLaraAlpha -= 8;
+				CLAMPL(GoldenLaraAlpha, 0);
+			}
 		}
 		if (GoldenLaraAlpha) {
 			// NOTE: this is dirty trick for Golden Lara while Dozy cheat mode.
@@ -175,20 +274,29 @@ void DrawRooms(short currentRoom) {
 #endif // FEATURE_VIDEOFX_IMPROVED
 	}
 
+	PROF_END(PROF_Objects);
+
 	// Draw rooms
+	PROF_BEGIN(PROF_Rooms);
 	for (int i = 0; i < DrawRoomsCount; ++i) {
 		PrintRooms(DrawRoomsArray[i]);
 	}
+	PROF_END(PROF_Rooms);
 
 	// Draw movable and static objects
+	PROF_BEGIN(PROF_Objects);
 	for (int i = 0; i < DrawRoomsCount; ++i) {
 		PrintObjects(DrawRoomsArray[i]);
 	}
+#ifdef FEATURE_PARTICLES
+	PARTICLE_Draw();
+#endif // FEATURE_PARTICLES
 
 #if defined(FEATURE_MOD_CONFIG)
 	WEATHER_UpdateAndDrawRain();
 	WEATHER_UpdateAndDrawSnow();
 #endif
+	PROF_END(PROF_Objects);
 
 #ifdef FEATURE_VIEW_IMPROVED
 	for (int i = 0; i < DrawRoomsCount; ++i) {
@@ -227,6 +335,9 @@ void GetRoomBounds() {
 		}
 
 		if (!room->doors) continue;
+#ifdef FEATURE_VISIBILITY_CACHE
+		if (VIS_SetDoorsBounds(roomNumber)) continue;
+#endif // FEATURE_VISIBILITY_CACHE
 		phd_PushMatrix();
 		phd_TranslateAbs(room->x, room->y, room->z);
 		for (int i = 0; i < room->doors->wCount; ++i) {
@@ -253,6 +364,18 @@ void SetRoomBounds(short* ptrObj, int roomNumber, ROOM_INFO* parent) {
 	}
 
 	PHD_VECTOR view[4];
+	for (int i = 0; i < 4; ++i) {
+		ptrObj += 3;
+		PHD_MATRIX* m = PhdMatrixPtr;
+		view[i].x = ptrObj[0] * m->_00 + ptrObj[1] * m->_01 + ptrObj[2] * m->_02 + m->_03;
+		view[i].y = ptrObj[0] * m->_10 + ptrObj[1] * m->_11 + ptrObj[2] * m->_12 + m->_13;
+		view[i].z = ptrObj[0] * m->_20 + ptrObj[1] * m->_21 + ptrObj[2] * m->_22 + m->_23;
+	}
+	ClipRoomBounds(view, roomNumber, parent);
+}
+
+void ClipRoomBounds(PHD_VECTOR* view, int roomNumber, ROOM_INFO* parent) {
+	ROOM_INFO* room = &Rooms[roomNumber];
 	int left = parent->right;
 	int right = parent->left;
 	int top = parent->bottom;
@@ -261,11 +384,9 @@ void SetRoomBounds(short* ptrObj, int roomNumber, ROOM_INFO* parent) {
 	int tooNear = 0;
 
 	for (int i = 0; i < 4; ++i) {
-		ptrObj += 3;
-		PHD_MATRIX* m = PhdMatrixPtr;
-		int x = view[i].x = ptrObj[0] * m->_00 + ptrObj[1] * m->_01 + ptrObj[2] * m->_02 + m->_03;
-		int y = view[i].y = ptrObj[0] * m->_10 + ptrObj[1] * m->_11 + ptrObj[2] * m->_12 + m->_13;
-		int z = view[i].z = ptrObj[0] * m->_20 + ptrObj[1] * m->_21 + ptrObj[2] * m->_22 + m->_23;
+		int x = view[i].x;
+		int y = view[i].y;
+		int z = view[i].z;
 		if (z <= 0) {
 			++tooNear;
 			continue;
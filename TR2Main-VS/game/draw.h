@@ -32,6 +32,7 @@ int DrawPhaseGame(); // 0x00418960
 void DrawRooms(short currentRoom); // 0x004189A0
 void GetRoomBounds(); // 0x00418C50
 void SetRoomBounds(short* ptrObj, int roomNumber, ROOM_INFO* parent); // 0x00418E20
+void ClipRoomBounds(PHD_VECTOR* view, int roomNumber, ROOM_INFO* parent);
 void ClipRoom(ROOM_INFO* room); // 0x004191A0
 void PrintRooms(short roomNumber); // 0x00419580
 void PrintObjects(short roomNumber); // 0x00419640
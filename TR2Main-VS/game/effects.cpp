@@ -29,6 +29,7 @@
 #include "game/hair.h"
 #include "game/invtext.h"
 #include "game/items.h"
+#include "game/particle.h"
 #include "game/sound.h"
 #include "game/sphere.h"
 #include "specific/init_sound_xaudio.h"
@@ -70,6 +71,11 @@ short DoBloodSplat(int x, int y, int z, short speed, short direction, short room
 	short fxID;
 	FX_INFO* fx;
 
+#ifdef FEATURE_PARTICLES
+	// NOTE: the pooled blood has no effect number, the callers only check it against -1
+	if (PARTICLE_AddBlood(x, y, z, speed, direction, roomID))
+		return 0;
+#endif // FEATURE_PARTICLES
 	fxID = CreateEffect(roomID);
 	if (fxID != -1) {
 		fx = &Effects[fxID];
@@ -134,6 +140,18 @@ void ControlExplosion1(short fxID) {
 }
 
 void Richochet(GAME_VECTOR* pos) {
+	// the random frame is drawn once, for whichever path runs
+	short frame = -3 * GetRandomDraw() / 0x8000;
+#ifdef FEATURE_PARTICLES
+	if (PARTICLE_AddRicochet(pos->x, pos->y, pos->z, frame, pos->roomNumber)) {
+		PHD_3DPOS soundPos = {};
+		soundPos.x = pos->x;
+		soundPos.y = pos->y;
+		soundPos.z = pos->z;
+		PlaySoundEffect(10, &soundPos, 0);
+		return;
+	}
+#endif // FEATURE_PARTICLES
 	short fxID = CreateEffect(pos->roomNumber);
 	if (fxID < 0) {
 		return;
@@ -144,7 +162,7 @@ void Richochet(GAME_VECTOR* pos) {
 	fx->pos.z = pos->z;
 	fx->counter = 4;
 	fx->objectID = ID_RICOCHET;
-	fx->frameNumber = -3 * GetRandomDraw() / 0x8000;
+	fx->frameNumber = frame;
 	PlaySoundEffect(10, &fx->pos, 0);
 }
 
@@ -157,24 +175,36 @@ void ControlRichochet1(short fxID) {
 
 void CreateBubbleVec(PHD_VECTOR* pos, short roomNumber)
 {
+	short speed = ((GetRandomDraw() * 6) >> 15) + 10;
+	short frame = -((GetRandomDraw() * 3) >> 15);
+#ifdef FEATURE_PARTICLES
+	if (PARTICLE_AddBubble(pos->x, pos->y, pos->z, 0, 0, speed, frame, roomNumber))
+		return;
+#endif // FEATURE_PARTICLES
 	short fxID = CreateEffect(roomNumber);
 	if (fxID < 0) return;
 	FX_INFO* fx = &Effects[fxID];
 	fx->pos.x = pos->x;
 	fx->pos.y = pos->y;
 	fx->pos.z = pos->z;
-	fx->speed = ((GetRandomDraw() * 6) >> 15) + 10;
-	fx->frameNumber = -((GetRandomDraw() * 3) >> 15);
+	fx->speed = speed;
+	fx->frameNumber = frame;
 	fx->objectID = ID_BUBBLES;
 }
 
 void CreateBubble(PHD_3DPOS* pos, short roomNumber) {
+	short speed = ((GetRandomDraw() * 6) >> 15) + 10;
+	short frame = -((GetRandomDraw() * 3) >> 15);
+#ifdef FEATURE_PARTICLES
+	if (PARTICLE_AddBubble(pos->x, pos->y, pos->z, pos->rotX, pos->rotY, speed, frame, roomNumber))
+		return;
+#endif // FEATURE_PARTICLES
 	short fxID = CreateEffect(roomNumber);
 	if (fxID < 0) return;
 	FX_INFO* fx = &Effects[fxID];
 	fx->pos = *pos;
-	fx->speed = ((GetRandomDraw() * 6) >> 15) + 10;
-	fx->frameNumber = -((GetRandomDraw() * 3) >> 15);
+	fx->speed = speed;
+	fx->frameNumber = frame;
 	fx->objectID = ID_BUBBLES;
 }
 
@@ -244,16 +274,22 @@ void Splash2(ITEM_INFO* item, int waterHeight)
 	short roomID = item->roomNumber;
 	GetFloor(item->pos.x, item->pos.y, item->pos.z, &roomID);
 	for (int i = 0; i < 10; ++i) {
+		short rotY = (2 * GetRandomDraw()) - ANGLE(180);
+		short speed = GetRandomDraw() / 256;
+#ifdef FEATURE_PARTICLES
+		if (PARTICLE_AddSplash(0, item->pos.x, waterHeight, item->pos.z, speed, rotY, 256, roomID))
+			continue;
+#endif // FEATURE_PARTICLES
 		short fxID = CreateEffect(roomID);
 		if (fxID != -1) {
 			FX_INFO* fx = &Effects[fxID];
 			fx->pos.x = item->pos.x;
 			fx->pos.y = waterHeight;
 			fx->pos.z = item->pos.z;
-			fx->pos.rotY = (2 * GetRandomDraw()) - ANGLE(180);
+			fx->pos.rotY = rotY;
 			fx->frameNumber = 0;
 			fx->objectID = ID_SPLASH;
-			fx->speed = GetRandomDraw() / 256;
+			fx->speed = speed;
 			fx->scale = 256;
 		}
 	}
@@ -272,6 +308,10 @@ void CreateSplash(int x, int y, int z, short roomNumber)
 	GetFloor(x, y, z, &roomID);
 	if (!(Rooms[roomID].flags & ROOM_UNDERWATER))
 		return;
+#ifdef FEATURE_PARTICLES
+	if (PARTICLE_AddSplash(0, x, waterHeight, z, 0, 0, 256, roomID))
+		return;
+#endif // FEATURE_PARTICLES
 	short fxID = CreateEffect(roomID);
 	if (fxID != -1) {
 		fx = &Effects[fxID];
@@ -288,6 +328,10 @@ void CreateSplash(int x, int y, int z, short roomNumber)
 
 void CreateRainSpash(DWORD color, int x, int y, int z, short scale, short roomNumber)
 {
+#ifdef FEATURE_PARTICLES
+	if (PARTICLE_AddSplash(color, x, y, z, 0, 0, scale, roomNumber))
+		return;
+#endif // FEATURE_PARTICLES
 	short fxID = CreateEffect(roomNumber);
 	if (fxID != -1) {
 		auto* fx = &Effects[fxID];
@@ -290,6 +290,10 @@ int GF_InterpretSequence(short* seq, GF_LEVEL_TYPE levelType, int seqType) {
 
 		case GFE_LEVCOMPLETE:
 			if (levelType != GFL_STORY && levelType != GFL_MIDSTORY) {
+				// NOTE: the next level file is read ahead while the statistics are shown
+				if (CurrentLevel + 1 < GF_GameFlow.num_Levels) {
+					S_PreloadLevelFile(GF_LevelFilesStringTable[CurrentLevel + 1]);
+				}
 				if (LevelStats(CurrentLevel)) {
 					return GF_EXIT_TO_TITLE;
 				}
@@ -22,6 +22,7 @@
 #include "precompiled.h"
 #include "game/health.h"
 #include "3dsystem/scalespr.h"
+#include "game/interp.h"
 #include "game/text.h"
 #include "game/secrets.h"
 #include "specific/output.h"
@@ -43,6 +44,12 @@ BOOL FlashIt() {
 	static int counter = 0;
 	static BOOL state = FALSE;
 
+#ifdef FEATURE_RENDER_INTERPOLATION
+	// the interpolated frames must not speed up the flashing
+	if (INTERP_IsExtraFrame()) {
+		return state;
+	}
+#endif // FEATURE_RENDER_INTERPOLATION
 	if (counter > 0) {
 		--counter;
 	}
@@ -287,6 +294,9 @@ void DrawAmmoInfo() {
 
 void DrawPickups(BOOL pickupState) {
 	static int oldGameTimer = 0;
+#ifdef FEATURE_RENDER_INTERPOLATION
+	static int oldTime = 0;
+#endif // FEATURE_RENDER_INTERPOLATION
 	int time;
 	int x, y;
 	int cellH, cellV;
@@ -294,6 +304,15 @@ void DrawPickups(BOOL pickupState) {
 
 	time = SaveGame.statistics.timer - oldGameTimer;
 	oldGameTimer = SaveGame.statistics.timer;
+#ifdef FEATURE_RENDER_INTERPOLATION
+	// the game timer is not changed between the interpolated frames,
+	// so they draw the pickups of the last tick without counting them down
+	if (INTERP_IsExtraFrame()) {
+		time = oldTime;
+		pickupState = FALSE;
+	}
+	oldTime = time;
+#endif // FEATURE_RENDER_INTERPOLATION
 	if (time <= 0 || time >= 60) // 0..2 seconds
 		return;
 
@@ -364,7 +383,11 @@ void DisplayModeInfo(char* modeString) {
 }
 
 void DrawModeInfo() {
+#ifdef FEATURE_RENDER_INTERPOLATION
+	if (DisplayModeTextInfo != NULL && !INTERP_IsExtraFrame() && --DisplayModeInfoTimer == 0) {
+#else // !FEATURE_RENDER_INTERPOLATION
 	if (DisplayModeTextInfo != NULL && --DisplayModeInfoTimer == 0) {
+#endif // FEATURE_RENDER_INTERPOLATION
 		T_RemovePrint(DisplayModeTextInfo);
 		DisplayModeTextInfo = NULL;
 	}
@@ -0,0 +1,243 @@
+#include "precompiled.h"
+#include "interp.h"
+#include "3dsystem/3d_gen.h"
+#include "game/control.h"
+#include "global/vars.h"
+
+#ifdef FEATURE_RENDER_INTERPOLATION
+
+// The game logic still runs at 30 ticks per second, but the game phase may
+// present several frames per tick. Before each tick the poses of the items and
+// effects in the rooms, Lara's braid and the last view passed to phd_LookAt
+// are stored. A frame blends the stored poses with the current ones, draws the
+// scene and puts the current poses back, so the control code never sees the
+// blended values. If an item or the camera moved further than
+// INTERP_MAX_DISTANCE within one tick, it was teleported (or the item slot was
+// reused), so the current pose is drawn as is.
+#define INTERP_MAX_DISTANCE (WALL_SIZE)
+
+typedef struct InterpPose_t {
+	PHD_3DPOS prev;
+	PHD_3DPOS cur;
+	DWORD tick;
+	UINT16 objectID;
+} INTERP_POSE;
+
+typedef struct InterpView_t {
+	int xsrc, ysrc, zsrc;
+	int xtar, ytar, ztar;
+	short roll;
+	PHD_MATRIX matrix;
+	bool valid;
+} INTERP_VIEW;
+
+bool RenderInterpolation = false;
+DWORD RenderFrameLimit = 0; // frames per second, 0 means the display refresh rate
+
+static INTERP_POSE ItemPoses[NUMBER_ITEMS];
+static INTERP_POSE EffectPoses[MAX_EFFECTS];
+static short AppliedItems[NUMBER_ITEMS];
+static short AppliedEffects[MAX_EFFECTS];
+static int AppliedItemsCount = 0;
+static int AppliedEffectsCount = 0;
+
+static PHD_3DPOS HairPrev[7];
+static PHD_3DPOS HairCur[7];
+static bool HairApplied = false;
+
+static INTERP_VIEW PrevView;
+static INTERP_VIEW CurView;
+static PHD_MATRIX SavedW2V;
+static PHD_VECTOR SavedCamPos;
+static bool ViewApplied = false;
+static bool ViewBlending = false;
+
+static DWORD InterpTick = 0;
+static bool ExtraFrame = false;
+
+static inline int INTERP_Lerp(int prev, int cur, int blend)
+{
+	return prev + (int)(((__int64)(cur - prev) * blend) >> 16);
+}
+
+static inline short INTERP_LerpAngle(short prev, short cur, int blend)
+{
+	return prev + (short)(((int)(short)(cur - prev) * blend) >> 16);
+}
+
+static inline bool INTERP_IsTeleported(int dx, int dy, int dz)
+{
+	return ABS(dx) > INTERP_MAX_DISTANCE || ABS(dy) > INTERP_MAX_DISTANCE || ABS(dz) > INTERP_MAX_DISTANCE;
+}
+
+static bool INTERP_BlendPos(PHD_3DPOS* pos, const PHD_3DPOS* prev, int blend)
+{
+	if (INTERP_IsTeleported(pos->x - prev->x, pos->y - prev->y, pos->z - prev->z))
+		return false;
+
+	pos->x = INTERP_Lerp(prev->x, pos->x, blend);
+	pos->y = INTERP_Lerp(prev->y, pos->y, blend);
+	pos->z = INTERP_Lerp(prev->z, pos->z, blend);
+	pos->rotX = INTERP_LerpAngle(prev->rotX, pos->rotX, blend);
+	pos->rotY = INTERP_LerpAngle(prev->rotY, pos->rotY, blend);
+	pos->rotZ = INTERP_LerpAngle(prev->rotZ, pos->rotZ, blend);
+	return true;
+}
+
+void INTERP_Reset()
+{
+	++InterpTick;
+	PrevView.valid = false;
+	CurView.valid = false;
+}
+
+void INTERP_SaveTick()
+{
+	if (!RenderInterpolation)
+		return;
+
+	++InterpTick;
+	for (int i = 0; i < RoomCount; ++i)
+	{
+		for (short id = Rooms[i].itemNumber; id >= 0; id = Items[id].nextItem)
+		{
+			INTERP_POSE* pose = &ItemPoses[id];
+			pose->prev = Items[id].pos;
+			pose->objectID = Items[id].objectID;
+			pose->tick = InterpTick;
+		}
+		for (short id = Rooms[i].fxNumber; id >= 0; id = Effects[id].nextFx)
+		{
+			INTERP_POSE* pose = &EffectPoses[id];
+			pose->prev = Effects[id].pos;
+			pose->objectID = Effects[id].objectID;
+			pose->tick = InterpTick;
+		}
+	}
+	memcpy(HairPrev, HairPos, sizeof(HairPrev));
+	PrevView = CurView;
+}
+
+void INTERP_RecordView(int xsrc, int ysrc, int zsrc, int xtar, int ytar, int ztar, short roll)
+{
+	if (ViewBlending)
+		return;
+
+	CurView.xsrc = xsrc;
+	CurView.ysrc = ysrc;
+	CurView.zsrc = zsrc;
+	CurView.xtar = xtar;
+	CurView.ytar = ytar;
+	CurView.ztar = ztar;
+	CurView.roll = roll;
+	CurView.matrix = MatrixW2V;
+	CurView.valid = true;
+}
+
+static short INTERP_BlendView(int blend)
+{
+	short roomNumber = Camera.pos.roomNumber;
+
+	// The current view must be the one recorded by phd_LookAt at the end of
+	// the tick, otherwise the matrix was generated by some other code
+	if (!PrevView.valid || !CurView.valid
+		|| memcmp(&CurView.matrix, &MatrixW2V, sizeof(PHD_MATRIX))
+		|| INTERP_IsTeleported(CurView.xsrc - PrevView.xsrc, CurView.ysrc - PrevView.ysrc, CurView.zsrc - PrevView.zsrc))
+	{
+		return roomNumber;
+	}
+
+	int x = INTERP_Lerp(PrevView.xsrc, CurView.xsrc, blend);
+	int y = INTERP_Lerp(PrevView.ysrc, CurView.ysrc, blend);
+	int z = INTERP_Lerp(PrevView.zsrc, CurView.zsrc, blend);
+	SavedW2V = MatrixW2V;
+	SavedCamPos = CamPos;
+	ViewBlending = true;
+	phd_LookAt(x, y, z,
+		INTERP_Lerp(PrevView.xtar, CurView.xtar, blend),
+		INTERP_Lerp(PrevView.ytar, CurView.ytar, blend),
+		INTERP_Lerp(PrevView.ztar, CurView.ztar, blend),
+		INTERP_LerpAngle(PrevView.roll, CurView.roll, blend));
+	ViewBlending = false;
+	ViewApplied = true;
+
+	// The blended camera may still be in the previous room
+	GetFloor(x, y, z, &roomNumber);
+	return roomNumber;
+}
+
+short INTERP_BeginFrame(int blend, bool extraFrame)
+{
+	ExtraFrame = extraFrame;
+	AppliedItemsCount = 0;
+	AppliedEffectsCount = 0;
+	HairApplied = false;
+	ViewApplied = false;
+	if (blend >= PHD_ONE)
+		return Camera.pos.roomNumber;
+
+	for (int i = 0; i < RoomCount; ++i)
+	{
+		for (short id = Rooms[i].itemNumber; id >= 0; id = Items[id].nextItem)
+		{
+			INTERP_POSE* pose = &ItemPoses[id];
+			if (pose->tick != InterpTick || pose->objectID != Items[id].objectID)
+				continue;
+			pose->cur = Items[id].pos;
+			if (INTERP_BlendPos(&Items[id].pos, &pose->prev, blend))
+				AppliedItems[AppliedItemsCount++] = id;
+		}
+		for (short id = Rooms[i].fxNumber; id >= 0; id = Effects[id].nextFx)
+		{
+			INTERP_POSE* pose = &EffectPoses[id];
+			if (pose->tick != InterpTick || pose->objectID != Effects[id].objectID)
+				continue;
+			pose->cur = Effects[id].pos;
+			if (INTERP_BlendPos(&Effects[id].pos, &pose->prev, blend))
+				AppliedEffects[AppliedEffectsCount++] = id;
+		}
+	}
+
+	memcpy(HairCur, HairPos, sizeof(HairCur));
+	for (int i = 0; i < 7; ++i)
+	{
+		if (INTERP_BlendPos(&HairPos[i], &HairPrev[i], blend))
+			HairApplied = true;
+	}
+	return INTERP_BlendView(blend);
+}
+
+void INTERP_EndFrame()
+{
+	for (int i = 0; i < AppliedItemsCount; ++i)
+	{
+		short id = AppliedItems[i];
+		Items[id].pos = ItemPoses[id].cur;
+	}
+	for (int i = 0; i < AppliedEffectsCount; ++i)
+	{
+		short id = AppliedEffects[i];
+		Effects[id].pos = EffectPoses[id].cur;
+	}
+	if (HairApplied)
+		memcpy(HairPos, HairCur, sizeof(HairCur));
+	if (ViewApplied)
+	{
+		MatrixW2V = SavedW2V;
+		MatrixStack[0] = SavedW2V;
+		PhdMatrixPtr = &MatrixStack[0];
+		CamPos = SavedCamPos;
+	}
+	AppliedItemsCount = 0;
+	AppliedEffectsCount = 0;
+	HairApplied = false;
+	ViewApplied = false;
+	ExtraFrame = false;
+}
+
+bool INTERP_IsExtraFrame()
+{
+	return ExtraFrame;
+}
+
+#endif // FEATURE_RENDER_INTERPOLATION
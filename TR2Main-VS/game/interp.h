@@ -0,0 +1,11 @@
+#pragma once
+
+extern bool RenderInterpolation;
+extern DWORD RenderFrameLimit;
+
+extern void INTERP_Reset();
+extern void INTERP_SaveTick();
+extern void INTERP_RecordView(int xsrc, int ysrc, int zsrc, int xtar, int ytar, int ztar, short roll);
+extern short INTERP_BeginFrame(int blend, bool extraFrame);
+extern void INTERP_EndFrame();
+extern bool INTERP_IsExtraFrame();
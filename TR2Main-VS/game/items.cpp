@@ -21,8 +21,135 @@
 
 #include "precompiled.h"
 #include "game/items.h"
+#include "game/particle.h"
 #include "global/vars.h"
 
+// The item and effect lists stay singly linked in the original structures,
+// the original code and the savegames depend on it. The previous links are
+// kept aside, so the unlinking doesn't walk the list. A previous link is
+// used only if it still points to the item, otherwise the list was changed
+// by some other code, and it is walked as before.
+static short ItemPrevActive[NUMBER_ITEMS];
+static short ItemPrevDrawn[NUMBER_ITEMS];
+static short EffectPrevActive[MAX_EFFECTS];
+static short EffectPrevDrawn[MAX_EFFECTS];
+
+static void UnlinkActiveItem(short itemNumber)
+{
+	ITEM_INFO* item = &Items[itemNumber];
+	short prev = ItemPrevActive[itemNumber];
+
+	if (prev < 0 ? NextItemActive != itemNumber : (!Items[prev].active || Items[prev].nextActive != itemNumber))
+	{
+		prev = -1;
+		if (NextItemActive != itemNumber)
+		{
+			for (prev = NextItemActive; prev != -1 && Items[prev].nextActive != itemNumber; prev = Items[prev].nextActive);
+			if (prev == -1)
+				return;
+		}
+	}
+
+	if (prev < 0)
+		NextItemActive = item->nextActive;
+	else
+		Items[prev].nextActive = item->nextActive;
+	if (item->nextActive >= 0)
+		ItemPrevActive[item->nextActive] = prev;
+}
+
+static void UnlinkDrawnItem(short itemNumber)
+{
+	ITEM_INFO* item = &Items[itemNumber];
+	ROOM_INFO* room = &Rooms[item->roomNumber];
+	short prev = ItemPrevDrawn[itemNumber];
+
+	if (prev < 0 ? room->itemNumber != itemNumber : (Items[prev].roomNumber != item->roomNumber || Items[prev].nextItem != itemNumber))
+	{
+		prev = -1;
+		if (room->itemNumber != itemNumber)
+		{
+			for (prev = room->itemNumber; prev != -1 && Items[prev].nextItem != itemNumber; prev = Items[prev].nextItem);
+			if (prev == -1)
+				return;
+		}
+	}
+
+	if (prev < 0)
+		room->itemNumber = item->nextItem;
+	else
+		Items[prev].nextItem = item->nextItem;
+	if (item->nextItem >= 0)
+		ItemPrevDrawn[item->nextItem] = prev;
+}
+
+static void LinkDrawnItem(short itemNumber, ROOM_INFO* room)
+{
+	Items[itemNumber].nextItem = room->itemNumber;
+	ItemPrevDrawn[itemNumber] = -1;
+	if (room->itemNumber >= 0)
+		ItemPrevDrawn[room->itemNumber] = itemNumber;
+	room->itemNumber = itemNumber;
+}
+
+static void UnlinkActiveEffect(short fxNum)
+{
+	FX_INFO* fx = &Effects[fxNum];
+	short prev = EffectPrevActive[fxNum];
+
+	if (prev < 0 ? NextEffectActive != fxNum : Effects[prev].nextActive != fxNum)
+	{
+		prev = -1;
+		if (NextEffectActive != fxNum)
+		{
+			for (prev = NextEffectActive; prev != -1 && Effects[prev].nextActive != fxNum; prev = Effects[prev].nextActive);
+			if (prev == -1)
+				return;
+		}
+	}
+
+	if (prev < 0)
+		NextEffectActive = fx->nextActive;
+	else
+		Effects[prev].nextActive = fx->nextActive;
+	if (fx->nextActive >= 0)
+		EffectPrevActive[fx->nextActive] = prev;
+}
+
+static void UnlinkDrawnEffect(short fxNum)
+{
+	FX_INFO* fx = &Effects[fxNum];
+	ROOM_INFO* room = &Rooms[fx->roomNumber];
+	short prev = EffectPrevDrawn[fxNum];
+
+	if (prev < 0 ? room->fxNumber != fxNum : (Effects[prev].roomNumber != fx->roomNumber || Effects[prev].nextFx != fxNum))
+	{
+		prev = -1;
+		if (room->fxNumber != fxNum)
+		{
+			for (prev = room->fxNumber; prev != -1 && Effects[prev].nextFx != fxNum; prev = Effects[prev].nextFx);
+			if (prev == -1)
+				return;
+		}
+	}
+
+	if (prev < 0)
+		room->fxNumber = fx->nextFx;
+	else
+		Effects[prev].nextFx = fx->nextFx;
+	if (fx->nextFx >= 0)
+		EffectPrevDrawn[fx->nextFx] = prev;
+}
+
+static void LinkDrawnEffect(short fxNum, ROOM_INFO* room)
+{
+	Effects[fxNum].nextFx = room->fxNumber;
+	EffectPrevDrawn[fxNum] = -1;
+	if (room->fxNumber >= 0)
+		EffectPrevDrawn[room->fxNumber] = fxNum;
+	room->fxNumber = fxNum;
+}
+
 void InitialiseItemArray(int itemCount)
 {
 	int i;
@@ -30,6 +157,8 @@ void InitialiseItemArray(int itemCount)
 	NextItemFree = LevelItemCount;
 	PrevItemActive = -1;
 	NextItemActive = -1;
+	memset(ItemPrevActive, 0xFF, sizeof(ItemPrevActive));
+	memset(ItemPrevDrawn, 0xFF, sizeof(ItemPrevDrawn));
 
 	for (i = LevelItemCount; i + 1 < itemCount; ++i) {
 		Items[i].active = 0;
@@ -43,42 +172,9 @@ void KillItem(short itemNumber)
 	ITEM_INFO* item = &Items[itemNumber];
 	item->active = FALSE;
 
-	short oldActive = NextItemActive;
-	if (oldActive == itemNumber)
-	{
-		NextItemActive = item->nextActive;
-	}
-	else
-	{
-		for (; oldActive != -1; oldActive = Items[oldActive].nextActive)
-		{
-			if (Items[oldActive].nextActive == itemNumber)
-			{
-				Items[oldActive].nextActive = item->nextActive;
-				break;
-			}
-		}
-	}
-
+	UnlinkActiveItem(itemNumber);
 	if (item->roomNumber != NO_ROOM)
-	{
-		oldActive = Rooms[item->roomNumber].itemNumber;
-		if (oldActive == itemNumber)
-		{
-			Rooms[item->roomNumber].itemNumber = item->nextItem;
-		}
-		else
-		{
-			for (; oldActive != -1; oldActive = Items[oldActive].nextItem)
-			{
-				if (Items[oldActive].nextItem == itemNumber)
-				{
-					Items[oldActive].nextItem = item->nextItem;
-					break;
-				}
-			}
-		}
-	}
+		UnlinkDrawnItem(itemNumber);
 
 	if (item == Lara.target)
 		Lara.target = NULL;
@@ -155,8 +251,7 @@ void InitialiseItem(short itemNumber)
 	}
 
 	room = &Rooms[item->roomNumber];
-	item->nextItem = room->itemNumber;
-	room->itemNumber = itemNumber;
+	LinkDrawnItem(itemNumber, room);
 
 	floor = GetFloorSector(item->pos.x, item->pos.z, room);
 	item->floor = ((int)floor->floor << 8);
@@ -174,44 +269,12 @@ void RemoveActiveItem(short itemNumber)
 		return;
 
 	Items[itemNumber].active = 0;
-	short linknum = NextItemActive;
-	if (linknum == itemNumber)
-	{
-		NextItemActive = Items[itemNumber].nextActive;
-		return;
-	}
-
-	for (; linknum != -1; linknum = Items[linknum].nextActive)
-	{
-		if (Items[linknum].nextActive == itemNumber)
-		{
-			Items[linknum].nextActive = Items[itemNumber].nextActive;
-			return;
-		}
-	}
+	UnlinkActiveItem(itemNumber);
 }
 
 void RemoveDrawnItem(short itemNumber)
 {
-	ITEM_INFO* item = &Items[itemNumber];
-	ROOM_INFO* room = &Rooms[item->roomNumber];
-
-	short oldItem = room->itemNumber;
-	if (oldItem == itemNumber)
-	{
-		room->itemNumber = item->nextItem;
-	}
-	else
-	{
-		for (; oldItem != -1; oldItem = Items[oldItem].nextItem)
-		{
-			if (Items[oldItem].nextItem == itemNumber)
-			{
-				Items[oldItem].nextItem = item->nextItem;
-				return;
-			}
-		}
-	}
+	UnlinkDrawnItem(itemNumber);
 }
 
 void AddActiveItem(short itemNumber) {
@@ -223,6 +286,9 @@ void AddActiveItem(short itemNumber) {
 	else if (item->active == 0) {
 		item->active = 1;
 		item->nextActive = NextItemActive;
+		ItemPrevActive[itemNumber] = -1;
+		if (NextItemActive >= 0)
+			ItemPrevActive[NextItemActive] = itemNumber;
 		NextItemActive = itemNumber;
 	}
 }
@@ -231,30 +297,10 @@ void ItemNewRoom(short itemNumber, short roomNumber)
 {
 	ITEM_INFO* item = &Items[itemNumber];
 	if (item->roomNumber != NO_ROOM)
-	{
-		ROOM_INFO* r = &Rooms[item->roomNumber];
-		short linknum = r->itemNumber;
-		if (linknum == itemNumber)
-		{
-			r->itemNumber = item->nextItem;
-		}
-		else
-		{
-			for (; linknum != -1; linknum = Items[linknum].nextItem)
-			{
-				if (Items[linknum].nextItem == itemNumber)
-				{
-					Items[linknum].nextItem = item->nextItem;
-					break;
-				}
-			}
-		}
-	}
+		UnlinkDrawnItem(itemNumber);
 
 	item->roomNumber = roomNumber;
-	ROOM_INFO* r = &Rooms[roomNumber];
-	item->nextItem = r->itemNumber;
-	r->itemNumber = itemNumber;
+	LinkDrawnItem(itemNumber, &Rooms[roomNumber]);
 }
 
 int GlobalItemReplace(int oldItemID, int newItemID) {
@@ -275,6 +321,11 @@ int GlobalItemReplace(int oldItemID, int newItemID) {
 void InitialiseFXArray()
 {
 	ZeroMemory(Effects, sizeof(Effects));
+#ifdef FEATURE_PARTICLES
+	PARTICLE_Clear();
+#endif // FEATURE_PARTICLES
+	memset(EffectPrevActive, 0xFF, sizeof(EffectPrevActive));
+	memset(EffectPrevDrawn, 0xFF, sizeof(EffectPrevDrawn));
 	NextEffectActive = -1;
 	NextEffectFree = 0;
 	FX_INFO* fx = Effects;
@@ -291,10 +342,11 @@ short CreateEffect(short roomNum)
 		FX_INFO* fx = &Effects[NextEffectFree];
 		NextEffectFree = fx->nextFx;
 		fx->roomNumber = roomNum;
-		ROOM_INFO* r = &Rooms[roomNum];
-		fx->nextFx = r->fxNumber;
-		r->fxNumber = result;
+		LinkDrawnEffect(result, &Rooms[roomNum]);
 		fx->nextActive = NextEffectActive;
+		EffectPrevActive[result] = -1;
+		if (NextEffectActive >= 0)
+			EffectPrevActive[NextEffectActive] = result;
 		NextEffectActive = result;
 		fx->shade = 0x1000;
 	}
@@ -304,63 +356,8 @@ short CreateEffect(short roomNum)
 void KillEffect(short fxNum)
 {
 	FX_INFO* fx = &Effects[fxNum];
-	ROOM_INFO* room = &Rooms[fx->roomNumber];
-	FX_INFO* fxNext;
-
-	short oldActive = NextEffectActive;
-	bool doAssignNext = true;
-	if (NextEffectActive == fxNum)
-	{
-		NextEffectActive = fx->nextActive;
-	}
-	else if (NextEffectActive != -1)
-	{
-		while (true)
-		{
-			fxNext = &Effects[oldActive];
-			if (fxNext->nextActive == fxNum)
-				break;
-			if (fxNext->nextActive == -1)
-			{
-				doAssignNext = false;
-				break;
-			}
-			oldActive = fxNext->nextActive;
-		}
-		if (doAssignNext)
-		{
-			fxNext = &Effects[oldActive];
-			fxNext->nextActive = fx->nextActive;
-		}
-	}
-
-	short oldFx = room->fxNumber;
-	doAssignNext = true;
-	if (room->fxNumber == fxNum)
-	{
-		room->fxNumber = fx->nextFx;
-	}
-	else if (oldFx != -1)
-	{
-		while (true)
-		{
-			fxNext = &Effects[oldFx];
-			if (fxNext->nextFx == fxNum)
-				break;
-			if (fxNext->nextFx == -1)
-			{
-				doAssignNext = false;
-				break;
-			}
-			oldFx = fxNext->nextFx;
-		}
-		if (doAssignNext)
-		{
-			fxNext = &Effects[oldFx];
-			fxNext->nextFx = fx->nextFx;
-		}
-	}
-
+	UnlinkActiveEffect(fxNum);
+	UnlinkDrawnEffect(fxNum);
 	fx->nextFx = NextEffectFree;
 	NextEffectFree = fxNum;
 }
@@ -368,40 +365,9 @@ void KillEffect(short fxNum)
 void EffectNewRoom(short fxNum, short newRoomNum)
 {
 	FX_INFO* fx = &Effects[fxNum];
-	ROOM_INFO* room = &Rooms[fx->roomNumber];
-	FX_INFO* fxNext;
-	short oldFx = room->fxNumber;
-	bool doAssignNext = true;
-
-	if (room->fxNumber == fxNum)
-	{
-		room->fxNumber = fx->nextFx;
-	}
-	else if (oldFx != -1)
-	{
-		while (true)
-		{
-			fxNext = &Effects[oldFx];
-			if (fxNext->nextFx == fxNum)
-				break;
-			if (fxNext->nextFx == -1)
-			{
-				doAssignNext = false;
-				break;
-			}
-			oldFx = fxNext->nextFx;
-		}
-		if (doAssignNext)
-		{
-			fxNext = &Effects[oldFx];
-			fxNext->nextFx = fx->nextFx;
-		}
-	}
-
+	UnlinkDrawnEffect(fxNum);
 	fx->roomNumber = newRoomNum;
-	ROOM_INFO* newRoom = &Rooms[newRoomNum];
-	fx->nextFx = newRoom->fxNumber;
-	newRoom->fxNumber = fxNum;
+	LinkDrawnEffect(fxNum, &Rooms[newRoomNum]);
 }
 
 void ClearBodyBag()
@@ -376,10 +376,10 @@ void LaraGetNewTarget(WEAPON_INFO* weapon)
 	srcPos.z = LaraItem->pos.z;
 	srcPos.roomNumber = LaraItem->roomNumber;
 
-	for (int i = 0; i < MAX_CREATURES; i++)
+	for (int slot = GetNextCreatureSlot(-1); slot >= 0; slot = GetNextCreatureSlot(slot))
 	{
-		creature = &BaddiesSlots[i];
-		if (creature->itemNumber == -1 || Lara.item_number == creature->itemNumber)
+		creature = &BaddiesSlots[slot];
+		if (Lara.item_number == creature->itemNumber)
 			continue;
 		targetItem = &Items[creature->itemNumber];
 		if (targetItem->hitPoints <= 0)
@@ -24,20 +24,248 @@
 #include "specific/init.h"
 #include "global/vars.h"
 
+#include <intrin.h>
+
 #ifdef FEATURE_GOLD
 extern bool IsGold();
 #endif
 
+#ifdef FEATURE_MOD_CONFIG
+#include "modding/mod_utils.h"
+#endif
+
+#ifdef FEATURE_NAV_GRAPH
+#include "modding/navgraph.h"
+#endif
+
+// The level config may raise the creature slots cap up to MAX_CREATURES_LIMIT.
+// The LOT nodes of the extra slots are taken from the game memory on their
+// first use only, then the slot keeps them for the next creatures.
+// Used slots are marked in the bit mask, so the free slot is found at once
+// and the loops visit the used slots only, in the same order as before.
+int CreatureSlotsCount = MAX_CREATURES;
+static ULONGLONG CreatureSlotsMask = 0;
+
+static int GetLowestSlot(ULONGLONG mask)
+{
+    unsigned long index;
+    if (_BitScanForward(&index, (DWORD)mask))
+        return index;
+    if (_BitScanForward(&index, (DWORD)(mask >> 32)))
+        return index + 32;
+    return -1;
+}
+
+static bool AllocateSlotLOT(int slot)
+{
+    CREATURE_INFO* creature = &BaddiesSlots[slot];
+    DWORD size = sizeof(BOX_NODE) * BoxesCount;
+    if (creature->LOT.node == NULL)
+    {
+        if (((size + 3) & ~3) > GameAllocMemFree)
+            return false;
+        creature->LOT.node = (BOX_NODE*)game_malloc(size, GBUF_CreatureLOT);
+    }
+    return true;
+}
+
+int GetNextCreatureSlot(int slot)
+{
+    ULONGLONG mask = CreatureSlotsMask;
+    if (slot >= 0)
+        mask &= ~((2ULL << slot) - 1); // NOTE: 2ULL << 63 wraps to zero, so the mask becomes empty
+    return GetLowestSlot(mask);
+}
+
+#ifdef FEATURE_PATH_SCHEDULER
+// The box searches of all creatures share one expansion budget per tick.
+// The pending searches are served by the camera distance and the mood,
+// and the skipped ones get a higher priority on the next tick.
+// The target box field is taken from the box graph cache if possible,
+// otherwise a finished search is copied from another creature with the same
+// LOT profile and target box, unless the map was flipped since it started.
+typedef struct PathSearch_t {
+    UINT16 targetBox;
+    UINT16 searchNumber;
+    DWORD generation;
+} PATH_SEARCH;
+
+static PATH_SEARCH PathSearches[MAX_CREATURES_LIMIT];
+static short PathExpansions[MAX_CREATURES_LIMIT];
+static BYTE PathWaitTicks[MAX_CREATURES_LIMIT];
+static DWORD PathGeneration = 0;
+static int PathBudgetLeft = MAX_EXPANSION_BUDGET;
+
+static int GetLotSlot(LOT_INFO* LOT)
+{
+    CREATURE_INFO* creature = CONTAINING_RECORD(LOT, CREATURE_INFO, LOT);
+    if (BaddiesSlots == NULL || creature < BaddiesSlots || creature >= &BaddiesSlots[CreatureSlotsCount])
+        return -1;
+    return creature - BaddiesSlots;
+}
+
+static DWORD GetPathPriority(int slot)
+{
+    CREATURE_INFO* creature = &BaddiesSlots[slot];
+    ITEM_INFO* item = &Items[creature->itemNumber];
+    int x = (item->pos.x - Camera.pos.x) >> 8;
+    int y = (item->pos.y - Camera.pos.y) >> 8;
+    int z = (item->pos.z - Camera.pos.z) >> 8;
+    DWORD priority = SQR(x) + SQR(y) + SQR(z);
+    if (creature->mood == MOOD_ATTACK || creature->mood == MOOD_ESCAPE)
+        priority >>= 2;
+    return priority >> MIN(PathWaitTicks[slot], 31);
+}
+
+void SchedulePathSearch()
+{
+    int pending[MAX_CREATURES_LIMIT];
+    DWORD priority[MAX_CREATURES_LIMIT];
+    int count = 0;
+
+#ifdef FEATURE_NAV_GRAPH
+    // the finished searches are not shared across the door and window changes
+    if (NAV_CheckBlockedBoxes())
+        InvalidatePathSearch();
+#endif // FEATURE_NAV_GRAPH
+    for (int slot = GetNextCreatureSlot(-1); slot >= 0; slot = GetNextCreatureSlot(slot))
+    {
+        // the finished searches take nothing, the new ones are served from what is left
+        PathExpansions[slot] = -1;
+        if (BaddiesSlots[slot].LOT.head == (UINT16)-1)
+            continue;
+        DWORD value = GetPathPriority(slot);
+        int i = count++;
+        for (; i > 0 && priority[i - 1] > value; i--)
+        {
+            pending[i] = pending[i - 1];
+            priority[i] = priority[i - 1];
+        }
+        pending[i] = slot;
+        priority[i] = value;
+    }
+
+    PathBudgetLeft = MAX_EXPANSION_BUDGET;
+    for (int i = 0; i < count; i++)
+    {
+        int slot = pending[i];
+        if (PathBudgetLeft >= MAX_EXPANSION)
+        {
+            PathExpansions[slot] = MAX_EXPANSION;
+            PathBudgetLeft -= MAX_EXPANSION;
+            PathWaitTicks[slot] = 0;
+        }
+        else
+        {
+            PathExpansions[slot] = 0;
+            if (PathWaitTicks[slot] < 31)
+                PathWaitTicks[slot]++;
+        }
+    }
+#ifdef FEATURE_NAV_GRAPH
+    // the pending box graph field takes a half of what is left, the rest is for the new searches
+    PathBudgetLeft -= NAV_BuildField(PathBudgetLeft / 2);
+#endif // FEATURE_NAV_GRAPH
+}
+
+int GetPathExpansion(LOT_INFO* LOT, int expansion)
+{
+    int slot = GetLotSlot(LOT);
+    if (slot < 0)
+        return expansion;
+
+    int result = PathExpansions[slot];
+    if (result < 0)
+    {
+        result = MAX(0, MIN(expansion, PathBudgetLeft));
+        PathBudgetLeft -= result;
+    }
+    PathExpansions[slot] = 0;
+    return MIN(result, expansion);
+}
+
+bool SharePathSearch(LOT_INFO* LOT)
+{
+    int slot = GetLotSlot(LOT);
+    if (slot < 0)
+        return false;
+
+    PATH_SEARCH* search = &PathSearches[slot];
+    search->targetBox = LOT->targetBox;
+    search->searchNumber = LOT->searchNumber;
+    search->generation = PathGeneration;
+
+#ifdef FEATURE_NAV_GRAPH
+    if (NAV_ApplyField(LOT))
+        return true;
+#endif // FEATURE_NAV_GRAPH
+
+    for (int i = GetNextCreatureSlot(-1); i >= 0; i = GetNextCreatureSlot(i))
+    {
+        LOT_INFO* source = &BaddiesSlots[i].LOT;
+        PATH_SEARCH* shared = &PathSearches[i];
+        if (i == slot || source->head != (UINT16)-1
+            || shared->generation != PathGeneration || shared->targetBox != LOT->targetBox || shared->searchNumber != source->searchNumber
+            || source->fly != LOT->fly || source->step != LOT->step || source->drop != LOT->drop || source->blockMask != LOT->blockMask)
+            continue;
+
+        // drop the expansion queue, the copied search is already finished
+        for (UINT16 boxNumber = LOT->head; boxNumber != (UINT16)-1; )
+        {
+            BOX_NODE* node = &LOT->node[boxNumber];
+            boxNumber = node->nextExpansion;
+            node->nextExpansion = -1;
+        }
+        LOT->head = -1;
+        LOT->tail = -1;
+
+        UINT16 sourceNumber = source->searchNumber & 0x7FFF;
+        for (DWORD j = 0; j < BoxesCount; j++)
+        {
+            BOX_NODE* node = &source->node[j];
+            if ((node->searchNumber & 0x7FFF) != sourceNumber)
+                continue;
+            LOT->node[j].searchNumber = LOT->searchNumber | (node->searchNumber & 0x8000);
+            LOT->node[j].exitBox = node->exitBox;
+        }
+        return true;
+    }
+    return false;
+}
+
+void InvalidatePathSearch()
+{
+    PathGeneration++;
+#ifdef FEATURE_NAV_GRAPH
+    NAV_Invalidate();
+#endif // FEATURE_NAV_GRAPH
+}
+#endif // FEATURE_PATH_SCHEDULER
+
 void InitialiseLOTarray()
 {
-    BaddiesSlots = (CREATURE_INFO*)game_malloc(sizeof(CREATURE_INFO) * MAX_CREATURES, GBUF_CreatureData);
-    for (int i = 0; i < MAX_CREATURES; i++)
+    CreatureSlotsCount = MAX_CREATURES;
+#ifdef FEATURE_MOD_CONFIG
+    if (Mod.creatureSlots > MAX_CREATURES)
+        CreatureSlotsCount = MIN(Mod.creatureSlots, MAX_CREATURES_LIMIT);
+#endif
+    BaddiesSlots = (CREATURE_INFO*)game_malloc(sizeof(CREATURE_INFO) * CreatureSlotsCount, GBUF_CreatureData);
+    for (int i = 0; i < CreatureSlotsCount; i++)
     {
         CREATURE_INFO* creature = &BaddiesSlots[i];
         creature->itemNumber = -1;
-        creature->LOT.node = (BOX_NODE*)game_malloc(sizeof(BOX_NODE) * BoxesCount, GBUF_CreatureLOT);
+        creature->LOT.node = NULL;
+        if (i < MAX_CREATURES)
+            creature->LOT.node = (BOX_NODE*)game_malloc(sizeof(BOX_NODE) * BoxesCount, GBUF_CreatureLOT);
     }
+    CreatureSlotsMask = 0;
     BaddiesSlotsUsedCount = 0;
+#ifdef FEATURE_PATH_SCHEDULER
+#ifdef FEATURE_NAV_GRAPH
+    NAV_BuildGraph();
+#endif // FEATURE_NAV_GRAPH
+    InvalidatePathSearch();
+#endif // FEATURE_PATH_SCHEDULER
 }
 
 void DisableBaddieAI(short itemNumber)
@@ -59,6 +287,7 @@ void DisableBaddieAI(short itemNumber)
     if (creature != NULL)
     {
         creature->itemNumber = -1;
+        CreatureSlotsMask &= ~(1ULL << (creature - BaddiesSlots));
         BaddiesSlotsUsedCount--;
     }
 }
@@ -77,16 +306,15 @@ BOOL EnableBaddieAI(short itemNumber, BOOL always)
         return TRUE;
     }
 
-    if (BaddiesSlotsUsedCount < MAX_CREATURES)
+    if (BaddiesSlotsUsedCount < CreatureSlotsCount)
     {
-        creature = BaddiesSlots;
-        for (int slotIndex = 0; slotIndex < MAX_CREATURES; slotIndex++, creature++)
+        ULONGLONG allMask = (CreatureSlotsCount < 64) ? (1ULL << CreatureSlotsCount) - 1 : ~0ULL;
+        int slotIndex = GetLowestSlot(~CreatureSlotsMask & allMask);
+        // if there is no game memory for the LOT nodes, the pool doesn't grow anymore
+        if (slotIndex >= 0 && AllocateSlotLOT(slotIndex))
         {
-            if (creature->itemNumber == -1)
-            {
-                InitialiseSlot(itemNumber, slotIndex);
-                return TRUE;
-            }
+            InitialiseSlot(itemNumber, slotIndex);
+            return TRUE;
         }
     }
 
@@ -104,11 +332,13 @@ BOOL EnableBaddieAI(short itemNumber, BOOL always)
         worstdist = 0;
     }
 
+    // NOTE: the victim is found by a scan of the used slots, there are no more
+    // than MAX_CREATURES_LIMIT of them. The camera distances change every tick,
+    // so an index of them would cost more to keep than this rare scan.
     int worstslot = -1;
-    creature = BaddiesSlots;
-    for (int slot = 0; slot < MAX_CREATURES; slot++, creature++)
+    for (int slot = GetNextCreatureSlot(-1); slot >= 0; slot = GetNextCreatureSlot(slot))
     {
-        ITEM_INFO* item = &Items[creature->itemNumber];
+        ITEM_INFO* item = &Items[BaddiesSlots[slot].itemNumber];
         int x = (item->pos.x - Camera.pos.x) >> 8;
         int y = (item->pos.y - Camera.pos.y) >> 8;
         int z = (item->pos.z - Camera.pos.z) >> 8;
@@ -197,6 +427,12 @@ void InitialiseSlot(short itemNumber, int baddieSlotID)
     if (itemNumber != Lara.item_number)
         CreateZone(item);
 
+#ifdef FEATURE_PATH_SCHEDULER
+    PathSearches[baddieSlotID].targetBox = -1;
+    PathExpansions[baddieSlotID] = -1;
+    PathWaitTicks[baddieSlotID] = 0;
+#endif // FEATURE_PATH_SCHEDULER
+    CreatureSlotsMask |= 1ULL << baddieSlotID;
     ++BaddiesSlotsUsedCount;
 }
 
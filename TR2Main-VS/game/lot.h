@@ -25,6 +25,11 @@
 #include "global/types.h"
 
 #define MAX_CREATURES 5
+#define MAX_CREATURES_LIMIT 64
+#define MAX_EXPANSION 5
+#define MAX_EXPANSION_BUDGET (MAX_CREATURES * MAX_EXPANSION)
+
+extern int CreatureSlotsCount;
 
  /*
   * Function list
@@ -36,5 +41,12 @@ BOOL EnableBaddieAI(short itemNumber, BOOL always); // 0x00432BC0
 void InitialiseSlot(short itemNumber, int baddieSlotID); // 0x00432D70
 void CreateZone(ITEM_INFO* item); // 0x00432F80
 void ClearLOT(LOT_INFO* LOT); // 0x00433040
+int GetNextCreatureSlot(int slot);
+#ifdef FEATURE_PATH_SCHEDULER
+void SchedulePathSearch();
+int GetPathExpansion(LOT_INFO* LOT, int expansion);
+bool SharePathSearch(LOT_INFO* LOT);
+void InvalidatePathSearch();
+#endif // FEATURE_PATH_SCHEDULER
 
 #endif // LOT_H_INCLUDED
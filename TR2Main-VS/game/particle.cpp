@@ -0,0 +1,364 @@
+#include "precompiled.h"
+#include "particle.h"
+#include "3dsystem/phd_math.h"
+#include "3dsystem/scalespr.h"
+#include "game/control.h"
+#include "specific/output.h"
+#include "global/vars.h"
+
+#ifdef FEATURE_PARTICLES
+
+// The simple sprite effects (splashes, blood, ricochets and bubbles) don't
+// affect the gameplay, so they are kept out of the Effects array, in packed
+// SoA pools like the weather particles. The live particles are [0, count),
+// a dead particle is replaced by the last one. The pools are updated once
+// per tick and drawn after all rooms, in one batch for the rooms above the
+// water and one for the rooms under the water.
+// If a pool is full, or the object is not a sprite, the effect falls back
+// to CreateEffect and the object control routine.
+// The speed and the direction never change, so the steps are precomputed.
+struct SPLASH_POOL
+{
+	int x[MAX_PARTICLE_SPLASHES], y[MAX_PARTICLE_SPLASHES], z[MAX_PARTICLE_SPLASHES];
+	int xv[MAX_PARTICLE_SPLASHES], zv[MAX_PARTICLE_SPLASHES];
+	DWORD color[MAX_PARTICLE_SPLASHES];
+	short frame[MAX_PARTICLE_SPLASHES];
+	short scale[MAX_PARTICLE_SPLASHES];
+	short room[MAX_PARTICLE_SPLASHES];
+	int count;
+
+	void Kill(int i) {
+		int last = --count;
+		if (i == last)
+			return;
+		x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+		xv[i] = xv[last]; zv[i] = zv[last];
+		color[i] = color[last];
+		frame[i] = frame[last];
+		scale[i] = scale[last];
+		room[i] = room[last];
+	}
+};
+
+struct BLOOD_POOL
+{
+	int x[MAX_PARTICLE_BLOOD], y[MAX_PARTICLE_BLOOD], z[MAX_PARTICLE_BLOOD];
+	int xv[MAX_PARTICLE_BLOOD], zv[MAX_PARTICLE_BLOOD];
+	short frame[MAX_PARTICLE_BLOOD];
+	short counter[MAX_PARTICLE_BLOOD];
+	short room[MAX_PARTICLE_BLOOD];
+	int count;
+
+	void Kill(int i) {
+		int last = --count;
+		if (i == last)
+			return;
+		x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+		xv[i] = xv[last]; zv[i] = zv[last];
+		frame[i] = frame[last];
+		counter[i] = counter[last];
+		room[i] = room[last];
+	}
+};
+
+struct RICOCHET_POOL
+{
+	int x[MAX_PARTICLE_RICOCHETS], y[MAX_PARTICLE_RICOCHETS], z[MAX_PARTICLE_RICOCHETS];
+	short frame[MAX_PARTICLE_RICOCHETS];
+	short counter[MAX_PARTICLE_RICOCHETS];
+	short room[MAX_PARTICLE_RICOCHETS];
+	int count;
+
+	void Kill(int i) {
+		int last = --count;
+		if (i == last)
+			return;
+		x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+		frame[i] = frame[last];
+		counter[i] = counter[last];
+		room[i] = room[last];
+	}
+};
+
+struct BUBBLE_POOL
+{
+	int x[MAX_PARTICLE_BUBBLES], y[MAX_PARTICLE_BUBBLES], z[MAX_PARTICLE_BUBBLES];
+	short rotX[MAX_PARTICLE_BUBBLES], rotY[MAX_PARTICLE_BUBBLES];
+	short speed[MAX_PARTICLE_BUBBLES];
+	short frame[MAX_PARTICLE_BUBBLES];
+	short room[MAX_PARTICLE_BUBBLES];
+	int count;
+
+	void Kill(int i) {
+		int last = --count;
+		if (i == last)
+			return;
+		x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+		rotX[i] = rotX[last]; rotY[i] = rotY[last];
+		speed[i] = speed[last];
+		frame[i] = frame[last];
+		room[i] = room[last];
+	}
+};
+
+static SPLASH_POOL SplashPool;
+static BLOOD_POOL BloodPool;
+static RICOCHET_POOL RicochetPool;
+static BUBBLE_POOL BubblePool;
+static std::vector<BYTE> ParticleRooms;
+
+enum PARTICLE_ROOM {
+	PARTICLE_Hidden,
+	PARTICLE_AboveWater,
+	PARTICLE_BelowWater,
+};
+
+static inline bool PARTICLE_IsSprite(GAME_OBJECT_ID objectID)
+{
+	return Objects[objectID].loaded && Objects[objectID].nMeshes < 0;
+}
+
+void PARTICLE_Clear()
+{
+	SplashPool.count = 0;
+	BloodPool.count = 0;
+	RicochetPool.count = 0;
+	BubblePool.count = 0;
+}
+
+bool PARTICLE_AddSplash(DWORD color, int x, int y, int z, short speed, short rotY, short scale, short roomNumber)
+{
+	auto& pool = SplashPool;
+	if (pool.count >= MAX_PARTICLE_SPLASHES || !PARTICLE_IsSprite(ID_SPLASH))
+		return false;
+	int i = pool.count++;
+	pool.x[i] = x;
+	pool.y[i] = y;
+	pool.z[i] = z;
+	pool.xv[i] = speed * phd_sin(rotY) >> W2V_SHIFT;
+	pool.zv[i] = speed * phd_cos(rotY) >> W2V_SHIFT;
+	pool.color[i] = color;
+	pool.frame[i] = 0;
+	pool.scale[i] = scale;
+	pool.room[i] = roomNumber;
+	return true;
+}
+
+bool PARTICLE_AddBlood(int x, int y, int z, short speed, short rotY, short roomNumber)
+{
+	auto& pool = BloodPool;
+	if (pool.count >= MAX_PARTICLE_BLOOD || !PARTICLE_IsSprite(ID_BLOOD))
+		return false;
+	int i = pool.count++;
+	pool.x[i] = x;
+	pool.y[i] = y;
+	pool.z[i] = z;
+	pool.xv[i] = speed * phd_sin(rotY) >> W2V_SHIFT;
+	pool.zv[i] = speed * phd_cos(rotY) >> W2V_SHIFT;
+	pool.frame[i] = 0;
+	pool.counter[i] = 0;
+	pool.room[i] = roomNumber;
+	return true;
+}
+
+bool PARTICLE_AddRicochet(int x, int y, int z, short frame, short roomNumber)
+{
+	auto& pool = RicochetPool;
+	if (pool.count >= MAX_PARTICLE_RICOCHETS || !PARTICLE_IsSprite(ID_RICOCHET))
+		return false;
+	int i = pool.count++;
+	pool.x[i] = x;
+	pool.y[i] = y;
+	pool.z[i] = z;
+	pool.frame[i] = frame;
+	pool.counter[i] = 4;
+	pool.room[i] = roomNumber;
+	return true;
+}
+
+bool PARTICLE_AddBubble(int x, int y, int z, short rotX, short rotY, short speed, short frame, short roomNumber)
+{
+	auto& pool = BubblePool;
+	if (pool.count >= MAX_PARTICLE_BUBBLES || !PARTICLE_IsSprite(ID_BUBBLES))
+		return false;
+	int i = pool.count++;
+	pool.x[i] = x;
+	pool.y[i] = y;
+	pool.z[i] = z;
+	pool.rotX[i] = rotX;
+	pool.rotY[i] = rotY;
+	pool.speed[i] = speed;
+	pool.frame[i] = frame;
+	pool.room[i] = roomNumber;
+	return true;
+}
+
+static void PARTICLE_UpdateSplashes()
+{
+	auto& pool = SplashPool;
+	int count = pool.count;
+	short lastFrame = Objects[ID_SPLASH].nMeshes;
+
+	for (int i = 0; i < count; ++i) {
+		--pool.frame[i];
+		pool.x[i] += pool.xv[i];
+		pool.z[i] += pool.zv[i];
+	}
+	for (int i = 0; i < pool.count; ) {
+		if (pool.frame[i] <= lastFrame) {
+			pool.Kill(i);
+			continue;
+		}
+		i++;
+	}
+}
+
+static void PARTICLE_UpdateBlood()
+{
+	auto& pool = BloodPool;
+	int count = pool.count;
+	short lastFrame = Objects[ID_BLOOD].nMeshes;
+
+	for (int i = 0; i < count; ++i) {
+		pool.x[i] += pool.xv[i];
+		pool.z[i] += pool.zv[i];
+		short next = (pool.counter[i] == 3);
+		pool.frame[i] -= next;
+		pool.counter[i] = next ? 0 : pool.counter[i] + 1;
+	}
+	for (int i = 0; i < pool.count; ) {
+		if (pool.frame[i] <= lastFrame) {
+			pool.Kill(i);
+			continue;
+		}
+		i++;
+	}
+}
+
+static void PARTICLE_UpdateRicochets()
+{
+	auto& pool = RicochetPool;
+	int count = pool.count;
+
+	for (int i = 0; i < count; ++i) {
+		--pool.counter[i];
+	}
+	for (int i = 0; i < pool.count; ) {
+		if (pool.counter[i] <= 0) {
+			pool.Kill(i);
+			continue;
+		}
+		i++;
+	}
+}
+
+// Same as ControlBubble1, the bubble dies when it leaves the water
+static void PARTICLE_UpdateBubbles()
+{
+	auto& pool = BubblePool;
+
+	for (int i = 0; i < pool.count; ) {
+		pool.rotY[i] += ANGLE(9);
+		pool.rotX[i] += ANGLE(13);
+		int x = pool.x[i] + (11 * phd_sin(pool.rotY[i]) >> W2V_SHIFT);
+		int y = pool.y[i] - pool.speed[i];
+		int z = pool.z[i] + (8 * phd_cos(pool.rotX[i]) >> W2V_SHIFT);
+		short roomID = pool.room[i];
+		FLOOR_INFO* floor = GetFloor(x, y, z, &roomID);
+		if (floor && CHK_ANY(Rooms[roomID].flags, ROOM_UNDERWATER)) {
+			int ceiling = GetCeiling(floor, x, y, z);
+			if (ceiling != NO_HEIGHT && y > ceiling) {
+				pool.x[i] = x;
+				pool.y[i] = y;
+				pool.z[i] = z;
+				pool.room[i] = roomID;
+				i++;
+				continue;
+			}
+		}
+		pool.Kill(i);
+	}
+}
+
+void PARTICLE_Update()
+{
+	PARTICLE_UpdateSplashes();
+	PARTICLE_UpdateBlood();
+	PARTICLE_UpdateRicochets();
+	PARTICLE_UpdateBubbles();
+}
+
+static void PARTICLE_DrawBatch(BYTE roomState)
+{
+	OBJECT_INFO* obj = &Objects[ID_SPLASH];
+	if (obj->loaded) {
+		auto& pool = SplashPool;
+		DWORD flags = SPR_ABS | (obj->semi_transparent ? SPR_SEMITRANS : 0);
+		for (int i = 0; i < pool.count; ++i) {
+			if (ParticleRooms[pool.room[i]] != roomState)
+				continue;
+			DWORD spriteFlags = flags | (pool.color[i] != 0 ? SPR_TINT | pool.color[i] : SPR_SHADE) | (pool.scale[i] != 0 ? SPR_SCALE : 0);
+			S_DrawSprite(spriteFlags, pool.x[i], pool.y[i], pool.z[i], obj->meshIndex - pool.frame[i], pool.color[i] != 0 ? 0 : 0x1000, pool.scale[i]);
+		}
+	}
+
+	obj = &Objects[ID_BLOOD];
+	if (obj->loaded) {
+		auto& pool = BloodPool;
+		DWORD flags = SPR_SHADE | SPR_ABS | SPR_SCALE | (obj->semi_transparent ? SPR_SEMITRANS : 0);
+		for (int i = 0; i < pool.count; ++i) {
+			if (ParticleRooms[pool.room[i]] == roomState)
+				S_DrawSprite(flags, pool.x[i], pool.y[i], pool.z[i], obj->meshIndex - pool.frame[i], 0x1000, 256);
+		}
+	}
+
+	obj = &Objects[ID_RICOCHET];
+	if (obj->loaded) {
+		auto& pool = RicochetPool;
+		DWORD flags = SPR_SHADE | SPR_ABS | (obj->semi_transparent ? SPR_SEMITRANS : 0);
+		for (int i = 0; i < pool.count; ++i) {
+			if (ParticleRooms[pool.room[i]] == roomState)
+				S_DrawSprite(flags, pool.x[i], pool.y[i], pool.z[i], obj->meshIndex - pool.frame[i], 0x1000, 0);
+		}
+	}
+
+	obj = &Objects[ID_BUBBLES];
+	if (obj->loaded) {
+		auto& pool = BubblePool;
+		DWORD flags = SPR_SHADE | SPR_ABS | (obj->semi_transparent ? SPR_SEMITRANS : 0);
+		for (int i = 0; i < pool.count; ++i) {
+			if (ParticleRooms[pool.room[i]] == roomState)
+				S_DrawSprite(flags, pool.x[i], pool.y[i], pool.z[i], obj->meshIndex - pool.frame[i], 0x1000, 0);
+		}
+	}
+}
+
+// Draws the particles of the rooms in DrawRoomsArray
+void PARTICLE_Draw()
+{
+	bool isAbove = false, isBelow = false;
+
+	ParticleRooms.assign(RoomCount, PARTICLE_Hidden);
+	for (int i = 0; i < DrawRoomsCount; ++i) {
+		short roomNumber = DrawRoomsArray[i];
+		if (CHK_ANY(Rooms[roomNumber].flags, ROOM_UNDERWATER)) {
+			ParticleRooms[roomNumber] = PARTICLE_BelowWater;
+			isBelow = true;
+		}
+		else {
+			ParticleRooms[roomNumber] = PARTICLE_AboveWater;
+			isAbove = true;
+		}
+	}
+
+	if (isBelow) {
+		S_SetupBelowWater(UnderwaterCamera);
+		PARTICLE_DrawBatch(PARTICLE_BelowWater);
+	}
+	if (isAbove) {
+		S_SetupAboveWater(UnderwaterCamera);
+		PARTICLE_DrawBatch(PARTICLE_AboveWater);
+	}
+}
+
+#endif // FEATURE_PARTICLES
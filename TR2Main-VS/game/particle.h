@@ -0,0 +1,9 @@
+#pragma once
+
+extern void PARTICLE_Clear();
+extern bool PARTICLE_AddSplash(DWORD color, int x, int y, int z, short speed, short rotY, short scale, short roomNumber);
+extern bool PARTICLE_AddBlood(int x, int y, int z, short speed, short rotY, short roomNumber);
+extern bool PARTICLE_AddRicochet(int x, int y, int z, short frame, short roomNumber);
+extern bool PARTICLE_AddBubble(int x, int y, int z, short rotX, short rotY, short speed, short frame, short roomNumber);
+extern void PARTICLE_Update();
+extern void PARTICLE_Draw();
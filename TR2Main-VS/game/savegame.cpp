@@ -384,6 +384,10 @@ void CreateSaveGameInfo() {
 			WriteSG(&flareAge, sizeof(flareAge));
 		}
 	}
+
+	// NOTE: there were no random seeds in the original savegame
+	WriteSG(&RandomControl, sizeof(RandomControl));
+	WriteSG(&RandomDraw, sizeof(RandomDraw));
 }
 
 void ExtractSaveGameInfo() {
@@ -601,6 +605,10 @@ void ExtractSaveGameInfo() {
 		ReadSG(&flareAge, sizeof(flareAge));
 		item->data = (LPVOID)flareAge;
 	}
+
+	// the seeds are zero for the old savegames, since the buffer is zeroed before saving
+	ReadSG(&RandomControl, sizeof(RandomControl));
+	ReadSG(&RandomDraw, sizeof(RandomDraw));
 }
 
 void ResetSG() {
@@ -60,6 +60,8 @@
 #include "game/missile.h"
 #include "game/sound.h"
 #include "game/savegame.h"
+#include "game/weather.h"
+#include "game/visibility.h"
 #include "specific/sndpc.h"
 #include "specific/file.h"
 #include "specific/output.h"
@@ -108,6 +110,12 @@ BOOL InitialiseLevel(int levelIndex, GF_LEVEL_TYPE type)
 			GetCarriedItems();
 		InitialiseFXArray();
 		InitialiseLOTarray();
+#ifdef FEATURE_VISIBILITY_CACHE
+		VIS_InitialiseLevel();
+#endif // FEATURE_VISIBILITY_CACHE
+#if defined(FEATURE_MOD_CONFIG)
+		WEATHER_InitialiseLevel();
+#endif
 		InitColours();
 		T_InitPrint();
 		InitialisePickUpDisplay();
@@ -31,6 +31,14 @@
 #include "modding/mod_utils.h"
 #endif
 
+#ifdef FEATURE_VOICE_MANAGER
+#include "game/voice.h"
+#endif // FEATURE_VOICE_MANAGER
+
+#if defined(FEATURE_VOICE_MANAGER) && defined(FEATURE_PROFILER)
+#include "modding/profiler.h"
+#endif // defined(FEATURE_VOICE_MANAGER) && defined(FEATURE_PROFILER)
+
 enum sound_flags { NORMAL_SOUND, WAIT_SOUND, RESTART_SOUND, LOOPED_SOUND };
 
 static void S_SoundUpdatePanVolume(SOUND_SLOT* slot)
@@ -194,6 +202,47 @@ int PlaySoundEffect(DWORD sampleIdx, PHD_3DPOS* pos, DWORD flags)
 	else
 		nSample = info.sampleIdx;
 
+#ifdef FEATURE_VOICE_MANAGER
+	bool isWait, isRewound, isLooped;
+#if defined(FEATURE_MOD_CONFIG)
+	if (Mod.useNewVersion && Mod.newVersion >= 1)
+	{
+		isWait = CHK_ANY(info.flags, 0x0200);
+		isRewound = !isWait && CHK_ANY(info.flags, 0x0400);
+		isLooped = CHK_ANY(info.flags, 0x0800);
+	}
+	else
+#endif
+	{
+		isWait = (info.flags & 3) == WAIT_SOUND;
+		isRewound = (info.flags & 3) == RESTART_SOUND;
+		isLooped = (info.flags & 3) == LOOPED_SOUND;
+	}
+
+	SOUND_SLOT params = {};
+	params.volume = nVolume;
+	params.originalVolume = origVolume;
+	params.pan = pan;
+	params.pitch = pitch;
+	params.sampleIdx = lut;
+	params.distance = nDistance;
+	params.pos.x = pos->x;
+	params.pos.y = pos->y;
+	params.pos.z = pos->z;
+
+	if (isWait && VOICE_IsSamplePlaying(lut))
+		return 0;
+	if (isRewound)
+		VOICE_StopSample(lut);
+	if (isLooped && !isWait && !isRewound)
+	{
+		int result = VOICE_UpdateLoop(lut, &params);
+		if (result >= 0)
+			return result;
+	}
+	// The voice manager steals the quietest voice if all the channels are busy
+	return VOICE_Play(&params, nSample, isLooped) ? 1 : 0;
+#else // FEATURE_VOICE_MANAGER
 #if defined(FEATURE_MOD_CONFIG)
 	if (Mod.useNewVersion && Mod.newVersion >= 1)
 	{
@@ -401,6 +450,7 @@ int PlaySoundEffect(DWORD sampleIdx, PHD_3DPOS* pos, DWORD flags)
 
 	LogWarn("Mad Failure #2 in SoundEffect");
 	return 0;
+#endif // FEATURE_VOICE_MANAGER
 }
 
 void StopSoundEffect(DWORD sampleIdx)
@@ -412,6 +462,9 @@ void StopSoundEffect(DWORD sampleIdx)
 	auto& sampleInfo = SampleInfos.at(lut);
 	auto lut_end = lut + sampleInfo.lutCount;
 
+#ifdef FEATURE_VOICE_MANAGER
+	VOICE_StopSamples(lut, lut_end);
+#else // FEATURE_VOICE_MANAGER
 	for (int i = 0; i < _countof(LaSlot); ++i)
 	{
 		auto& slot = LaSlot[i];
@@ -421,10 +474,20 @@ void StopSoundEffect(DWORD sampleIdx)
 			slot.sampleIdx = -1;
 		}
 	}
+#endif // FEATURE_VOICE_MANAGER
 }
 
 void SOUND_EndScene()
 {
+#ifdef FEATURE_VOICE_MANAGER
+	VOICE_EndScene(S_SoundUpdatePanVolume);
+#ifdef FEATURE_PROFILER
+	const VOICE_STATS* stats = VOICE_GetStats();
+	PROF_SetCounter(PROF_Voices, stats->realVoices);
+	PROF_SetCounter(PROF_VirtualVoices, stats->virtualVoices);
+	PROF_SetCounter(PROF_VoiceSteals, stats->steals);
+#endif // FEATURE_PROFILER
+#else // FEATURE_VOICE_MANAGER
 	for (int i = 0; i < _countof(LaSlot); i++)
 	{
 		SOUND_SLOT* slot = &LaSlot[i];
@@ -453,15 +516,20 @@ void SOUND_EndScene()
 		else if (!S_SoundSampleIsPlaying(i))
 			slot->sampleIdx = -1;
 	}
+#endif // FEATURE_VOICE_MANAGER
 }
 
 void SOUND_Stop()
 {
 	if (IsSoundEnabled)
 	{
+#ifdef FEATURE_VOICE_MANAGER
+		VOICE_StopAll();
+#else // FEATURE_VOICE_MANAGER
 		S_SoundStopAllSamples();
 		for (int i = 0; i < _countof(LaSlot); i++)
 			LaSlot[i].sampleIdx = -1;
+#endif // FEATURE_VOICE_MANAGER
 	}
 }
 
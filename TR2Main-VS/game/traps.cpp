@@ -508,10 +508,7 @@ void RollingBallControl(short itemNumber) {
 		item->pos.y = oldPos->y;
 		item->pos.z = oldPos->z;
 		if (item->roomNumber != oldPos->roomNumber) {
-			RemoveDrawnItem(itemNumber);
-			item->nextItem = Rooms[oldPos->roomNumber].itemNumber;
-			Rooms[oldPos->roomNumber].itemNumber = itemNumber;
-			item->roomNumber = oldPos->roomNumber;
+			ItemNewRoom(itemNumber, oldPos->roomNumber);
 		}
 		item->animNumber = Objects[item->objectID].animIndex;
 		item->frameNumber = Anims[item->animNumber].frameBase;
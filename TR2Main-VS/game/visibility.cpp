@@ -0,0 +1,314 @@
+#include "precompiled.h"
+#include "visibility.h"
+#include "3dsystem/phd_simd.h"
+#include "game/draw.h"
+#include "global/vars.h"
+
+#ifdef FEATURE_VISIBILITY_CACHE
+
+// The door vertices are converted to the world space once on the level load,
+// so the portal pass doesn't need to translate the matrix for every room, and
+// the four vertices of a door are transformed at once with SSE2. The view
+// coordinates are computed with the same 32 bit integer math as in
+// SetRoomBounds, so the room bounds are exactly the same.
+// The rooms are swapped by FlipMap together with their doors, so the door
+// ranges are swapped too. If a room has doors that were not cached, the
+// original path is used for this room.
+//
+// The visible rooms and their bounds are stored after the portal pass. If the
+// next frame has the same camera room, view angle and window, and the camera
+// moved no more than VIS_REUSE_DISTANCE, the stored bounds are restored and
+// the portal pass is skipped. Any camera movement changes the projected
+// portals, so the distance is zero to keep the room clipping exact.
+#define VIS_REUSE_DISTANCE (0)
+
+typedef struct VisDoor_t {
+	__declspec(align(16)) int x[4];
+	int y[4];
+	int z[4];
+	int nx, ny, nz;
+	short room;
+} VIS_DOOR;
+
+typedef struct VisRoom_t {
+	DOOR_INFOS* source;
+	int first;
+	int count;
+} VIS_ROOM;
+
+typedef struct VisBounds_t {
+	short roomNumber;
+	short left, right, top, bottom;
+	short boundLeft, boundRight, boundTop, boundBottom;
+	UINT16 boundActive;
+} VIS_BOUNDS;
+
+typedef struct VisView_t {
+	PHD_MATRIX matrix;
+	int x, y, z;
+	int flip;
+	int winMaxX, winMaxY;
+	int winCenterX, winCenterY;
+	int persp, farZ;
+	short roomNumber;
+} VIS_VIEW;
+
+static VIS_DOOR* VisDoors = NULL;
+static VIS_ROOM* VisRooms = NULL;
+static int VisRoomsCount = 0;
+
+static VIS_BOUNDS* VisBounds = NULL;
+static int VisBoundsCount = 0;
+static VIS_VIEW VisView;
+static bool VisViewValid = false;
+static int VisOutsideCamera;
+static int VisOutsideLeft, VisOutsideTop, VisOutsideRight, VisOutsideBottom;
+
+static VIS_STATS VisStats;
+
+static void VIS_Release()
+{
+	if (VisDoors != NULL)
+	{
+		_aligned_free(VisDoors);
+		VisDoors = NULL;
+	}
+	if (VisRooms != NULL)
+	{
+		free(VisRooms);
+		VisRooms = NULL;
+	}
+	if (VisBounds != NULL)
+	{
+		free(VisBounds);
+		VisBounds = NULL;
+	}
+	VisRoomsCount = 0;
+	VisBoundsCount = 0;
+	VisViewValid = false;
+}
+
+void VIS_InitialiseLevel()
+{
+	int doorsCount = 0;
+
+	VIS_Release();
+	memset(&VisStats, 0, sizeof(VisStats));
+	if (RoomCount <= 0)
+		return;
+
+	for (int i = 0; i < RoomCount; ++i)
+	{
+		if (Rooms[i].doors != NULL)
+			doorsCount += Rooms[i].doors->wCount;
+	}
+
+	VisRooms = (VIS_ROOM*)malloc(sizeof(VIS_ROOM) * RoomCount);
+	VisBounds = (VIS_BOUNDS*)malloc(sizeof(VIS_BOUNDS) * RoomCount);
+	VisDoors = (VIS_DOOR*)_aligned_malloc(sizeof(VIS_DOOR) * MAX(doorsCount, 1), 16);
+	if (VisRooms == NULL || VisBounds == NULL || VisDoors == NULL)
+	{
+		LogWarn("Failed to allocate the visibility cache");
+		VIS_Release();
+		return;
+	}
+
+	doorsCount = 0;
+	for (int i = 0; i < RoomCount; ++i)
+	{
+		ROOM_INFO* room = &Rooms[i];
+		VIS_ROOM* visRoom = &VisRooms[i];
+		visRoom->source = room->doors;
+		visRoom->first = doorsCount;
+		visRoom->count = (room->doors != NULL) ? room->doors->wCount : 0;
+		for (int j = 0; j < visRoom->count; ++j)
+		{
+			DOOR_INFO* door = &room->doors->door[j];
+			VIS_DOOR* visDoor = &VisDoors[doorsCount++];
+			for (int k = 0; k < 4; ++k)
+			{
+				visDoor->x[k] = room->x + door->vertex[k].x;
+				visDoor->y[k] = room->y + door->vertex[k].y;
+				visDoor->z[k] = room->z + door->vertex[k].z;
+			}
+			visDoor->nx = door->x;
+			visDoor->ny = door->y;
+			visDoor->nz = door->z;
+			visDoor->room = door->room;
+		}
+	}
+	VisRoomsCount = RoomCount;
+}
+
+void VIS_SwapRooms(int roomNumber1, int roomNumber2)
+{
+	if (roomNumber1 >= VisRoomsCount || roomNumber2 >= VisRoomsCount)
+		return;
+	VIS_ROOM temp = VisRooms[roomNumber1];
+	VisRooms[roomNumber1] = VisRooms[roomNumber2];
+	VisRooms[roomNumber2] = temp;
+	VisViewValid = false;
+}
+
+static void VIS_TransformDoor(const VIS_DOOR* door, PHD_VECTOR* view)
+{
+	__declspec(align(16)) int result[3][4];
+	PHD_MATRIX* m = PhdMatrixPtr;
+	__m128i x = _mm_sub_epi32(_mm_load_si128((const __m128i*)door->x), _mm_set1_epi32(MatrixW2V._03));
+	__m128i y = _mm_sub_epi32(_mm_load_si128((const __m128i*)door->y), _mm_set1_epi32(MatrixW2V._13));
+	__m128i z = _mm_sub_epi32(_mm_load_si128((const __m128i*)door->z), _mm_set1_epi32(MatrixW2V._23));
+
+	_mm_store_si128((__m128i*)result[0], phd_Dot4(x, y, z, m->_00, m->_01, m->_02));
+	_mm_store_si128((__m128i*)result[1], phd_Dot4(x, y, z, m->_10, m->_11, m->_12));
+	_mm_store_si128((__m128i*)result[2], phd_Dot4(x, y, z, m->_20, m->_21, m->_22));
+	for (int i = 0; i < 4; ++i)
+	{
+		view[i].x = result[0][i];
+		view[i].y = result[1][i];
+		view[i].z = result[2][i];
+	}
+}
+
+bool VIS_SetDoorsBounds(int roomNumber)
+{
+	if (roomNumber >= VisRoomsCount)
+		return false;
+
+	ROOM_INFO* parent = &Rooms[roomNumber];
+	VIS_ROOM* visRoom = &VisRooms[roomNumber];
+	if (visRoom->source != parent->doors)
+		return false;
+
+	PHD_VECTOR view[4];
+	VIS_DOOR* door = &VisDoors[visRoom->first];
+	for (int i = 0; i < visRoom->count; ++i, ++door)
+	{
+		++VisStats.portalTests;
+		if (door->nx * (door->x[0] - MatrixW2V._03)
+		  + door->ny * (door->y[0] - MatrixW2V._13)
+		  + door->nz * (door->z[0] - MatrixW2V._23) >= 0)
+		{
+			continue;
+		}
+		ROOM_INFO* room = &Rooms[door->room];
+		if (room->boundLeft <= parent->left
+			&& room->boundRight >= parent->right
+			&& room->boundTop <= parent->top
+			&& room->boundBottom >= parent->bottom)
+		{
+			continue;
+		}
+		++VisStats.portalTransforms;
+		VIS_TransformDoor(door, view);
+		ClipRoomBounds(view, door->room, parent);
+	}
+	return true;
+}
+
+static void VIS_GetView(VIS_VIEW* view, short currentRoom)
+{
+	memset(view, 0, sizeof(VIS_VIEW));
+	view->matrix = *PhdMatrixPtr;
+	view->matrix._03 = view->matrix._13 = view->matrix._23 = 0;
+	view->x = MatrixW2V._03;
+	view->y = MatrixW2V._13;
+	view->z = MatrixW2V._23;
+	view->flip = FlipStatus;
+	view->winMaxX = PhdWinMaxX;
+	view->winMaxY = PhdWinMaxY;
+	view->winCenterX = PhdWinCenterX;
+	view->winCenterY = PhdWinCenterY;
+	view->persp = PhdPersp;
+	view->farZ = PhdFarZ;
+	view->roomNumber = currentRoom;
+}
+
+bool VIS_RestoreRoomBounds(short currentRoom)
+{
+	VIS_VIEW view;
+
+	VisStats.portalTests = 0;
+	VisStats.portalTransforms = 0;
+	VisStats.reused = false;
+	if (!VisViewValid)
+		return false;
+
+	VIS_GetView(&view, currentRoom);
+	int dx = view.x - VisView.x;
+	int dy = view.y - VisView.y;
+	int dz = view.z - VisView.z;
+	view.x = VisView.x;
+	view.y = VisView.y;
+	view.z = VisView.z;
+	if (memcmp(&view, &VisView, sizeof(VIS_VIEW))
+		|| ABS(dx) > VIS_REUSE_DISTANCE
+		|| ABS(dy) > VIS_REUSE_DISTANCE
+		|| ABS(dz) > VIS_REUSE_DISTANCE)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < VisBoundsCount; ++i)
+	{
+		VIS_BOUNDS* bounds = &VisBounds[i];
+		ROOM_INFO* room = &Rooms[bounds->roomNumber];
+		room->left = bounds->left;
+		room->right = bounds->right;
+		room->top = bounds->top;
+		room->bottom = bounds->bottom;
+		room->boundLeft = bounds->boundLeft;
+		room->boundRight = bounds->boundRight;
+		room->boundTop = bounds->boundTop;
+		room->boundBottom = bounds->boundBottom;
+		room->boundActive = bounds->boundActive;
+		DrawRoomsArray[i] = bounds->roomNumber;
+	}
+	DrawRoomsCount = VisBoundsCount;
+	OutsideCamera = VisOutsideCamera;
+	OutsideLeft = VisOutsideLeft;
+	OutsideTop = VisOutsideTop;
+	OutsideRight = VisOutsideRight;
+	OutsideBottom = VisOutsideBottom;
+	VisStats.visibleRooms = DrawRoomsCount;
+	VisStats.reused = true;
+	return true;
+}
+
+void VIS_StoreRoomBounds(short currentRoom)
+{
+	VisStats.visibleRooms = DrawRoomsCount;
+	VisViewValid = false;
+	if (VisBounds == NULL || DrawRoomsCount > VisRoomsCount)
+		return;
+
+	for (int i = 0; i < DrawRoomsCount; ++i)
+	{
+		VIS_BOUNDS* bounds = &VisBounds[i];
+		ROOM_INFO* room = &Rooms[DrawRoomsArray[i]];
+		bounds->roomNumber = DrawRoomsArray[i];
+		bounds->left = room->left;
+		bounds->right = room->right;
+		bounds->top = room->top;
+		bounds->bottom = room->bottom;
+		bounds->boundLeft = room->boundLeft;
+		bounds->boundRight = room->boundRight;
+		bounds->boundTop = room->boundTop;
+		bounds->boundBottom = room->boundBottom;
+		bounds->boundActive = room->boundActive;
+	}
+	VisBoundsCount = DrawRoomsCount;
+	VisOutsideCamera = OutsideCamera;
+	VisOutsideLeft = OutsideLeft;
+	VisOutsideTop = OutsideTop;
+	VisOutsideRight = OutsideRight;
+	VisOutsideBottom = OutsideBottom;
+	VIS_GetView(&VisView, currentRoom);
+	VisViewValid = true;
+}
+
+const VIS_STATS* VIS_GetStats()
+{
+	return &VisStats;
+}
+
+#endif // FEATURE_VISIBILITY_CACHE
@@ -0,0 +1,15 @@
+#pragma once
+
+typedef struct VisStats_t {
+	int visibleRooms;
+	int portalTests;
+	int portalTransforms;
+	bool reused;
+} VIS_STATS;
+
+extern void VIS_InitialiseLevel();
+extern void VIS_SwapRooms(int roomNumber1, int roomNumber2);
+extern bool VIS_SetDoorsBounds(int roomNumber);
+extern bool VIS_RestoreRoomBounds(short currentRoom);
+extern void VIS_StoreRoomBounds(short currentRoom);
+extern const VIS_STATS* VIS_GetStats();
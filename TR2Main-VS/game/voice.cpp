@@ -0,0 +1,432 @@
+#include "precompiled.h"
+#include "voice.h"
+#include "global/vars.h"
+
+#ifdef FEATURE_VOICE_MANAGER
+
+// The real voices are kept in a min-heap by the volume they play at, so the
+// quietest one is always on the top and can be stolen by a louder sound when
+// all the channels are busy. A stolen one-shot is stopped, but a stolen loop
+// becomes virtual: it keeps its slot and follows its emitter, but doesn't
+// play. The loops quieter than VOICE_AUDIBLE_VOLUME are virtualized too. A
+// virtual loop gets a channel back as soon as it is louder than the quietest
+// real voice or a channel is free.
+// The voices of every sample are linked in a list, so the WAIT, REWOUND and
+// LOOPED checks don't scan all the voices.
+#define VOICE_MAX (VOICE_MAX_CHANNELS * 2)
+#define VOICE_AUDIBLE_VOLUME (0x100)
+
+typedef struct Voice_t {
+	SOUND_SLOT slot;
+	int sample;
+	int channel; // -1 while the voice is virtual
+	int heapIndex;
+	int key;
+	short prevLut;
+	short nextLut;
+	short nextFree;
+	bool looped;
+	bool active;
+} VOICE;
+
+static const VOICE_BACKEND* Backend = NULL;
+static VOICE Voices[VOICE_MAX];
+static short FreeVoice = -1;
+static short ChannelVoices[VOICE_MAX_CHANNELS];
+static short FreeChannels[VOICE_MAX_CHANNELS];
+static int FreeChannelsCount = 0;
+static short Heap[VOICE_MAX_CHANNELS];
+static int HeapCount = 0;
+static std::vector<short> LutVoices;
+static VOICE_STATS Counters;
+static VOICE_STATS Stats;
+
+// The null backend has no output. The one-shots end at once, the loops play
+// until they are stopped.
+static bool NullLooped[VOICE_MAX_CHANNELS];
+
+static bool NullStart(int channel, int sample, int volume, int pitch, int pan, bool looped)
+{
+	NullLooped[channel] = looped;
+	return true;
+}
+
+static void NullStop(int channel)
+{
+	NullLooped[channel] = false;
+}
+
+static bool NullIsPlaying(int channel)
+{
+	return NullLooped[channel];
+}
+
+static void NullUpdate(int channel, int volume, int pitch, int pan)
+{
+}
+
+const VOICE_BACKEND VoiceNullBackend = {
+	VOICE_MAX_CHANNELS,
+	NullStart,
+	NullStop,
+	NullIsPlaying,
+	NullUpdate,
+	NULL,
+};
+
+static void VOICE_HeapSwap(int a, int b)
+{
+	short temp = Heap[a];
+	Heap[a] = Heap[b];
+	Heap[b] = temp;
+	Voices[Heap[a]].heapIndex = a;
+	Voices[Heap[b]].heapIndex = b;
+}
+
+static void VOICE_HeapUp(int i)
+{
+	while (i > 0)
+	{
+		int parent = (i - 1) / 2;
+		if (Voices[Heap[parent]].key <= Voices[Heap[i]].key)
+			break;
+		VOICE_HeapSwap(i, parent);
+		i = parent;
+	}
+}
+
+static void VOICE_HeapDown(int i)
+{
+	for (;;)
+	{
+		int left = i * 2 + 1;
+		int right = left + 1;
+		int min = i;
+		if (left < HeapCount && Voices[Heap[left]].key < Voices[Heap[min]].key)
+			min = left;
+		if (right < HeapCount && Voices[Heap[right]].key < Voices[Heap[min]].key)
+			min = right;
+		if (min == i)
+			break;
+		VOICE_HeapSwap(i, min);
+		i = min;
+	}
+}
+
+static void VOICE_HeapRemove(int i)
+{
+	if (--HeapCount == i)
+		return;
+	Heap[i] = Heap[HeapCount];
+	Voices[Heap[i]].heapIndex = i;
+	VOICE_HeapUp(i);
+	VOICE_HeapDown(Voices[Heap[i]].heapIndex);
+}
+
+static void VOICE_SetKey(VOICE* voice, int key)
+{
+	voice->key = key;
+	VOICE_HeapUp(voice->heapIndex);
+	VOICE_HeapDown(voice->heapIndex);
+}
+
+static short VOICE_First(int lut)
+{
+	if (lut < 0 || lut >= (int)LutVoices.size())
+		return -1;
+	return LutVoices[lut];
+}
+
+static void VOICE_Link(short id)
+{
+	VOICE* voice = &Voices[id];
+	int lut = voice->slot.sampleIdx;
+	if (lut >= (int)LutVoices.size())
+		LutVoices.resize(lut + 1, -1);
+	voice->prevLut = -1;
+	voice->nextLut = LutVoices[lut];
+	if (voice->nextLut >= 0)
+		Voices[voice->nextLut].prevLut = id;
+	LutVoices[lut] = id;
+}
+
+static void VOICE_Unlink(short id)
+{
+	VOICE* voice = &Voices[id];
+	if (voice->prevLut >= 0)
+		Voices[voice->prevLut].nextLut = voice->nextLut;
+	else
+		LutVoices[voice->slot.sampleIdx] = voice->nextLut;
+	if (voice->nextLut >= 0)
+		Voices[voice->nextLut].prevLut = voice->prevLut;
+}
+
+static bool VOICE_Bind(short id, int channel)
+{
+	VOICE* voice = &Voices[id];
+	if (!Backend->Start(channel, voice->sample, voice->slot.volume, voice->slot.pitch, voice->slot.pan, voice->looped))
+	{
+		FreeChannels[FreeChannelsCount++] = channel;
+		return false;
+	}
+	voice->channel = channel;
+	voice->key = voice->slot.volume;
+	voice->heapIndex = HeapCount;
+	Heap[HeapCount++] = id;
+	VOICE_HeapUp(voice->heapIndex);
+	ChannelVoices[channel] = id;
+	return true;
+}
+
+static void VOICE_Unbind(VOICE* voice)
+{
+	Backend->Stop(voice->channel);
+	VOICE_HeapRemove(voice->heapIndex);
+	ChannelVoices[voice->channel] = -1;
+	FreeChannels[FreeChannelsCount++] = voice->channel;
+	voice->channel = -1;
+	voice->heapIndex = -1;
+}
+
+static void VOICE_Release(short id)
+{
+	VOICE* voice = &Voices[id];
+	if (voice->channel >= 0)
+		VOICE_Unbind(voice);
+	VOICE_Unlink(id);
+	voice->slot.sampleIdx = -1;
+	voice->active = false;
+	voice->nextFree = FreeVoice;
+	FreeVoice = id;
+}
+
+// Returns a free channel, or steals the one of the quietest real voice if it
+// plays no louder than the volume. The finished one-shots are released only
+// by VOICE_EndScene, so until then they are stolen like the playing ones.
+static int VOICE_AcquireChannel(int volume)
+{
+	if (FreeChannelsCount)
+		return FreeChannels[--FreeChannelsCount];
+	if (!HeapCount || Voices[Heap[0]].key > volume)
+		return -1;
+
+	short id = Heap[0];
+	if (Voices[id].looped)
+	{
+		VOICE_Unbind(&Voices[id]);
+		++Counters.virtualized;
+	}
+	else
+	{
+		VOICE_Release(id);
+	}
+	++Counters.steals;
+	return FreeChannels[--FreeChannelsCount];
+}
+
+static void VOICE_Reset()
+{
+	FreeVoice = -1;
+	for (int i = VOICE_MAX - 1; i >= 0; --i)
+	{
+		Voices[i].slot.sampleIdx = -1;
+		Voices[i].channel = -1;
+		Voices[i].heapIndex = -1;
+		Voices[i].active = false;
+		Voices[i].nextFree = FreeVoice;
+		FreeVoice = i;
+	}
+	FreeChannelsCount = 0;
+	for (int i = VOICE_MAX_CHANNELS - 1; i >= 0; --i)
+	{
+		ChannelVoices[i] = -1;
+		if (Backend != NULL && i < Backend->channelCount)
+			FreeChannels[FreeChannelsCount++] = i;
+	}
+	HeapCount = 0;
+	LutVoices.clear();
+	memset(&Counters, 0, sizeof(Counters));
+	memset(&Stats, 0, sizeof(Stats));
+}
+
+void VOICE_SetBackend(const VOICE_BACKEND* backend)
+{
+	if (backend != NULL && backend->channelCount > VOICE_MAX_CHANNELS)
+		LogWarn("The voice manager uses %d of %d channels", VOICE_MAX_CHANNELS, backend->channelCount);
+	Backend = backend;
+	VOICE_Reset();
+}
+
+void VOICE_StopAll()
+{
+	if (Backend == NULL)
+		return;
+	if (Backend->StopAll != NULL)
+		Backend->StopAll();
+	else
+		for (int i = 0; i < Backend->channelCount && i < VOICE_MAX_CHANNELS; ++i)
+			Backend->Stop(i);
+	VOICE_Reset();
+}
+
+bool VOICE_IsSamplePlaying(int lut)
+{
+	if (Backend == NULL)
+		return false;
+
+	short next;
+	for (short id = VOICE_First(lut); id >= 0; id = next)
+	{
+		VOICE* voice = &Voices[id];
+		next = voice->nextLut;
+		if (voice->channel >= 0 ? Backend->IsPlaying(voice->channel) : voice->looped)
+			return true;
+		VOICE_Release(id);
+	}
+	return false;
+}
+
+void VOICE_StopSample(int lut)
+{
+	if (Backend == NULL)
+		return;
+
+	short id = VOICE_First(lut);
+	if (id >= 0)
+		VOICE_Release(id);
+}
+
+void VOICE_StopSamples(int lutFirst, int lutEnd)
+{
+	if (Backend == NULL)
+		return;
+
+	for (int lut = lutFirst; lut < lutEnd; ++lut)
+	{
+		for (short id = VOICE_First(lut); id >= 0; id = VOICE_First(lut))
+			VOICE_Release(id);
+	}
+}
+
+// Returns -1 if the loop is not playing, 0 if it is already played louder
+// during this frame, 1 if it is updated
+int VOICE_UpdateLoop(int lut, const SOUND_SLOT* params)
+{
+	if (Backend == NULL)
+		return -1;
+
+	short id = VOICE_First(lut);
+	if (id < 0)
+		return -1;
+	VOICE* voice = &Voices[id];
+	if (params->volume <= voice->slot.volume)
+		return 0;
+	voice->slot = *params;
+	voice->slot.sampleIdx = lut;
+	return 1;
+}
+
+bool VOICE_Play(const SOUND_SLOT* params, int sample, bool looped)
+{
+	if (Backend == NULL)
+		return false;
+	if (FreeVoice < 0)
+	{
+		++Counters.rejected;
+		return false;
+	}
+
+	int channel = -1;
+	if (!looped || params->volume >= VOICE_AUDIBLE_VOLUME)
+		channel = VOICE_AcquireChannel(params->volume);
+	if (channel < 0 && !looped)
+	{
+		++Counters.rejected;
+		return false;
+	}
+
+	short id = FreeVoice;
+	VOICE* voice = &Voices[id];
+	FreeVoice = voice->nextFree;
+	voice->slot = *params;
+	voice->sample = sample;
+	voice->channel = -1;
+	voice->heapIndex = -1;
+	voice->looped = looped;
+	voice->active = true;
+	VOICE_Link(id);
+	if (channel >= 0 && !VOICE_Bind(id, channel) && !looped)
+	{
+		VOICE_Release(id);
+		return false;
+	}
+	return true;
+}
+
+void VOICE_EndScene(void (*updatePanVolume)(SOUND_SLOT* slot))
+{
+	if (Backend == NULL)
+		return;
+
+	for (short id = 0; id < VOICE_MAX; ++id)
+	{
+		VOICE* voice = &Voices[id];
+		if (!voice->active)
+			continue;
+		if (!voice->looped)
+		{
+			if (!Backend->IsPlaying(voice->channel))
+				VOICE_Release(id);
+			continue;
+		}
+		// The loop is stopped if no emitter played it during this frame
+		if (!voice->slot.volume)
+		{
+			VOICE_Release(id);
+			continue;
+		}
+		updatePanVolume(&voice->slot);
+		if (voice->channel < 0)
+			continue;
+		if (voice->slot.volume < VOICE_AUDIBLE_VOLUME)
+		{
+			VOICE_Unbind(voice);
+			++Counters.virtualized;
+			continue;
+		}
+		Backend->Update(voice->channel, voice->slot.volume, voice->slot.pitch, voice->slot.pan);
+		VOICE_SetKey(voice, voice->slot.volume);
+	}
+
+	// A virtual loop must be strictly louder to take a channel back,
+	// otherwise two equal loops would swap their channels every frame
+	int activeVoices = 0;
+	for (short id = 0; id < VOICE_MAX; ++id)
+	{
+		VOICE* voice = &Voices[id];
+		if (!voice->active)
+			continue;
+		++activeVoices;
+		if (!voice->looped)
+			continue;
+		if (voice->channel < 0 && voice->slot.volume >= VOICE_AUDIBLE_VOLUME)
+		{
+			int channel = VOICE_AcquireChannel(voice->slot.volume - 1);
+			if (channel >= 0 && VOICE_Bind(id, channel))
+				++Counters.restored;
+		}
+		voice->slot.volume = 0;
+	}
+
+	Stats = Counters;
+	Stats.realVoices = HeapCount;
+	Stats.virtualVoices = activeVoices - HeapCount;
+	memset(&Counters, 0, sizeof(Counters));
+}
+
+const VOICE_STATS* VOICE_GetStats()
+{
+	return &Stats;
+}
+
+#endif // FEATURE_VOICE_MANAGER
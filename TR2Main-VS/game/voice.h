@@ -0,0 +1,37 @@
+#pragma once
+
+#include "global/types.h"
+
+#define VOICE_MAX_CHANNELS (256)
+
+// The output that plays the voices. A channel plays one voice at a time, the
+// volume and pan use the same units as SOUND_SLOT.
+typedef struct VoiceBackend_t {
+	int channelCount;
+	bool (*Start)(int channel, int sample, int volume, int pitch, int pan, bool looped);
+	void (*Stop)(int channel);
+	bool (*IsPlaying)(int channel);
+	void (*Update)(int channel, int volume, int pitch, int pan);
+	void (*StopAll)(); // optional, stops all the channels at once
+} VOICE_BACKEND;
+
+typedef struct VoiceStats_t {
+	int realVoices;
+	int virtualVoices;
+	int steals;
+	int rejected;
+	int virtualized;
+	int restored;
+} VOICE_STATS;
+
+extern const VOICE_BACKEND VoiceNullBackend;
+
+extern void VOICE_SetBackend(const VOICE_BACKEND* backend);
+extern void VOICE_StopAll();
+extern bool VOICE_IsSamplePlaying(int lut);
+extern void VOICE_StopSample(int lut);
+extern void VOICE_StopSamples(int lutFirst, int lutEnd);
+extern int VOICE_UpdateLoop(int lut, const SOUND_SLOT* params);
+extern bool VOICE_Play(const SOUND_SLOT* params, int sample, bool looped);
+extern void VOICE_EndScene(void (*updatePanVolume)(SOUND_SLOT* slot));
+extern const VOICE_STATS* VOICE_GetStats();
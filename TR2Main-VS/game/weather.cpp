@@ -5,234 +5,349 @@
 #include "game/control.h"
 #include "game/collide.h"
 #include "game/effects.h"
+#include "game/interp.h"
 #include "specific/init.h"
 #include "specific/game.h"
 #include "specific/output.h"
 #include "modding/mod_utils.h"
 
-struct WEATHER_INFO
+// Sector of a rain/snow room from which particles can be spawned.
+// The ceiling is resolved once when the level is loaded (or the map is flipped).
+struct WEATHER_EMITTER
 {
-	int x, y, z;
-	int xv, yv, zv;
+	int x, z;
+	int ceiling;
 	short room;
-	BYTE life;
-	bool on;
-	bool stopped;
 };
 
-static WEATHER_INFO SnowList[MAX_WEATHER_SNOW], RainList[MAX_WEATHER_RAIN];
-static int SnowCount = 0, RainCount = 0;
+// Packed SoA particle pool: the live particles are always [0, count),
+// dead ones are removed by moving the last live particle into their slot.
+// Each particle caches the floor height of the sector it is above, along with
+// the Y at which it leaves its current room, so GetFloor()/GetHeight() are only
+// called again when the particle crosses a sector or a room boundary.
+template<int SIZE>
+struct WEATHER_POOL
+{
+	int x[SIZE], y[SIZE], z[SIZE];
+	int height[SIZE];
+	int limitY[SIZE];
+	int sector[SIZE];
+	short xv[SIZE], yv[SIZE], zv[SIZE];
+	short room[SIZE];
+	BYTE life[SIZE];
+	bool stopped[SIZE];
+	int count;
+
+	void Clear() {
+		count = 0;
+	}
+
+	void Kill(int i) {
+		int last = --count;
+		if (i == last)
+			return;
+		x[i] = x[last]; y[i] = y[last]; z[i] = z[last];
+		height[i] = height[last];
+		limitY[i] = limitY[last];
+		sector[i] = sector[last];
+		xv[i] = xv[last]; yv[i] = yv[last]; zv[i] = zv[last];
+		room[i] = room[last];
+		life[i] = life[last];
+		stopped[i] = stopped[last];
+	}
+};
+
+static WEATHER_POOL<MAX_WEATHER_RAIN> RainPool;
+static WEATHER_POOL<MAX_WEATHER_SNOW> SnowPool;
+static std::vector<WEATHER_EMITTER> RainEmitters, SnowEmitters;
+
+static inline int WEATHER_GetSectorKey(int x, int z)
+{
+	return ((x >> WALL_SHIFT) & 0xFFFF) | ((z >> WALL_SHIFT) << 16);
+}
 
-static GAME_VECTOR WEATHER_GetRoomSquareRandomPos(short roomNumber)
+// Refresh the cached floor data of the particle; returns the floor under it.
+template<int SIZE>
+static FLOOR_INFO* WEATHER_UpdateSector(WEATHER_POOL<SIZE>& pool, int i)
+{
+	FLOOR_INFO* floor = GetFloor(pool.x[i], pool.y[i], pool.z[i], &pool.room[i]);
+	pool.height[i] = GetHeight(floor, pool.x[i], pool.y[i], pool.z[i]);
+	pool.sector[i] = WEATHER_GetSectorKey(pool.x[i], pool.z[i]);
+	// GetFloor() moves the particle to the pit room once it passes the floor of this sector
+	pool.limitY[i] = (floor->pitRoom != NO_ROOM) ? ((int)floor->floor << 8) : INT_MAX;
+	return floor;
+}
+
+template<int SIZE>
+static inline bool WEATHER_IsSectorChanged(WEATHER_POOL<SIZE>& pool, int i)
+{
+	return pool.sector[i] != WEATHER_GetSectorKey(pool.x[i], pool.z[i]) || pool.y[i] >= pool.limitY[i];
+}
+
+static void WEATHER_BuildRoomEmitters(short roomNumber, std::vector<WEATHER_EMITTER>& emitters)
 {
-	GAME_VECTOR vec = { 0, 0, 0, 0 };
 	ROOM_INFO* r = &Rooms[roomNumber];
+	// Skip the outer sectors, these are always walls or portals
+	for (int sx = 1; sx < r->xSize - 1; sx++) {
+		for (int sz = 1; sz < r->zSize - 1; sz++) {
+			int x = r->x + BLOCK(sx) + WALL_SIZE / 2;
+			int z = r->z + BLOCK(sz) + WALL_SIZE / 2;
+			int y = r->maxCeiling + 1;
+			short roomNum = roomNumber;
+			FLOOR_INFO* floor = GetFloor(x, y, z, &roomNum);
+			int height = GetHeight(floor, x, y, z);
+			int ceiling = GetCeiling(floor, x, y, z);
+			if (height == NO_HEIGHT || ceiling == NO_HEIGHT || ceiling >= height)
+				continue;
+			if (CHK_ANY(Rooms[roomNum].flags, ROOM_UNDERWATER))
+				continue;
+			WEATHER_EMITTER emitter;
+			emitter.x = r->x + BLOCK(sx);
+			emitter.z = r->z + BLOCK(sz);
+			emitter.ceiling = ceiling;
+			emitter.room = roomNum;
+			emitters.push_back(emitter);
+		}
+	}
+}
+
+static const WEATHER_EMITTER* WEATHER_GetRandomEmitter(const std::vector<WEATHER_EMITTER>& emitters)
+{
+	DWORD rnd = ((DWORD)GetRandomDraw() << 15) | (DWORD)GetRandomDraw();
+	return &emitters[rnd % emitters.size()];
+}
+
+void WEATHER_BuildEmitters()
+{
+	RainEmitters.clear();
+	SnowEmitters.clear();
+	for (short i = 0; i < RoomCount; i++) {
+		ROOM_INFO* r = &Rooms[i];
+		if (CHK_ANY(r->flags, ROOM_RAIN))
+			WEATHER_BuildRoomEmitters(i, RainEmitters);
+		if (CHK_ANY(r->flags, ROOM_SNOW))
+			WEATHER_BuildRoomEmitters(i, SnowEmitters);
+	}
+}
+
+void WEATHER_InitialiseLevel()
+{
+	RainPool.Clear();
+	SnowPool.Clear();
+	WEATHER_BuildEmitters();
+}
+
+static void WEATHER_SpawnRain()
+{
+	int density = std::min<int>(Mod.rainDensity, MAX_WEATHER_RAIN);
+	if (RainEmitters.empty())
+		return;
+
+	while (RainPool.count < density) {
+		const WEATHER_EMITTER* emitter = WEATHER_GetRandomEmitter(RainEmitters);
+		int i = RainPool.count++;
+		RainPool.x[i] = emitter->x + (GetRandomDraw() & (WALL_SIZE - 1));
+		RainPool.y[i] = emitter->ceiling;
+		RainPool.z[i] = emitter->z + (GetRandomDraw() & (WALL_SIZE - 1));
+		RainPool.xv[i] = (GetRandomDraw() & 7) - 4;
+		RainPool.yv[i] = (GetRandomDraw() & 14) + GetRenderScale(8);
+		RainPool.zv[i] = (GetRandomDraw() & 7) - 4;
+		RainPool.life[i] = 255;
+		RainPool.room[i] = emitter->room;
+		RainPool.stopped[i] = false;
+		WEATHER_UpdateSector(RainPool, i);
+	}
+}
+
+static void WEATHER_SpawnSnow()
+{
+	int density = std::min<int>(Mod.snowDensity, MAX_WEATHER_SNOW);
+	if (SnowEmitters.empty())
+		return;
+
+	while (SnowPool.count < density) {
+		const WEATHER_EMITTER* emitter = WEATHER_GetRandomEmitter(SnowEmitters);
+		int i = SnowPool.count++;
+		SnowPool.x[i] = emitter->x + (GetRandomDraw() & (WALL_SIZE - 1));
+		SnowPool.y[i] = emitter->ceiling;
+		SnowPool.z[i] = emitter->z + (GetRandomDraw() & (WALL_SIZE - 1));
+		SnowPool.xv[i] = (GetRandomDraw() & 7) - 4;
+		SnowPool.yv[i] = (GetRandomDraw() % 24 + 8) << 3;
+		SnowPool.zv[i] = (GetRandomDraw() & 7) - 4;
+		SnowPool.life[i] = 255;
+		SnowPool.room[i] = emitter->room;
+		SnowPool.stopped[i] = false;
+		WEATHER_UpdateSector(SnowPool, i);
+	}
+}
+
+static inline DWORD WEATHER_GetSnowShade(const WEATHER_POOL<MAX_WEATHER_SNOW>& pool, int i)
+{
+	BYTE c;
+	if ((pool.yv[i] & 7) < 7)
+		c = pool.yv[i] & 7;
+	else if (pool.life[i] > 18)
+		c = 16;
+	else
+		c = pool.life[i]; // Below 255, use life directly
+	c <<= 3; // Adjust brightness scaling
+	return RGB_MAKE(c, c, c);
+}
 
-	// Calculate the room's boundaries in world coordinates
-	int sizeX = BLOCK(r->xSize);  // Full width of the room (east-west)
-	int sizeZ = BLOCK(r->zSize); // Full length of the room (north-south)
-	int minX = r->x - sizeX;  // Minimum X position (center minus half the width)
-	int maxX = r->x + sizeX;  // Maximum X position (center plus half the width)
-	int minZ = r->z - sizeZ; // Minimum Z position (center minus half the length)
-	int maxZ = r->z + sizeZ; // Maximum Z position (center plus half the length)
-
-	// Ensure that the random values are distributed across the entire room size
-	// Generate random X and Z positions within the room boundaries
-	vec.x = minX + (GetRandomDrawWithNegInt() % (maxX - minX + 1));
-	vec.y = r->maxCeiling + 1; // Start Y position; GetCeiling will adjust it
-	vec.z = minZ + (GetRandomDrawWithNegInt() % (maxZ - minZ + 1));
-
-	// Get the ceiling Y position
-	short roomNum = roomNumber;
-	vec.y = GetCeiling(GetFloor(vec.x, vec.y, vec.z, &roomNum), vec.x, vec.y, vec.z);
-	if (vec.y == NO_HEIGHT)
-		return vec;
-	vec.roomNumber = roomNum;
-	vec.boxNumber = TRUE;
-	return vec;
+#ifdef FEATURE_RENDER_INTERPOLATION
+// The interpolated frames are drawn between the game ticks, so they only draw
+// the particles where the last tick left them. Otherwise the rain and snow
+// would fall faster with higher frame rate.
+static void WEATHER_DrawRain(DWORD flags, short spriteIdx)
+{
+	auto& pool = RainPool;
+	for (int i = 0; i < pool.count; ++i)
+		S_DrawSprite(flags, pool.x[i], pool.y[i], pool.z[i], spriteIdx, 0, 1024);
 }
 
+static void WEATHER_DrawSnow(DWORD flags, short spriteIdx)
+{
+	auto& pool = SnowPool;
+	for (int i = 0; i < pool.count; ++i)
+		S_DrawSprite(WEATHER_GetSnowShade(pool, i) | flags, pool.x[i], pool.y[i], pool.z[i], spriteIdx, 0, 1024);
+}
+#endif // FEATURE_RENDER_INTERPOLATION
+
 void WEATHER_UpdateAndDrawRain()
 {
-	for (int i = 0; i < MAX_WEATHER_RAIN; i++) {
-		auto& rainDrop = RainList[i];
-
-		for (short j = 0; j < RoomCount; j++) {
-			auto* r = &Rooms[j];
-			if (CHK_ANY(r->flags, ROOM_RAIN)) {
-				if (!rainDrop.on && RainCount < Mod.rainDensity) {
-					GAME_VECTOR vec = WEATHER_GetRoomSquareRandomPos(r->index);
-					if (vec.boxNumber == TRUE)
-					{
-						rainDrop.x = vec.x;
-						rainDrop.y = vec.y;
-						rainDrop.z = vec.z;
-						rainDrop.xv = (GetRandomDraw() & 7) - 4;
-						rainDrop.yv = (GetRandomDraw() & 14) + GetRenderScale(8);
-						rainDrop.zv = (GetRandomDraw() & 7) - 4;
-						rainDrop.life = 255;
-						rainDrop.room = vec.roomNumber;
-						rainDrop.on = true;
-						rainDrop.stopped = false;
-						RainCount++;
-					}
-				}
+	auto& pool = RainPool;
+	DWORD flags = SPR_ABS | (Mod.isRainOpaque ? 0 : SPR_SEMITRANS) | SPR_SCALE;
+	short spriteIdx = Objects[ID_WEATHER_SPRITE].meshIndex;
+
+#ifdef FEATURE_RENDER_INTERPOLATION
+	if (INTERP_IsExtraFrame()) {
+		WEATHER_DrawRain(flags, spriteIdx);
+		return;
+	}
+#endif // FEATURE_RENDER_INTERPOLATION
+	WEATHER_SpawnRain();
+
+	for (int i = 0; i < pool.count; ) {
+		if (WEATHER_IsSectorChanged(pool, i))
+			WEATHER_UpdateSector(pool, i);
+
+		if (pool.height[i] == NO_HEIGHT || pool.height[i] <= pool.y[i] || CHK_ANY(Rooms[pool.room[i]].flags, ROOM_UNDERWATER)) {
+			if (Mod.rainSplashEnabled) {
+				auto* floor = GetFloor(pool.x[i], pool.y[i], pool.z[i], &pool.room[i]);
+				int ceiling = GetCeiling(floor, pool.x[i], pool.y[i], pool.z[i]);
+				if (ceiling != NO_HEIGHT && ceiling <= pool.y[i])
+					CreateRainSpash(Mod.rainSplashColor, pool.x[i], pool.y[i] - 64, pool.z[i], Mod.rainSplashSize, pool.room[i]);
 			}
+			pool.Kill(i);
+			continue;
 		}
 
-		if (rainDrop.on)
+		if (Mod.rainDoDamageOnHit)
 		{
-			auto* floor = GetFloor(rainDrop.x, rainDrop.y, rainDrop.z, &rainDrop.room);
-			int height = GetHeight(floor, rainDrop.x, rainDrop.y, rainDrop.z);
-			if ((height == NO_HEIGHT || height <= rainDrop.y) || CHK_ANY(Rooms[rainDrop.room].flags, ROOM_UNDERWATER)) {
-				int ceiling = GetCeiling(floor, rainDrop.x, rainDrop.y, rainDrop.z);
-				if (ceiling != NO_HEIGHT && ceiling <= rainDrop.y)
-				{
-					if (Mod.rainSplashEnabled)
-						CreateRainSpash(Mod.rainSplashColor, rainDrop.x, rainDrop.y - 64, rainDrop.z, Mod.rainSplashSize, rainDrop.room);
-				}
-				rainDrop.on = false;
-				RainCount--;
-				continue;
-			}
-			
-			if (Mod.rainDoDamageOnHit)
+			PHD_3DPOS effectPos = {};
+			effectPos.x = pool.x[i];
+			effectPos.y = pool.y[i];
+			effectPos.z = pool.z[i];
+			if (ItemNearLara(&effectPos, Mod.rainDamageRange))
 			{
-				PHD_3DPOS effectPos = {};
-				effectPos.x = rainDrop.x;
-				effectPos.y = rainDrop.y;
-				effectPos.z = rainDrop.z;
-				if (ItemNearLara(&effectPos, Mod.rainDamageRange))
-				{
-					DoBloodSplat(rainDrop.x, rainDrop.y, rainDrop.z, 5, LaraItem->pos.rotY + ANGLE(180), rainDrop.room);
-					LaraItem->hitPoints -= Mod.rainDamage;
-					LaraItem->hitStatus = TRUE;
-					rainDrop.on = false;
-					RainCount--;
-					continue;
-				}
+				DoBloodSplat(pool.x[i], pool.y[i], pool.z[i], 5, LaraItem->pos.rotY + ANGLE(180), pool.room[i]);
+				LaraItem->hitPoints -= Mod.rainDamage;
+				LaraItem->hitStatus = TRUE;
+				pool.Kill(i);
+				continue;
 			}
+		}
 
-			rainDrop.x += rainDrop.xv + 4 * SmokeWindX;
-			rainDrop.y += rainDrop.yv << 3;
-			rainDrop.z += rainDrop.zv + 4 * SmokeWindZ;
+		pool.x[i] += pool.xv[i] + 4 * SmokeWindX;
+		pool.y[i] += pool.yv[i] << 3;
+		pool.z[i] += pool.zv[i] + 4 * SmokeWindZ;
 
-			int rnd = GetRandomDraw();
-			if ((rnd & 3) != 3) {
-				rainDrop.xv += (rnd & 3) - 1;
-				rainDrop.xv = std::clamp(rainDrop.xv, -4, 4);
-			}
+		int rnd = GetRandomDraw();
+		if ((rnd & 3) != 3)
+			pool.xv[i] = std::clamp(pool.xv[i] + (rnd & 3) - 1, -4, 4);
 
-			rnd = (rnd >> 2) & 3;
-			if (rnd != 3) {
-				rainDrop.zv += rnd - 1;
-				rainDrop.zv = std::clamp(rainDrop.zv, -4, 4);
-			}
+		rnd = (rnd >> 2) & 3;
+		if (rnd != 3)
+			pool.zv[i] = std::clamp(pool.zv[i] + rnd - 1, -4, 4);
 
-			rainDrop.life -= 2;
-			if (rainDrop.life <= 0) {
-				rainDrop.on = false;
-				RainCount--;
-			}
+		S_DrawSprite(flags, pool.x[i], pool.y[i], pool.z[i], spriteIdx, 0, 1024);
 
-			S_DrawSprite(SPR_ABS | (Mod.isRainOpaque ? 0 : SPR_SEMITRANS) | SPR_SCALE, rainDrop.x, rainDrop.y, rainDrop.z, Objects[ID_WEATHER_SPRITE].meshIndex, 0, 1024);
+		pool.life[i] -= 2;
+		if (pool.life[i] <= 0) {
+			pool.Kill(i);
+			continue;
 		}
+		i++;
 	}
 }
 
 void WEATHER_UpdateAndDrawSnow()
 {
-	for (int i = 0; i < MAX_WEATHER_SNOW; i++) {
-		auto& snowDrop = SnowList[i];
+	auto& pool = SnowPool;
+	DWORD flags = SPR_TINT | SPR_ABS | (Mod.isSnowOpaque ? 0 : SPR_SEMITRANS) | SPR_SCALE;
+	short spriteIdx = Objects[ID_WEATHER_SPRITE].meshIndex + 1;
 
-		for (short j = 0; j < RoomCount; j++)
+#ifdef FEATURE_RENDER_INTERPOLATION
+	if (INTERP_IsExtraFrame()) {
+		WEATHER_DrawSnow(flags, spriteIdx);
+		return;
+	}
+#endif // FEATURE_RENDER_INTERPOLATION
+	WEATHER_SpawnSnow();
+
+	for (int i = 0; i < pool.count; ) {
+		if (CHK_ANY(Rooms[pool.room[i]].flags, ROOM_UNDERWATER))
 		{
-			auto* r = &Rooms[j];
-			if (CHK_ANY(r->flags, ROOM_SNOW)) {
-				if (!snowDrop.on && SnowCount < Mod.snowDensity) {
-					GAME_VECTOR vec = WEATHER_GetRoomSquareRandomPos(r->index);
-					if (vec.boxNumber == TRUE)
-					{
-						snowDrop.x = vec.x;
-						snowDrop.y = vec.y;
-						snowDrop.z = vec.z;
-						snowDrop.xv = (GetRandomDraw() & 7) - 4;
-						snowDrop.yv = (GetRandomDraw() % 24 + 8) << 3;
-						snowDrop.zv = (GetRandomDraw() & 7) - 4;
-						snowDrop.life = 255;
-						snowDrop.room = vec.roomNumber;
-						snowDrop.on = true;
-						snowDrop.stopped = false;
-						SnowCount++;
-					}
-				}
-			}
+			pool.Kill(i);
+			continue;
 		}
 
-		if (snowDrop.on)
+		if (!pool.stopped[i])
 		{
-			if (CHK_ANY(Rooms[snowDrop.room].flags, ROOM_UNDERWATER))
-			{
-				snowDrop.on = false;
-				SnowCount--;
-				continue;
-			}
-
-			if (!snowDrop.stopped)
+			if (WEATHER_IsSectorChanged(pool, i))
+				WEATHER_UpdateSector(pool, i); // Update room number if it has changed rooms.
+			int height = pool.height[i];
+			if (height == NO_HEIGHT || height <= pool.y[i])
 			{
-				auto* floor = GetFloor(snowDrop.x, snowDrop.y, snowDrop.z, &snowDrop.room); // Update room number if it has changed rooms.
-				auto height = GetHeight(floor, snowDrop.x, snowDrop.y, snowDrop.z);
-				if (height == NO_HEIGHT || height <= snowDrop.y)
-				{
-					snowDrop.xv = 0;
-					snowDrop.yv = 0;
-					snowDrop.zv = 0;
-					snowDrop.y = height;
-					snowDrop.stopped = true;
-					if (snowDrop.life > 16)
-						snowDrop.life = 16;
-				}
-				else
-				{
-					snowDrop.x += snowDrop.xv;
-					snowDrop.y += (snowDrop.yv & 0xF8) >> 2;
-					snowDrop.z += snowDrop.zv;
-				}
+				pool.xv[i] = 0;
+				pool.yv[i] = 0;
+				pool.zv[i] = 0;
+				pool.y[i] = height;
+				pool.stopped[i] = true;
+				if (pool.life[i] > 16)
+					pool.life[i] = 16;
 			}
-
-			if (snowDrop.life <= 0)
+			else
 			{
-				snowDrop.on = false;
-				SnowCount--;
-				continue;
+				pool.x[i] += pool.xv[i];
+				pool.y[i] += (pool.yv[i] & 0xF8) >> 2;
+				pool.z[i] += pool.zv[i];
 			}
+		}
 
-			snowDrop.life--;
-			if (!snowDrop.stopped)
-			{
-				if (snowDrop.xv < SmokeWindX << 1)
-					snowDrop.xv++;
-				else if (snowDrop.xv > SmokeWindX << 1)
-					snowDrop.xv--;
-				if (snowDrop.zv < SmokeWindZ << 1)
-					snowDrop.zv++;
-				else if (snowDrop.zv > SmokeWindZ << 1)
-					snowDrop.zv--;
-				if ((snowDrop.yv & 7) != 7)
-					snowDrop.yv++;
-			}
+		if (pool.life[i] <= 0)
+		{
+			pool.Kill(i);
+			continue;
+		}
 
-			// Draw the sprite on the scene.
-			BYTE c;
-			if ((snowDrop.yv & 7) < 7)
-				c = snowDrop.yv & 7;
-			else if (snowDrop.life > 18.0f)
-				c = 16;
-			else
-				c = snowDrop.life; // Below 255, use life directly
-			c <<= 3; // Adjust brightness scaling
-			S_DrawSprite(RGB_MAKE(c, c, c) | SPR_TINT | SPR_ABS | (Mod.isSnowOpaque ? 0 : SPR_SEMITRANS) | SPR_SCALE, snowDrop.x, snowDrop.y, snowDrop.z, Objects[ID_WEATHER_SPRITE].meshIndex + 1, 0, 1024);
+		pool.life[i]--;
+		if (!pool.stopped[i])
+		{
+			if (pool.xv[i] < SmokeWindX << 1)
+				pool.xv[i]++;
+			else if (pool.xv[i] > SmokeWindX << 1)
+				pool.xv[i]--;
+			if (pool.zv[i] < SmokeWindZ << 1)
+				pool.zv[i]++;
+			else if (pool.zv[i] > SmokeWindZ << 1)
+				pool.zv[i]--;
+			if ((pool.yv[i] & 7) != 7)
+				pool.yv[i]++;
 		}
+
+		// Draw the sprite on the scene.
+		S_DrawSprite(WEATHER_GetSnowShade(pool, i) | flags, pool.x[i], pool.y[i], pool.z[i], spriteIdx, 0, 1024);
+		i++;
 	}
 }
-
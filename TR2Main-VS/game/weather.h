@@ -1,4 +1,6 @@
 #pragma once
 
+extern void WEATHER_BuildEmitters();
+extern void WEATHER_InitialiseLevel();
 extern void WEATHER_UpdateAndDrawRain();
 extern void WEATHER_UpdateAndDrawSnow();
@@ -36,20 +36,33 @@
 #define FEATURE_ASSAULT_SAVE
 #define FEATURE_AUDIO_IMPROVED
 #define FEATURE_BACKGROUND_IMPROVED
+#define FEATURE_BENCHMARK
 #define FEATURE_CHEAT
 #define FEATURE_EXTENDED_LIMITS
 #define FEATURE_FFPLAY
+#define FEATURE_FRAME_PACER
 #define FEATURE_GAMEPLAY_FIXES
 #define FEATURE_GOLD
 #define FEATURE_HUD_IMPROVED
 #define FEATURE_INPUT_IMPROVED
 #define FEATURE_MOD_CONFIG
+#define FEATURE_MOD_CONFIG_CACHE
+#define FEATURE_NAV_GRAPH
 #define FEATURE_NOLEGACY_OPTIONS
+#define FEATURE_PARTICLES
+#define FEATURE_PATH_SCHEDULER
 #define FEATURE_PAULD_CDAUDIO
+#define FEATURE_PROFILER
+#define FEATURE_RENDER_INTERPOLATION
+#define FEATURE_SAMPLE_BANK
 #define FEATURE_SCREENSHOT_IMPROVED
+#define FEATURE_SOFTWARE_MIXER
 #define FEATURE_SUBFOLDERS
+#define FEATURE_VERTEX_SIMD
 #define FEATURE_VIDEOFX_IMPROVED
 #define FEATURE_VIEW_IMPROVED
+#define FEATURE_VISIBILITY_CACHE
+#define FEATURE_VOICE_MANAGER
 #define FEATURE_WINDOW_STYLE_FIX
 
 #define DIRECT3D_VERSION 0x900
@@ -724,6 +724,11 @@ typedef enum {
 	RM_Hardware,
 } RENDER_MODE;
 
+typedef enum {
+	POLYSORT_Quick,
+	POLYSORT_Radix,
+} POLYSORT_MODE;
+
 typedef enum {
 	AM_4_3,
 	AM_16_9,
@@ -2079,6 +2084,11 @@ typedef struct RoomData_t {
 	FACE3* gt3;
 	USHORT spriteSize;
 	ROOM_SPRITE* sprites;
+#ifdef FEATURE_VERTEX_SIMD
+	// The x, y and z blocks of the vertex positions, each one is 16 byte
+	// aligned and padded to the multiple of 4 vertices
+	int* vtxSoA;
+#endif // FEATURE_VERTEX_SIMD
 } ROOM_DATA;
 
 typedef struct RoomInfo_t {
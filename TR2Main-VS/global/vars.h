@@ -82,6 +82,10 @@
 #define MAX_WEATHER_RAIN_ALIVE 2048
 #define MAX_WEATHER_SNOW 4096
 #define MAX_WEATHER_SNOW_ALIVE 2048
+#define MAX_PARTICLE_SPLASHES 2048
+#define MAX_PARTICLE_BLOOD 1024
+#define MAX_PARTICLE_RICOCHETS 256
+#define MAX_PARTICLE_BUBBLES 1024
 #define MAX_CREATURES 5
 #define MAX_FLIPMAPS 10
 #define MAX_CD 64
@@ -150,8 +154,13 @@ extern short InvOptionObjectsCount;
 #define DetailLevel					VAR_I_(0x00467724, DWORD,			1)
 #define MidSort						VAR_I_(0x0046C2F0, DWORD,			0)
 #define FltViewAspect				VAR_I_(0x0046C2F4, float,			0.0)
+#ifdef FEATURE_NOLEGACY_OPTIONS
+extern thread_local int XGen_y0;
+extern thread_local int XGen_y1;
+#else // FEATURE_NOLEGACY_OPTIONS
 #define XGen_y0						VAR_I_(0x0046C2F8, int,				0)
 #define XGen_y1						VAR_I_(0x0046C2FC, int,				0)
+#endif // FEATURE_NOLEGACY_OPTIONS
 
 // Uninitialized variables
 extern int PhdFov;
@@ -592,7 +601,11 @@ extern PHD_TEXTURE PhdTextureInfo[MAX_OBJECT_TEXTURES];
 #define MatrixStack					ARRAY_(0x004BCB48, PHD_MATRIX, [40])
 #define DepthQTable					ARRAY_(0x004BD2C8, DEPTHQ_ENTRY, [32])
 #define DepthQIndex					ARRAY_(0x004BF2C8, BYTE, [256])
+#if defined(FEATURE_EXTENDED_LIMITS)
+extern PHD_VBUF* PhdVBuf;
+#else // FEATURE_EXTENDED_LIMITS
 #define PhdVBuf						ARRAY_(0x004BF3D0, PHD_VBUF, [1500])
+#endif // FEATURE_EXTENDED_LIMITS
 #if defined(FEATURE_EXTENDED_LIMITS)
 extern BYTE* TexturePageBuffer8[MAX_TEXTURE_PAGES];
 #else // FEATURE_EXTENDED_LIMITS
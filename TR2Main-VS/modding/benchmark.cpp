@@ -0,0 +1,718 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/benchmark.h"
+#include "3dsystem/3d_gen.h"
+#include "3dsystem/3d_out.h"
+#include "game/control.h"
+#include "game/demo.h"
+#include "game/draw.h"
+#include "specific/output.h"
+#include "specific/sndpc.h"
+#include "specific/utils.h"
+#include "global/vars.h"
+
+#ifdef FEATURE_BENCHMARK
+#if defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+#include "game/box.h"
+#include "game/lot.h"
+#include "modding/navgraph.h"
+#endif // defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+
+#ifdef FEATURE_VIEW_IMPROVED
+extern DWORD PolySortMode;
+extern int FogBeginDepth;
+extern int FogEndDepth;
+#endif // FEATURE_VIEW_IMPROVED
+
+// The benchmark replays the demo of a level with the fixed seeds, but without
+// any drawing, sound, inventory or input polling. Each tick runs ControlTick,
+// the gameplay part of ControlPhase, and every subsystem is timed separately.
+// When the demo data is over, the simulation continues with no input.
+#define BENCH_DEFAULT_TICKS (9000)
+#define BENCH_REPORT_NAME "benchmark.txt"
+
+static LPCTSTR BenchNames[CTRL_Count] = {
+	"items",
+	"effects",
+	"lara",
+	"hair",
+	"camera",
+	"sound",
+};
+
+static LONGLONG BenchTimes[CTRL_Count];
+static LONGLONG BenchLast = 0;
+
+#ifdef FEATURE_VIEW_IMPROVED
+// Command line: benchsort draws the poly list of every BENCH_SORT_INTERVAL
+// tick without presenting it, and keeps a copy of the raw sort items. The
+// report replays the copies with both sort methods. The capture time isn't
+// counted in the benchmark time.
+#define BENCH_SORT_INTERVAL (120)
+#define BENCH_SORT_LISTS (64)
+#define BENCH_SORT_REPEATS (10)
+
+typedef struct {
+	SORT_ITEM* items;
+	DWORD count;
+} BENCH_SORT_LIST;
+
+static BENCH_SORT_LIST BenchSortLists[BENCH_SORT_LISTS];
+static int BenchSortListCount = 0;
+#endif // FEATURE_VIEW_IMPROVED
+
+static inline LONGLONG BENCH_Counter() {
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+static void BENCH_Mark(CONTROL_SUBSYSTEM subsystem) {
+	LONGLONG now = BENCH_Counter();
+	BenchTimes[subsystem] += now - BenchLast;
+	BenchLast = now;
+}
+
+#ifdef FEATURE_VIEW_IMPROVED
+static void BENCH_CaptureSortList() {
+	if (BenchSortListCount >= BENCH_SORT_LISTS) return;
+
+	DrawRooms(Camera.pos.roomNumber);
+	if (SurfaceCount > 0) {
+		SORT_ITEM* items = (SORT_ITEM*)malloc(sizeof(SORT_ITEM) * SurfaceCount);
+		if (items != NULL) {
+			memcpy(items, SortBuffer, sizeof(SORT_ITEM) * SurfaceCount);
+			BenchSortLists[BenchSortListCount].items = items;
+			BenchSortLists[BenchSortListCount].count = SurfaceCount;
+			++BenchSortListCount;
+		}
+	}
+	// the frame is finished as usual, but it's never presented
+	S_OutputPolyList();
+}
+
+static void BENCH_FreeSortLists() {
+	for (int i = 0; i < BenchSortListCount; ++i) {
+		free(BenchSortLists[i].items);
+	}
+	memset(BenchSortLists, 0, sizeof(BenchSortLists));
+	BenchSortListCount = 0;
+}
+#endif // FEATURE_VIEW_IMPROVED
+
+// The checksum allows to compare the final state of two runs
+static DWORD BENCH_Checksum() {
+	DWORD data[] = {
+		(DWORD)LaraItem->pos.x, (DWORD)LaraItem->pos.y, (DWORD)LaraItem->pos.z,
+		(DWORD)LaraItem->pos.rotY, (DWORD)LaraItem->hitPoints, (DWORD)LaraItem->roomNumber,
+		(DWORD)RandomControl,
+	};
+	DWORD hash = 2166136261; // FNV-1a
+	for (DWORD i = 0; i < sizeof(data); ++i) {
+		hash = (hash ^ ((BYTE*)data)[i]) * 16777619;
+	}
+	return hash;
+}
+
+#if defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+// Command line: benchnav compares the box graph fields with SearchLOT for
+// every box as a target, for each LOT profile used by the creatures in
+// InitialiseSlot. The LOTs aren't creature slots, so UpdateLOT searches
+// them the usual way, and the graph is reached through NAV_ApplyField only.
+typedef struct {
+	int profiles;
+	int fields;
+	int mismatches;
+	LONGLONG searchTime;
+	LONGLONG buildTime;
+	LONGLONG applyTime;
+} BENCH_NAV_REPORT;
+
+static bool BENCH_CompareNav(const LOT_INFO* search, const LOT_INFO* apply) {
+	for (DWORD i = 0; i < BoxesCount; ++i) {
+		const BOX_NODE* a = &search->node[i];
+		const BOX_NODE* b = &apply->node[i];
+		bool foundA = (a->searchNumber & 0x7FFF) == (search->searchNumber & 0x7FFF);
+		bool foundB = (b->searchNumber & 0x7FFF) == (apply->searchNumber & 0x7FFF);
+		if (foundA != foundB || (foundA && ((a->searchNumber ^ b->searchNumber) & 0x8000))
+			|| (foundA && !(a->searchNumber & 0x8000) && a->exitBox != b->exitBox))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void BENCH_VerifyNav(BENCH_NAV_REPORT* report) {
+	static const struct {
+		short step, drop, fly;
+		UINT16 blockMask;
+	} profiles[] = {
+		{CLICK(1), -CLICK(2), 0, 0x4000},
+		{BLOCK(1), -BLOCK(1), 0, 0x4000},
+		{CLICK(1) / 2, -BLOCK(1), 0, 0x4000},
+		{CLICK(1), -CLICK(2), 0, 0x8000},
+		{BLOCK(20), -BLOCK(20), 16, 0x4000},
+		{BLOCK(20), -BLOCK(20), 16, 0x8000},
+	};
+	LOT_INFO search, apply;
+	bool isGraph = true;
+
+	memset(report, 0, sizeof(BENCH_NAV_REPORT));
+	if (BoxesCount == 0) {
+		return;
+	}
+	search.node = (BOX_NODE*)malloc(sizeof(BOX_NODE) * BoxesCount);
+	apply.node = (BOX_NODE*)malloc(sizeof(BOX_NODE) * BoxesCount);
+	if (search.node == NULL || apply.node == NULL) {
+		free(search.node);
+		free(apply.node);
+		return;
+	}
+
+	for (DWORD i = 0; i < ARRAY_SIZE(profiles) && isGraph; ++i) {
+		search.step = apply.step = profiles[i].step;
+		search.drop = apply.drop = profiles[i].drop;
+		search.fly = apply.fly = profiles[i].fly;
+		search.blockMask = apply.blockMask = profiles[i].blockMask;
+		ClearLOT(&search);
+		ClearLOT(&apply);
+		NAV_Invalidate();
+		++report->profiles;
+
+		for (DWORD target = 0; target < BoxesCount; ++target) {
+			LONGLONG start = BENCH_Counter();
+			search.requiredBox = (UINT16)target;
+			UpdateLOT(&search, INT_MAX);
+			LONGLONG now = BENCH_Counter();
+			report->searchTime += now - start;
+
+			// the first apply misses the field and starts its flood
+			start = now;
+			apply.targetBox = (UINT16)target;
+			++apply.searchNumber;
+			NAV_ApplyField(&apply);
+			NAV_BuildField(INT_MAX);
+			now = BENCH_Counter();
+			report->buildTime += now - start;
+
+			start = now;
+			isGraph = NAV_ApplyField(&apply);
+			report->applyTime += BENCH_Counter() - start;
+			if (!isGraph) {
+				// there is no graph for this level
+				break;
+			}
+			++report->fields;
+			if (!BENCH_CompareNav(&search, &apply)) {
+				++report->mismatches;
+			}
+			// the search numbers must not overflow into the blocked bit
+			if ((search.searchNumber & 0x7FFF) == 0x7FFF || (apply.searchNumber & 0x7FFF) == 0x7FFF) {
+				ClearLOT(&search);
+				ClearLOT(&apply);
+			}
+		}
+	}
+	NAV_Invalidate();
+	free(search.node);
+	free(apply.node);
+}
+#endif // defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+
+// Command line: benchspan draws the same random spans through the scalar
+// loop and through the SIMD paths, and compares the pixels and the final
+// g/u/v. Then every path draws all the spans again for the timing.
+#define BENCH_SPAN_COUNT (20000)
+
+typedef struct {
+	int spans;
+	int mismatches;
+	bool isAVX2;
+	LONGLONG times[3]; // scalar, SSE2, AVX2
+} BENCH_SPAN_REPORT;
+
+static void BENCH_VerifySpanPath(BENCH_SPAN_REPORT* report, bool colorKey, bool isDouble, const SPAN_PARAMS* spans, BYTE* texPage) {
+	BYTE line[3][32 * 2 + 16];
+	int paths = report->isAVX2 ? 3 : 2;
+
+	for (int i = 0; i < BENCH_SPAN_COUNT; ++i) {
+		SPAN_PARAMS result[3];
+		for (int j = 0; j < paths; ++j) {
+			memset(line[j], 0x55, sizeof(line[j]));
+			result[j] = spans[i];
+			DrawSpanBatch(j, colorKey, isDouble, line[j], &result[j], texPage);
+		}
+		++report->spans;
+		for (int j = 1; j < paths; ++j) {
+			if (memcmp(line[0], line[j], sizeof(line[0])) || memcmp(&result[0], &result[j], sizeof(SPAN_PARAMS))) {
+				++report->mismatches;
+				break;
+			}
+		}
+	}
+
+	for (int j = 0; j < paths; ++j) {
+		LONGLONG start = BENCH_Counter();
+		for (int i = 0; i < BENCH_SPAN_COUNT; ++i) {
+			SPAN_PARAMS span = spans[i];
+			DrawSpanBatch(j, colorKey, isDouble, line[j], &span, texPage);
+		}
+		report->times[j] += BENCH_Counter() - start;
+	}
+}
+
+static void BENCH_VerifySpans(BENCH_SPAN_REPORT* report) {
+	DWORD seed = 1;
+
+	memset(report, 0, sizeof(BENCH_SPAN_REPORT));
+	report->isAVX2 = IsAVX2Supported();
+	// the gathers may read 3 bytes past the page
+	BYTE* texPage = (BYTE*)malloc(256 * 256 + 4);
+	SPAN_PARAMS* spans = (SPAN_PARAMS*)malloc(sizeof(SPAN_PARAMS) * BENCH_SPAN_COUNT);
+	if (texPage == NULL || spans == NULL) {
+		free(texPage);
+		free(spans);
+		return;
+	}
+	for (int i = 0; i < 256 * 256 + 4; ++i) {
+		seed = seed * 1103515245 + 12345;
+		// every fourth texel is transparent
+		texPage[i] = ((seed >> 16) & 3) ? (BYTE)(seed >> 24) : 0;
+	}
+	for (int i = 0; i < BENCH_SPAN_COUNT; ++i) {
+		SPAN_PARAMS* span = &spans[i];
+		seed = seed * 1103515245 + 12345;
+		span->g = (1 << 16) + (seed >> 8) % (30 << 16); // the shade stays in DepthQTable over the span
+		seed = seed * 1103515245 + 12345;
+		span->u = seed >> 2;
+		seed = seed * 1103515245 + 12345;
+		span->v = seed >> 2;
+		seed = seed * 1103515245 + 12345;
+		span->gAdd = (int)(seed >> 22) - 512;
+		seed = seed * 1103515245 + 12345;
+		span->uAdd = (int)(seed >> 16) - 0x8000;
+		seed = seed * 1103515245 + 12345;
+		span->vAdd = (int)(seed >> 16) - 0x8000;
+	}
+	BENCH_VerifySpanPath(report, false, false, spans, texPage);
+	BENCH_VerifySpanPath(report, false, true, spans, texPage);
+	BENCH_VerifySpanPath(report, true, false, spans, texPage);
+	BENCH_VerifySpanPath(report, true, true, spans, texPage);
+	free(texPage);
+	free(spans);
+}
+
+#ifdef FEATURE_VIEW_IMPROVED
+typedef struct {
+	int lists;
+	int surfaces;
+	int maxSurfaces;
+	int mismatches;
+	LONGLONG quickTime;
+	LONGLONG radixTime;
+} BENCH_SORT_REPORT;
+
+// Sorts a captured poly list with both methods and adds the times to the
+// report. The items are the raw ones, as phd_SortPolyList gets them, and the
+// sorted lists must be the same. The sort buffer is rebuilt every frame, so
+// it's just left with the last sorted list.
+static void BENCH_ReplaySort(const SORT_ITEM* items, DWORD count, BENCH_SORT_REPORT* report) {
+	DWORD savedCount = SurfaceCount;
+	DWORD savedMode = PolySortMode;
+	SORT_ITEM* quickList;
+	LONGLONG start;
+
+	CLAMPG(count, ARRAY_SIZE(SortBuffer));
+	// the radix sort uses the scratch buffer, so the quicksort result is kept apart
+	quickList = (SORT_ITEM*)malloc(sizeof(SORT_ITEM) * count);
+	if (count == 0 || quickList == NULL) {
+		free(quickList);
+		return;
+	}
+	SurfaceCount = count;
+
+	memcpy(SortBuffer, items, sizeof(SORT_ITEM) * count);
+	PolySortMode = POLYSORT_Quick;
+	start = BENCH_Counter();
+	phd_SortPolyList();
+	report->quickTime += BENCH_Counter() - start;
+	memcpy(quickList, SortBuffer, sizeof(SORT_ITEM) * count);
+
+	memcpy(SortBuffer, items, sizeof(SORT_ITEM) * count);
+	PolySortMode = POLYSORT_Radix;
+	start = BENCH_Counter();
+	phd_SortPolyList();
+	report->radixTime += BENCH_Counter() - start;
+
+	for (DWORD i = 0; i < count; ++i) {
+		if (SortBuffer[i]._0 != quickList[i]._0 || SortBuffer[i]._1 != quickList[i]._1) {
+			++report->mismatches;
+		}
+	}
+	++report->lists;
+	report->surfaces += count;
+	CLAMPL(report->maxSurfaces, (int)count);
+
+	SurfaceCount = savedCount;
+	PolySortMode = savedMode;
+	free(quickList);
+}
+#endif // FEATURE_VIEW_IMPROVED
+
+#ifdef FEATURE_VERTEX_SIMD
+// Command line: benchvertex transforms the rooms and the object meshes of the
+// level by both paths from random views, and compares the vertex buffers
+// field by field, so the fog shade, the clip flags and the zClip byte are
+// checked too. The views stand at random points of random rooms, so there
+// are vertices behind the near plane and past the fog end. Every view also
+// takes a random fog range, so the fog slope and the fog end are checked
+// whatever the user settings are. The screen coordinates and RHW of the
+// vertices behind the near plane are not compared, the scalar path doesn't
+// write them.
+#define BENCH_VERTEX_VIEWS (64)
+#define BENCH_VERTEX_RANGE (20 * WALL_SIZE)
+
+typedef struct {
+	int vertices;
+	int mismatches;
+	LONGLONG scalarTime;
+	LONGLONG simdTime;
+} BENCH_VERTEX_REPORT;
+
+static DWORD BenchVertexSeed;
+
+static int BENCH_VertexRandom(int range) {
+	BenchVertexSeed = BenchVertexSeed * 1103515245 + 12345;
+	return (range > 0) ? (int)((BenchVertexSeed >> 8) % (DWORD)range) : 0;
+}
+
+static int BENCH_CompareVertices(const PHD_VBUF* ref, int count, bool isRoom) {
+	int mismatches = 0;
+
+	for (int i = 0; i < count; ++i) {
+		const PHD_VBUF* a = &ref[i];
+		const PHD_VBUF* b = &PhdVBuf[i];
+		if (a->xv != b->xv || a->yv != b->yv || a->zv != b->zv || a->clip != b->clip
+			|| (isRoom && a->g != b->g)
+			|| (!(a->clip & 0x80) && (a->xs != b->xs || a->ys != b->ys || a->rhw != b->rhw)))
+		{
+			++mismatches;
+		}
+	}
+	return mismatches;
+}
+
+static void BENCH_VerifyVertices(BENCH_VERTEX_REPORT* report) {
+	PHD_3DPOS viewPos;
+	PHD_MATRIX savedW2V = MatrixW2V;
+	PHD_MATRIX* savedMatrixPtr = PhdMatrixPtr;
+	PHD_MATRIX* savedStack = NULL;
+	BOOL savedWater = IsWaterEffect;
+	BOOL savedWibble = IsWibbleEffect;
+	float savedWinLeft = FltWinLeft;
+	float savedWinTop = FltWinTop;
+	float savedWinRight = FltWinRight;
+	float savedWinBottom = FltWinBottom;
+	float savedWinCenterX = FltWinCenterX;
+	float savedWinCenterY = FltWinCenterY;
+#ifdef FEATURE_VIEW_IMPROVED
+	int savedFogBegin = FogBeginDepth;
+	int savedFogEnd = FogEndDepth;
+#endif // FEATURE_VIEW_IMPROVED
+	PHD_VBUF* ref = NULL;
+	int maxCount = 0;
+	LONGLONG start;
+
+	memset(report, 0, sizeof(BENCH_VERTEX_REPORT));
+	for (int i = 0; i < RoomCount; ++i) {
+		CLAMPL(maxCount, Rooms[i].data->vtxSize);
+	}
+	for (int i = 0; i < ID_NUMBER_OBJECTS; ++i) {
+		if (!Objects[i].loaded) continue;
+		for (int j = 0; j < Objects[i].nMeshes; ++j) {
+			CLAMPL(maxCount, MeshPtr[Objects[i].meshIndex + j][5]);
+		}
+	}
+	ref = (PHD_VBUF*)malloc(sizeof(PHD_VBUF) * MAX(maxCount, 1));
+	savedStack = (PHD_MATRIX*)malloc(sizeof(MatrixStack));
+	if (ref == NULL || savedStack == NULL || RoomCount == 0) {
+		free(ref);
+		free(savedStack);
+		return;
+	}
+	memcpy(savedStack, MatrixStack, sizeof(MatrixStack));
+
+	// the scalar path must not add the water shimmer
+	IsWaterEffect = FALSE;
+	IsWibbleEffect = FALSE;
+	FltWinLeft = (float)PhdWinMinX;
+	FltWinTop = (float)PhdWinMinY;
+	FltWinRight = (float)(PhdWinMinX + PhdWinMaxX + 1);
+	FltWinBottom = (float)(PhdWinMinY + PhdWinMaxY + 1);
+	FltWinCenterX = (float)(PhdWinMinX + PhdWinCenterX);
+	FltWinCenterY = (float)(PhdWinMinY + PhdWinCenterY);
+
+	BenchVertexSeed = 1;
+	for (int v = 0; v < BENCH_VERTEX_VIEWS; ++v) {
+		ROOM_INFO* viewRoom = &Rooms[BENCH_VertexRandom(RoomCount)];
+		BYTE farClip = (v & 1) ? 16 : 0;
+		// the software renderer adds the MidSort depth to the room vertices
+		float baseZ = (v & 2) ? (float)(BENCH_VertexRandom(16) << (W2V_SHIFT + 8)) : 0.0f;
+		viewPos.x = viewRoom->x + BENCH_VertexRandom(viewRoom->xSize * WALL_SIZE);
+		viewPos.y = viewRoom->maxCeiling + BENCH_VertexRandom(viewRoom->minFloor - viewRoom->maxCeiling);
+		viewPos.z = viewRoom->z + BENCH_VertexRandom(viewRoom->zSize * WALL_SIZE);
+		viewPos.rotX = (short)BENCH_VertexRandom(0x10000);
+		viewPos.rotY = (short)BENCH_VertexRandom(0x10000);
+		viewPos.rotZ = (short)BENCH_VertexRandom(0x10000);
+		phd_GenerateW2V(&viewPos);
+#ifdef FEATURE_VIEW_IMPROVED
+		FogBeginDepth = BENCH_VertexRandom(PhdViewDistance);
+		FogEndDepth = FogBeginDepth + BENCH_VertexRandom(PhdViewDistance - FogBeginDepth + 1);
+#endif // FEATURE_VIEW_IMPROVED
+
+		for (int i = 0; i < RoomCount; ++i) {
+			ROOM_INFO* room = &Rooms[i];
+			ROOM_DATA* data = room->data;
+			if (data->vtxSoA == NULL || data->vtxSize == 0
+				|| ABS(room->x - viewPos.x) > BENCH_VERTEX_RANGE
+				|| ABS(room->y - viewPos.y) > BENCH_VERTEX_RANGE
+				|| ABS(room->z - viewPos.z) > BENCH_VERTEX_RANGE)
+			{
+				continue;
+			}
+			phd_PushMatrix();
+			phd_TranslateAbs(room->x, room->y, room->z);
+			start = BENCH_Counter();
+			calc_room_vertices_path(data, farClip, baseZ, false);
+			report->scalarTime += BENCH_Counter() - start;
+			memcpy(ref, PhdVBuf, sizeof(PHD_VBUF) * data->vtxSize);
+			start = BENCH_Counter();
+			calc_room_vertices_path(data, farClip, baseZ, true);
+			report->simdTime += BENCH_Counter() - start;
+			phd_PopMatrix();
+			report->vertices += data->vtxSize;
+			report->mismatches += BENCH_CompareVertices(ref, data->vtxSize, true);
+		}
+
+		for (int i = 0; i < ID_NUMBER_OBJECTS; ++i) {
+			if (!Objects[i].loaded) continue;
+			for (int j = 0; j < Objects[i].nMeshes; ++j) {
+				short* ptrObj = MeshPtr[Objects[i].meshIndex + j] + 6; // skip x, y, z, radius and vertex count
+				int vtxCount = ptrObj[-1];
+				if (vtxCount <= 0) continue;
+				phd_PushMatrix();
+				phd_TranslateAbs(viewPos.x + BENCH_VertexRandom(BENCH_VERTEX_RANGE * 2) - BENCH_VERTEX_RANGE,
+					viewPos.y + BENCH_VertexRandom(BENCH_VERTEX_RANGE * 2) - BENCH_VERTEX_RANGE,
+					viewPos.z + BENCH_VertexRandom(BENCH_VERTEX_RANGE * 2) - BENCH_VERTEX_RANGE);
+				phd_RotYXZ((short)BENCH_VertexRandom(0x10000), (short)BENCH_VertexRandom(0x10000), (short)BENCH_VertexRandom(0x10000));
+				start = BENCH_Counter();
+				short* scalarEnd = calc_object_vertices_path(ptrObj, vtxCount, 0.0f, false);
+				report->scalarTime += BENCH_Counter() - start;
+				memcpy(ref, PhdVBuf, sizeof(PHD_VBUF) * vtxCount);
+				start = BENCH_Counter();
+				short* simdEnd = calc_object_vertices_path(ptrObj, vtxCount, 0.0f, true);
+				report->simdTime += BENCH_Counter() - start;
+				phd_PopMatrix();
+				report->vertices += vtxCount;
+				report->mismatches += BENCH_CompareVertices(ref, vtxCount, false);
+				// the result tells whether the whole mesh is off the screen
+				if (scalarEnd != simdEnd) ++report->mismatches;
+			}
+		}
+	}
+
+	memcpy(MatrixStack, savedStack, sizeof(MatrixStack));
+	MatrixW2V = savedW2V;
+	PhdMatrixPtr = savedMatrixPtr;
+	IsWaterEffect = savedWater;
+	IsWibbleEffect = savedWibble;
+	FltWinLeft = savedWinLeft;
+	FltWinTop = savedWinTop;
+	FltWinRight = savedWinRight;
+	FltWinBottom = savedWinBottom;
+	FltWinCenterX = savedWinCenterX;
+	FltWinCenterY = savedWinCenterY;
+#ifdef FEATURE_VIEW_IMPROVED
+	FogBeginDepth = savedFogBegin;
+	FogEndDepth = savedFogEnd;
+#endif // FEATURE_VIEW_IMPROVED
+	free(savedStack);
+	free(ref);
+}
+#endif // FEATURE_VERTEX_SIMD
+
+static void BENCH_WriteReport(int levelID, int nTicks, double seconds) {
+	char buf[4096];
+	int len = 0;
+	double freq;
+	LARGE_INTEGER frequency;
+	HANDLE hFile;
+	DWORD bytesWritten;
+
+	QueryPerformanceFrequency(&frequency);
+	freq = (double)frequency.QuadPart;
+
+	len += snprintf(buf + len, sizeof(buf) - len, "level: %d (%s)\r\n", levelID, GF_LevelFilesStringTable[levelID]);
+	len += snprintf(buf + len, sizeof(buf) - len, "ticks: %d\r\n", nTicks);
+	len += snprintf(buf + len, sizeof(buf) - len, "time: %.3f s\r\n", seconds);
+	len += snprintf(buf + len, sizeof(buf) - len, "ticks/sec: %.1f\r\n", (seconds > 0.0) ? nTicks / seconds : 0.0);
+	len += snprintf(buf + len, sizeof(buf) - len, "checksum: %08X\r\n", BENCH_Checksum());
+	for (int i = 0; i < CTRL_Count; ++i) {
+		double total = (double)BenchTimes[i] / freq;
+		len += snprintf(buf + len, sizeof(buf) - len, "%s: %.3f ms total, %.3f us/tick\r\n",
+			BenchNames[i], total * 1000.0, (nTicks > 0) ? total * 1000000.0 / nTicks : 0.0);
+	}
+#if defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+	if (UT_FindArg("benchnav") != NULL) {
+		BENCH_NAV_REPORT report;
+		BENCH_VerifyNav(&report);
+		len += snprintf(buf + len, sizeof(buf) - len, "nav fields: %d (%d profiles), mismatches: %d\r\n",
+			report.fields, report.profiles, report.mismatches);
+		len += snprintf(buf + len, sizeof(buf) - len, "nav SearchLOT: %.3f ms, graph flood: %.3f ms, field copy: %.3f ms\r\n",
+			report.searchTime * 1000.0 / freq, report.buildTime * 1000.0 / freq, report.applyTime * 1000.0 / freq);
+	}
+#endif // defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+	if (UT_FindArg("benchspan") != NULL) {
+		BENCH_SPAN_REPORT report;
+		BENCH_VerifySpans(&report);
+		len += snprintf(buf + len, sizeof(buf) - len, "spans: %d, mismatches: %d, avx2: %s\r\n",
+			report.spans, report.mismatches, report.isAVX2 ? "yes" : "no");
+		len += snprintf(buf + len, sizeof(buf) - len, "span scalar: %.3f ms, sse2: %.3f ms, avx2: %.3f ms\r\n",
+			report.times[0] * 1000.0 / freq, report.times[1] * 1000.0 / freq, report.times[2] * 1000.0 / freq);
+	}
+#ifdef FEATURE_VIEW_IMPROVED
+	// Command line: benchsort replays the captured poly lists with both sort methods
+	BENCH_SORT_REPORT sortReport;
+	memset(&sortReport, 0, sizeof(sortReport));
+	for (int r = 0; r < BENCH_SORT_REPEATS; ++r) {
+		for (int i = 0; i < BenchSortListCount; ++i) {
+			BENCH_ReplaySort(BenchSortLists[i].items, BenchSortLists[i].count, &sortReport);
+		}
+	}
+	BENCH_FreeSortLists();
+	if (sortReport.lists > 0) {
+		len += snprintf(buf + len, sizeof(buf) - len, "sort lists: %d, surfaces: %d avg, %d max, mismatches: %d\r\n",
+			sortReport.lists, sortReport.surfaces / sortReport.lists, sortReport.maxSurfaces, sortReport.mismatches);
+		len += snprintf(buf + len, sizeof(buf) - len, "sort quicksort: %.3f us/list, radix: %.3f us/list\r\n",
+			sortReport.quickTime * 1000000.0 / freq / sortReport.lists, sortReport.radixTime * 1000000.0 / freq / sortReport.lists);
+	}
+#endif // FEATURE_VIEW_IMPROVED
+#ifdef FEATURE_VERTEX_SIMD
+	if (UT_FindArg("benchvertex") != NULL) {
+		BENCH_VERTEX_REPORT report;
+		BENCH_VerifyVertices(&report);
+		len += snprintf(buf + len, sizeof(buf) - len, "vertices: %d, mismatches: %d\r\n",
+			report.vertices, report.mismatches);
+		len += snprintf(buf + len, sizeof(buf) - len, "vertex scalar: %.3f ms, simd: %.3f ms\r\n",
+			report.scalarTime * 1000.0 / freq, report.simdTime * 1000.0 / freq);
+	}
+#endif // FEATURE_VERTEX_SIMD
+	LogDebug("Benchmark results:\n%s", buf);
+
+	hFile = CreateFile(BENCH_REPORT_NAME, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		LogWarn("Failed to write the benchmark report: %s", BENCH_REPORT_NAME);
+		return;
+	}
+	WriteFile(hFile, buf, len, &bytesWritten, NULL);
+	CloseHandle(hFile);
+}
+
+bool BENCH_IsRequested() {
+	return (UT_FindArg("benchmark") != NULL);
+}
+
+int BENCH_RunDemo(int levelID, int nTicks) {
+	LPCTSTR arg;
+	LONGLONG startTime;
+	LARGE_INTEGER frequency;
+	int tick;
+
+	// Command line: benchmark[=ticks] [benchlevel=levelID]
+	if (nTicks <= 0) {
+		arg = UT_FindArg("benchmark=");
+		nTicks = arg ? atoi(arg) : 0;
+		if (nTicks <= 0) nTicks = BENCH_DEFAULT_TICKS;
+	}
+	if (levelID < 0) {
+		arg = UT_FindArg("benchlevel=");
+		if (arg != NULL) {
+			levelID = atoi(arg);
+		}
+		else if (GF_GameFlow.num_Demos > 0) {
+			levelID = GF_DemoLevels[0];
+		}
+	}
+	if (levelID <= 0 || levelID > GF_GameFlow.num_Levels) {
+		LogWarn("Benchmark: invalid level %d", levelID);
+		return GF_EXIT_GAME;
+	}
+
+	START_INFO* startInfo = &SaveGame.start[levelID];
+	START_INFO startBackup = *startInfo;
+	if (!InitialiseDemoLevel(levelID)) {
+		*startInfo = startBackup;
+		return GF_EXIT_GAME;
+	}
+	if (!IsDemoLoaded) {
+		LogWarn("Benchmark: level %d has no demo data", levelID);
+		*startInfo = startBackup;
+		return GF_EXIT_GAME;
+	}
+
+	// rendering is never called here, and audio is muted the same way as for cinematics
+	S_CDStop();
+	SoundIsActive = FALSE;
+
+	BeginDemoPlayback();
+	memset(BenchTimes, 0, sizeof(BenchTimes));
+#ifdef FEATURE_VIEW_IMPROVED
+	bool isSortCapture = (UT_FindArg("benchsort") != NULL);
+	BENCH_FreeSortLists();
+#endif // FEATURE_VIEW_IMPROVED
+
+	startTime = BENCH_Counter();
+	for (tick = 0; tick < nTicks && !IsLevelComplete; ++tick) {
+		GetDemoInput();
+		if (InputStatus == (DWORD)~0) {
+			InputStatus = 0;
+		}
+		BenchLast = BENCH_Counter();
+		ControlTick(BENCH_Mark);
+#ifdef FEATURE_VIEW_IMPROVED
+		if (isSortCapture && tick % BENCH_SORT_INTERVAL == 0) {
+			LONGLONG captureStart = BENCH_Counter();
+			BENCH_CaptureSortList();
+			startTime += BENCH_Counter() - captureStart;
+		}
+#endif // FEATURE_VIEW_IMPROVED
+	}
+	QueryPerformanceFrequency(&frequency);
+	BENCH_WriteReport(levelID, tick, (double)(BENCH_Counter() - startTime) / (double)frequency.QuadPart);
+
+	SoundIsActive = TRUE;
+	*startInfo = startBackup;
+	return GF_EXIT_GAME;
+}
+#endif // FEATURE_BENCHMARK
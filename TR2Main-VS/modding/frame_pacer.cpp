@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/frame_pacer.h"
+#include <math.h>
+
+#ifdef FEATURE_FRAME_PACER
+
+// The pacer sleeps for the most of the interval and spins only for the rest of
+// it, so the thread doesn't load a core while it waits for the next frame. The
+// spin margin starts from PACER_SPIN_US, and it grows up to the worst
+// oversleep of the clock, so a coarse system timer doesn't make the frames
+// late. The worst oversleep slowly goes back if the sleeps become accurate
+// again, a single accurate sleep of a coarse timer doesn't drop the margin.
+#define PACER_SPIN_US (500)
+#define PACER_MAX_SPIN_US (20000)
+#define PACER_SPIN_DECAY (256)
+
+static PACER_CLOCK PacerClock;
+static LONGLONG PacerSpin = 0;
+static LONGLONG PacerMinSpin = 0;
+static LONGLONG PacerMaxSpin = 0;
+static LONGLONG PacerOversleep = 0;
+static LONGLONG PacerLastFrame = 0;
+
+static DWORD PacerFrames = 0;
+static double PacerSum = 0.0;
+static double PacerSumSq = 0.0;
+static double PacerMin = 0.0;
+static double PacerMax = 0.0;
+static DWORD PacerLateFrames = 0;
+static double PacerLateSum = 0.0;
+static double PacerLateMax = 0.0;
+static double PacerLateLast = 0.0;
+
+static inline double PACER_TicksToMs(LONGLONG ticks) {
+	return (double)ticks * 1000.0 / (double)PacerClock.frequency;
+}
+
+void PACER_Init(const PACER_CLOCK* clock) {
+	PacerClock = *clock;
+	PacerMinSpin = clock->frequency * PACER_SPIN_US / 1000000;
+	PacerMaxSpin = clock->frequency * PACER_MAX_SPIN_US / 1000000;
+	PacerSpin = PacerMinSpin;
+	PacerOversleep = 0;
+	PACER_ResetStats();
+}
+
+LONGLONG PACER_GetTime() {
+	return PacerClock.GetTime(PacerClock.param);
+}
+
+static void PACER_AddFrame(LONGLONG now, LONGLONG late) {
+	if (PacerLastFrame != 0) {
+		double ms = PACER_TicksToMs(now - PacerLastFrame);
+		if (PacerFrames == 0 || ms < PacerMin) PacerMin = ms;
+		if (PacerFrames == 0 || ms > PacerMax) PacerMax = ms;
+		PacerSum += ms;
+		PacerSumSq += ms * ms;
+		++PacerFrames;
+	}
+	PacerLastFrame = now;
+
+	PacerLateLast = 0.0;
+	if (late >= 0) {
+		PacerLateLast = PACER_TicksToMs(late);
+		PacerLateSum += PacerLateLast;
+		CLAMPL(PacerLateMax, PacerLateLast);
+		++PacerLateFrames;
+	}
+}
+
+LONGLONG PACER_WaitUntil(LONGLONG deadline) {
+	LONGLONG now = PACER_GetTime();
+	LONGLONG remain = deadline - now;
+
+	if (remain <= 0) {
+		// the frame took all the interval, there is nothing to wait
+		PACER_AddFrame(now, -1);
+		return now;
+	}
+
+	if (PacerClock.Sleep != NULL && remain > PacerSpin) {
+		LONGLONG request = remain - PacerSpin;
+		PacerClock.Sleep(PacerClock.param, request);
+		LONGLONG woken = PACER_GetTime();
+		LONGLONG oversleep = woken - now - request;
+		if (oversleep > PacerOversleep) {
+			PacerOversleep = oversleep;
+		}
+		else {
+			PacerOversleep -= PacerOversleep / PACER_SPIN_DECAY;
+		}
+		PacerSpin = MIN(PacerOversleep + PacerMinSpin, PacerMaxSpin);
+		now = woken;
+	}
+
+	while (now < deadline) {
+		now = PACER_GetTime();
+	}
+	PACER_AddFrame(now, now - deadline);
+	return now;
+}
+
+void PACER_ResetStats() {
+	PacerLastFrame = 0;
+	PacerFrames = 0;
+	PacerSum = 0.0;
+	PacerSumSq = 0.0;
+	PacerMin = 0.0;
+	PacerMax = 0.0;
+	PacerLateFrames = 0;
+	PacerLateSum = 0.0;
+	PacerLateMax = 0.0;
+	PacerLateLast = 0.0;
+}
+
+void PACER_GetStats(PACER_STATS* stats) {
+	memset(stats, 0, sizeof(PACER_STATS));
+	stats->frames = PacerFrames;
+	if (PacerFrames > 0) {
+		stats->avgMs = PacerSum / PacerFrames;
+		stats->minMs = PacerMin;
+		stats->maxMs = PacerMax;
+		stats->jitterMs = sqrt(MAX(0.0, PacerSumSq / PacerFrames - stats->avgMs * stats->avgMs));
+	}
+	if (PacerLateFrames > 0) {
+		stats->avgLateMs = PacerLateSum / PacerLateFrames;
+		stats->maxLateMs = PacerLateMax;
+	}
+	stats->lastLateMs = PacerLateLast;
+}
+
+#endif // FEATURE_FRAME_PACER
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FRAME_PACER_H_INCLUDED
+#define FRAME_PACER_H_INCLUDED
+
+#include "global/types.h"
+
+// The clock source of the pacer. GetTime returns the current counter value,
+// Sleep blocks the thread for about the given number of counter ticks (it may
+// be NULL, then the pacer only spins). Any source may be used, so the pacer
+// doesn't depend on the system timers.
+typedef struct {
+	LONGLONG (*GetTime)(LPVOID param);
+	void (*Sleep)(LPVOID param, LONGLONG ticks);
+	LONGLONG frequency; // counter ticks per second
+	LPVOID param;
+} PACER_CLOCK;
+
+typedef struct {
+	DWORD frames;
+	double avgMs; // average frame interval
+	double minMs;
+	double maxMs;
+	double jitterMs; // standard deviation of the frame interval
+	double avgLateMs; // how late the pacer returned after the deadline
+	double maxLateMs;
+	double lastLateMs;
+} PACER_STATS;
+
+ /*
+  * Function list
+  */
+void PACER_Init(const PACER_CLOCK* clock);
+LONGLONG PACER_GetTime();
+LONGLONG PACER_WaitUntil(LONGLONG deadline);
+void PACER_ResetStats();
+void PACER_GetStats(PACER_STATS* stats);
+
+#endif // FRAME_PACER_H_INCLUDED
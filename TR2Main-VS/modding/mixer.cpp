@@ -0,0 +1,519 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/mixer.h"
+#include <atomic>
+#include <math.h>
+#include <emmintrin.h>
+
+#ifdef FEATURE_SOFTWARE_MIXER
+
+// The mixer core has no platform code, the audio output and the mixer thread
+// belong to the sound backend, so the core builds and is tested anywhere.
+// The game thread never touches the mixer voices. It puts the commands into a
+// single producer/single consumer ring, and the mixer thread takes them at the
+// start of every render. The only state going back is the serial number of
+// the last finished start command of every voice, so the game thread knows if
+// a voice still plays without any locks.
+// The voices are resampled four output frames at once and mixed into float
+// buffers together with the reverb send, then the reverb is added and the
+// result is converted to 16 bit stereo with saturation.
+#define MIXER_QUEUE_SIZE (1024) // must be a power of two
+#define MIXER_BLOCK (256) // must be a multiple of four
+#define MIXER_COMBS (4)
+#define MIXER_ALLPASSES (2)
+#define MIXER_COMB_SIZE (2048)
+#define MIXER_ALLPASS_SIZE (1024)
+#define MIXER_STEREO_SPREAD (23)
+#define MIXER_REVERB_INPUT (0.05F)
+#define MIXER_REVERB_DAMP (0.2F)
+
+typedef enum {
+	MIXCMD_Start,
+	MIXCMD_Update,
+	MIXCMD_Stop,
+	MIXCMD_StopAll,
+	MIXCMD_Reverb,
+} MIXER_COMMAND_TYPE;
+
+typedef struct {
+	MIXER_COMMAND_TYPE type;
+	int voice;
+	const short* data;
+	DWORD frames;
+	DWORD serial;
+	int pitch;
+	float left;
+	float right;
+	bool looped;
+} MIXER_COMMAND;
+
+typedef struct {
+	const short* data;
+	DWORD frames;
+	UINT64 pos; // 32.32 fixed point source frame
+	UINT64 step;
+	float left;
+	float right;
+	float targetLeft;
+	float targetRight;
+	DWORD serial;
+	bool looped;
+	bool active;
+} MIXER_VOICE;
+
+typedef struct {
+	float* buffer;
+	int size;
+	int index;
+	float feedback;
+	float filter;
+} MIXER_DELAY;
+
+static DWORD MixerRate = 22050;
+static bool MixerCubic = false;
+
+// the game thread side
+static DWORD MixerStarted[MIXER_MAX_VOICES];
+static bool MixerStopped[MIXER_MAX_VOICES];
+static DWORD MixerDropped = 0;
+
+// shared between the threads
+static MIXER_COMMAND MixerQueue[MIXER_QUEUE_SIZE];
+static std::atomic<DWORD> MixerHead(0);
+static std::atomic<DWORD> MixerTail(0);
+static std::atomic<DWORD> MixerFinished[MIXER_MAX_VOICES];
+static std::atomic<DWORD> MixerRendered(0);
+static std::atomic<DWORD> MixerCommands(0);
+static std::atomic<DWORD> MixerVoicesCount(0);
+static std::atomic<DWORD> MixerPeakVoices(0);
+
+// the mixer thread side
+static MIXER_VOICE MixerVoices[MIXER_MAX_VOICES];
+alignas(16) static float MixLeft[MIXER_BLOCK];
+alignas(16) static float MixRight[MIXER_BLOCK];
+alignas(16) static float MixSend[MIXER_BLOCK];
+static float CombBuffers[2][MIXER_COMBS][MIXER_COMB_SIZE];
+static float AllpassBuffers[2][MIXER_ALLPASSES][MIXER_ALLPASS_SIZE];
+static MIXER_DELAY Combs[2][MIXER_COMBS];
+static MIXER_DELAY Allpasses[2][MIXER_ALLPASSES];
+static float ReverbWet = 0.0F;
+
+// Freeverb delay lengths at 44100 Hz
+static const int CombTuning[MIXER_COMBS] = { 1116, 1188, 1277, 1356 };
+static const int AllpassTuning[MIXER_ALLPASSES] = { 556, 441 };
+
+static UINT64 MIXER_GetStep(int pitch) {
+	// the same frequency range as for the XAudio voices
+	double frequency = (double)pitch / 65536.0 * 11050.0;
+	CLAMP(frequency, 100.0, 100000.0);
+	return (UINT64)(frequency / 11050.0 * MIXER_SOURCE_RATE / MixerRate * 4294967296.0);
+}
+
+static bool MIXER_Push(const MIXER_COMMAND* cmd) {
+	DWORD head = MixerHead.load(std::memory_order_relaxed);
+	if (head - MixerTail.load(std::memory_order_acquire) >= MIXER_QUEUE_SIZE) {
+		++MixerDropped;
+		return false;
+	}
+	MixerQueue[head & (MIXER_QUEUE_SIZE - 1)] = *cmd;
+	MixerHead.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+static void MIXER_SetReverbTime(float decayTime) {
+	for (int ch = 0; ch < 2; ++ch) {
+		for (int i = 0; i < MIXER_COMBS; ++i) {
+			MIXER_DELAY* comb = &Combs[ch][i];
+			// the comb output falls by 60 dB during the decay time
+			comb->feedback = (float)pow(10.0, -3.0 * comb->size / (MAX(decayTime, 0.1F) * MixerRate));
+		}
+	}
+}
+
+static void MIXER_ClearReverb() {
+	memset(CombBuffers, 0, sizeof(CombBuffers));
+	memset(AllpassBuffers, 0, sizeof(AllpassBuffers));
+	for (int ch = 0; ch < 2; ++ch) {
+		for (int i = 0; i < MIXER_COMBS; ++i) {
+			Combs[ch][i].index = 0;
+			Combs[ch][i].filter = 0.0F;
+		}
+		for (int i = 0; i < MIXER_ALLPASSES; ++i) {
+			Allpasses[ch][i].index = 0;
+		}
+	}
+}
+
+void MIXER_Init(DWORD outputRate, bool cubic) {
+	MixerRate = outputRate;
+	MixerCubic = cubic;
+	MixerHead.store(0);
+	MixerTail.store(0);
+	MixerDropped = 0;
+	MixerRendered.store(0);
+	MixerCommands.store(0);
+	MixerVoicesCount.store(0);
+	MixerPeakVoices.store(0);
+	for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+		MixerStarted[i] = 0;
+		MixerStopped[i] = true;
+		MixerFinished[i].store(0);
+		MixerVoices[i].active = false;
+	}
+
+	for (int ch = 0; ch < 2; ++ch) {
+		int spread = ch ? MIXER_STEREO_SPREAD : 0;
+		for (int i = 0; i < MIXER_COMBS; ++i) {
+			Combs[ch][i].buffer = CombBuffers[ch][i];
+			Combs[ch][i].size = MIN((CombTuning[i] + spread) * (int)outputRate / 44100, MIXER_COMB_SIZE);
+		}
+		for (int i = 0; i < MIXER_ALLPASSES; ++i) {
+			Allpasses[ch][i].buffer = AllpassBuffers[ch][i];
+			Allpasses[ch][i].size = MIN((AllpassTuning[i] + spread) * (int)outputRate / 44100, MIXER_ALLPASS_SIZE);
+			Allpasses[ch][i].feedback = 0.5F;
+		}
+	}
+	MIXER_SetReverbTime(1.0F);
+	MIXER_ClearReverb();
+	ReverbWet = 0.0F;
+}
+
+bool MIXER_Start(int voice, const short* data, DWORD frames, int pitch, float left, float right, bool looped) {
+	if (voice < 0 || voice >= MIXER_MAX_VOICES || data == NULL || !frames) return false;
+	MIXER_COMMAND cmd = { MIXCMD_Start, voice, data, frames, MixerStarted[voice] + 1, pitch, left, right, looped };
+	if (!MIXER_Push(&cmd)) return false;
+	MixerStarted[voice] = cmd.serial;
+	MixerStopped[voice] = false;
+	return true;
+}
+
+bool MIXER_Update(int voice, int pitch, float left, float right) {
+	if (voice < 0 || voice >= MIXER_MAX_VOICES) return false;
+	MIXER_COMMAND cmd = { MIXCMD_Update, voice, NULL, 0, MixerStarted[voice], pitch, left, right, false };
+	return MIXER_Push(&cmd);
+}
+
+bool MIXER_Stop(int voice) {
+	if (voice < 0 || voice >= MIXER_MAX_VOICES) return false;
+	MIXER_COMMAND cmd = { MIXCMD_Stop, voice, NULL, 0, MixerStarted[voice], 0, 0.0F, 0.0F, false };
+	// the voice still plays if the command is dropped
+	if (!MIXER_Push(&cmd)) return false;
+	MixerStopped[voice] = true;
+	return true;
+}
+
+bool MIXER_StopAll() {
+	MIXER_COMMAND cmd = { MIXCMD_StopAll, -1, NULL, 0, 0, 0, 0.0F, 0.0F, false };
+	if (!MIXER_Push(&cmd)) return false;
+	for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+		MixerStopped[i] = true;
+	}
+	return true;
+}
+
+// The decay time is in seconds, the wet level is a linear gain. The zero wet
+// level disables the reverb.
+bool MIXER_SetReverb(float decayTime, float wet) {
+	MIXER_COMMAND cmd = { MIXCMD_Reverb, -1, NULL, 0, 0, 0, decayTime, wet, false };
+	return MIXER_Push(&cmd);
+}
+
+bool MIXER_IsPlaying(int voice) {
+	if (voice < 0 || voice >= MIXER_MAX_VOICES || MixerStopped[voice]) return false;
+	return MixerFinished[voice].load(std::memory_order_acquire) != MixerStarted[voice];
+}
+
+bool MIXER_IsIdle() {
+	return MixerTail.load(std::memory_order_acquire) == MixerHead.load(std::memory_order_acquire);
+}
+
+static void MIXER_Finish(int voice) {
+	MixerVoices[voice].active = false;
+	MixerFinished[voice].store(MixerVoices[voice].serial, std::memory_order_release);
+}
+
+static void MIXER_ProcessCommands() {
+	DWORD tail = MixerTail.load(std::memory_order_relaxed);
+	DWORD head = MixerHead.load(std::memory_order_acquire);
+	DWORD count = head - tail;
+
+	for (; tail != head; ++tail) {
+		const MIXER_COMMAND* cmd = &MixerQueue[tail & (MIXER_QUEUE_SIZE - 1)];
+		MIXER_VOICE* voice = (cmd->voice >= 0) ? &MixerVoices[cmd->voice] : NULL;
+		switch (cmd->type) {
+		case MIXCMD_Start:
+			voice->data = cmd->data;
+			voice->frames = cmd->frames;
+			voice->pos = 0;
+			voice->step = MIXER_GetStep(cmd->pitch);
+			voice->left = voice->targetLeft = cmd->left;
+			voice->right = voice->targetRight = cmd->right;
+			voice->serial = cmd->serial;
+			voice->looped = cmd->looped;
+			voice->active = true;
+			break;
+		case MIXCMD_Update:
+			// the update may come for the voice that has already ended
+			if (voice->active && voice->serial == cmd->serial) {
+				voice->step = MIXER_GetStep(cmd->pitch);
+				voice->targetLeft = cmd->left;
+				voice->targetRight = cmd->right;
+			}
+			break;
+		case MIXCMD_Stop:
+			if (voice->active && voice->serial == cmd->serial) {
+				MIXER_Finish(cmd->voice);
+			}
+			break;
+		case MIXCMD_StopAll:
+			for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+				if (MixerVoices[i].active) MIXER_Finish(i);
+			}
+			break;
+		case MIXCMD_Reverb:
+			if (cmd->right > 0.0F && ReverbWet <= 0.0F) {
+				MIXER_ClearReverb();
+			}
+			MIXER_SetReverbTime(cmd->left);
+			ReverbWet = cmd->right;
+			break;
+		}
+		MixerTail.store(tail + 1, std::memory_order_release);
+	}
+	MixerCommands.fetch_add(count, std::memory_order_relaxed);
+}
+
+static inline float MIXER_Fetch(const MIXER_VOICE* voice, INT64 index) {
+	if (index >= 0 && index < (INT64)voice->frames) {
+		return voice->data[index];
+	}
+	if (!voice->looped) {
+		// the sample starts from its first frame and ends with silence
+		return (index < 0) ? voice->data[0] : 0.0F;
+	}
+	index %= (INT64)voice->frames;
+	if (index < 0) index += voice->frames;
+	return voice->data[index];
+}
+
+// Four output frames at once, starting from the given source position
+static inline __m128 MIXER_Resample4(const MIXER_VOICE* voice, UINT64 pos) {
+	alignas(16) float s0[4];
+	alignas(16) float s1[4];
+	alignas(16) float frac[4];
+
+	if (!MixerCubic) {
+		for (int i = 0; i < 4; ++i, pos += voice->step) {
+			INT64 index = (INT64)(pos >> 32);
+			s0[i] = MIXER_Fetch(voice, index);
+			s1[i] = MIXER_Fetch(voice, index + 1);
+			frac[i] = (float)(DWORD)pos * (1.0F / 4294967296.0F);
+		}
+		__m128 a = _mm_load_ps(s0);
+		return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(s1), a), _mm_load_ps(frac)));
+	}
+
+	alignas(16) float sm1[4];
+	alignas(16) float s2[4];
+	for (int i = 0; i < 4; ++i, pos += voice->step) {
+		INT64 index = (INT64)(pos >> 32);
+		sm1[i] = MIXER_Fetch(voice, index - 1);
+		s0[i] = MIXER_Fetch(voice, index);
+		s1[i] = MIXER_Fetch(voice, index + 1);
+		s2[i] = MIXER_Fetch(voice, index + 2);
+		frac[i] = (float)(DWORD)pos * (1.0F / 4294967296.0F);
+	}
+	// Catmull-Rom spline
+	__m128 ym1 = _mm_load_ps(sm1);
+	__m128 y0 = _mm_load_ps(s0);
+	__m128 y1 = _mm_load_ps(s1);
+	__m128 y2 = _mm_load_ps(s2);
+	__m128 t = _mm_load_ps(frac);
+	__m128 c1 = _mm_mul_ps(_mm_set1_ps(0.5F), _mm_sub_ps(y1, ym1));
+	__m128 c2 = _mm_sub_ps(_mm_add_ps(ym1, _mm_mul_ps(_mm_set1_ps(2.0F), y1)),
+		_mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.5F), y0), _mm_mul_ps(_mm_set1_ps(0.5F), y2)));
+	__m128 c3 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.5F), _mm_sub_ps(y2, ym1)), _mm_mul_ps(_mm_set1_ps(1.5F), _mm_sub_ps(y0, y1)));
+	return _mm_add_ps(y0, _mm_mul_ps(t, _mm_add_ps(c1, _mm_mul_ps(t, _mm_add_ps(c2, _mm_mul_ps(t, c3))))));
+}
+
+static void MIXER_MixVoice(int id, DWORD count) {
+	MIXER_VOICE* voice = &MixerVoices[id];
+	UINT64 end = (UINT64)voice->frames << 32;
+	// the gains are ramped during the block, so the updates don't click
+	float dl = (voice->targetLeft - voice->left) / count;
+	float dr = (voice->targetRight - voice->right) / count;
+	__m128 gl = _mm_setr_ps(voice->left, voice->left + dl, voice->left + dl * 2, voice->left + dl * 3);
+	__m128 gr = _mm_setr_ps(voice->right, voice->right + dr, voice->right + dr * 2, voice->right + dr * 3);
+	__m128 gdl = _mm_set1_ps(dl * 4);
+	__m128 gdr = _mm_set1_ps(dr * 4);
+	__m128 half = _mm_set1_ps(0.5F);
+
+	for (DWORD i = 0; i < count; i += 4) {
+		__m128 y = MIXER_Resample4(voice, voice->pos);
+		__m128 l = _mm_mul_ps(y, gl);
+		__m128 r = _mm_mul_ps(y, gr);
+		__m128 s = _mm_mul_ps(_mm_add_ps(l, r), half);
+		DWORD n = MIN(count - i, 4);
+		if (n == 4) {
+			_mm_store_ps(&MixLeft[i], _mm_add_ps(_mm_load_ps(&MixLeft[i]), l));
+			_mm_store_ps(&MixRight[i], _mm_add_ps(_mm_load_ps(&MixRight[i]), r));
+			_mm_store_ps(&MixSend[i], _mm_add_ps(_mm_load_ps(&MixSend[i]), s));
+		}
+		else {
+			alignas(16) float tl[4], tr[4], ts[4];
+			_mm_store_ps(tl, l);
+			_mm_store_ps(tr, r);
+			_mm_store_ps(ts, s);
+			for (DWORD j = 0; j < n; ++j) {
+				MixLeft[i + j] += tl[j];
+				MixRight[i + j] += tr[j];
+				MixSend[i + j] += ts[j];
+			}
+		}
+		gl = _mm_add_ps(gl, gdl);
+		gr = _mm_add_ps(gr, gdr);
+		voice->pos += voice->step * n;
+		if (voice->pos >= end) {
+			if (!voice->looped) {
+				MIXER_Finish(id);
+				break;
+			}
+			voice->pos %= end;
+		}
+	}
+	voice->left = voice->targetLeft;
+	voice->right = voice->targetRight;
+}
+
+static void MIXER_ApplyReverb(DWORD count) {
+	for (int ch = 0; ch < 2; ++ch) {
+		float* mix = ch ? MixRight : MixLeft;
+		for (DWORD i = 0; i < count; ++i) {
+			float input = MixSend[i] * MIXER_REVERB_INPUT;
+			float output = 0.0F;
+			for (int j = 0; j < MIXER_COMBS; ++j) {
+				MIXER_DELAY* comb = &Combs[ch][j];
+				float delayed = comb->buffer[comb->index];
+				comb->filter = delayed + (comb->filter - delayed) * MIXER_REVERB_DAMP;
+				comb->buffer[comb->index] = input + comb->filter * comb->feedback;
+				if (++comb->index >= comb->size) comb->index = 0;
+				output += delayed;
+			}
+			for (int j = 0; j < MIXER_ALLPASSES; ++j) {
+				MIXER_DELAY* allpass = &Allpasses[ch][j];
+				float delayed = allpass->buffer[allpass->index];
+				allpass->buffer[allpass->index] = output + delayed * allpass->feedback;
+				if (++allpass->index >= allpass->size) allpass->index = 0;
+				output = delayed - output;
+			}
+			mix[i] += output * ReverbWet;
+		}
+	}
+}
+
+// Must be called only from one thread at a time
+void MIXER_Render(short* output, DWORD frames) {
+	// the reverb tails must not become denormals
+	unsigned int csr = _mm_getcsr();
+	_mm_setcsr(csr | 0x8040);
+	MIXER_ProcessCommands();
+
+	DWORD voices = 0;
+	while (frames > 0) {
+		DWORD count = MIN(frames, MIXER_BLOCK);
+		memset(MixLeft, 0, sizeof(MixLeft));
+		memset(MixRight, 0, sizeof(MixRight));
+		memset(MixSend, 0, sizeof(MixSend));
+		voices = 0;
+		for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+			if (!MixerVoices[i].active) continue;
+			MIXER_MixVoice(i, count);
+			++voices;
+		}
+		if (ReverbWet > 0.0F) {
+			MIXER_ApplyReverb(count);
+		}
+
+		DWORD i = 0;
+		for (; i + 4 <= count; i += 4) {
+			__m128 l = _mm_load_ps(&MixLeft[i]);
+			__m128 r = _mm_load_ps(&MixRight[i]);
+			__m128i lo = _mm_cvtps_epi32(_mm_unpacklo_ps(l, r));
+			__m128i hi = _mm_cvtps_epi32(_mm_unpackhi_ps(l, r));
+			_mm_storeu_si128((__m128i*)&output[i * 2], _mm_packs_epi32(lo, hi));
+		}
+		for (; i < count; ++i) {
+			float l = MixLeft[i];
+			float r = MixRight[i];
+			CLAMP(l, -32768.0F, 32767.0F);
+			CLAMP(r, -32768.0F, 32767.0F);
+			output[i * 2] = (short)l;
+			output[i * 2 + 1] = (short)r;
+		}
+		output += count * 2;
+		frames -= count;
+		MixerRendered.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	MixerVoicesCount.store(voices, std::memory_order_relaxed);
+	if (voices > MixerPeakVoices.load(std::memory_order_relaxed)) {
+		MixerPeakVoices.store(voices, std::memory_order_relaxed);
+	}
+	_mm_setcsr(csr);
+}
+
+// Renders the mix into a 16 bit stereo wave file instead of the output, so
+// the mixer can be checked without the audio device. The mixer thread must
+// not run at the same time.
+bool MIXER_WriteWave(const char* path, DWORD frames) {
+	FILE* file = fopen(path, "wb");
+	if (file == NULL) return false;
+
+	DWORD dataSize = frames * 4;
+	DWORD header[11] = {
+		0x46464952, 36 + dataSize, 0x45564157, // "RIFF", size, "WAVE"
+		0x20746D66, 16, 0x00020001, MixerRate, MixerRate * 4, 0x00100004, // "fmt ", PCM, 2 channels, 16 bits
+		0x61746164, dataSize, // "data"
+	};
+	bool result = (fwrite(header, sizeof(header), 1, file) == 1);
+
+	short buffer[MIXER_BLOCK * 2];
+	while (result && frames > 0) {
+		DWORD count = MIN(frames, MIXER_BLOCK);
+		MIXER_Render(buffer, count);
+		result = (fwrite(buffer, sizeof(short) * 2, count, file) == count);
+		frames -= count;
+	}
+	fclose(file);
+	return result;
+}
+
+void MIXER_GetStats(MIXER_STATS* stats) {
+	stats->rendered = MixerRendered.load(std::memory_order_relaxed);
+	stats->commands = MixerCommands.load(std::memory_order_relaxed);
+	stats->dropped = MixerDropped;
+	stats->voices = MixerVoicesCount.load(std::memory_order_relaxed);
+	stats->peakVoices = MixerPeakVoices.load(std::memory_order_relaxed);
+}
+
+#endif // FEATURE_SOFTWARE_MIXER
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIXER_H_INCLUDED
+#define MIXER_H_INCLUDED
+
+#include "global/types.h"
+
+#define MIXER_MAX_VOICES (256)
+#define MIXER_SOURCE_RATE (11025)
+
+typedef struct {
+	DWORD rendered; // output frames
+	DWORD commands;
+	DWORD dropped; // commands lost because the queue was full
+	DWORD voices; // voices mixed by the last render
+	DWORD peakVoices;
+} MIXER_STATS;
+
+ /*
+  * Function list
+  */
+void MIXER_Init(DWORD outputRate, bool cubic);
+bool MIXER_Start(int voice, const short* data, DWORD frames, int pitch, float left, float right, bool looped);
+bool MIXER_Update(int voice, int pitch, float left, float right);
+bool MIXER_Stop(int voice);
+bool MIXER_StopAll();
+bool MIXER_SetReverb(float decayTime, float wet);
+bool MIXER_IsPlaying(int voice);
+bool MIXER_IsIdle();
+void MIXER_Render(short* output, DWORD frames);
+bool MIXER_WriteWave(const char* path, DWORD frames);
+void MIXER_GetStats(MIXER_STATS* stats);
+
+#endif // MIXER_H_INCLUDED
@@ -23,15 +23,76 @@
 #include "modding/mod_utils.h"
 #include "game/invfunc.h"
 
+#ifdef FEATURE_MOD_CONFIG_CACHE
+#include <unordered_map>
+#endif // FEATURE_MOD_CONFIG_CACHE
+
 #define MOD_CONFIG_NAME "TR2Main.json"
 
+#ifdef FEATURE_MOD_CONFIG_CACHE
+typedef struct ModFilters_t {
+    SEMITRANS_CONFIG semitrans;
+    REFLECT_CONFIG reflect;
+} MOD_FILTERS;
+
+typedef struct ModLevel_t {
+    SizeType docIndex;
+    MOD_FILTERS filters;
+} MOD_LEVEL;
+
+// The json is compiled once per file change: the document is kept parsed, the
+// levels are indexed by their uppercased filename, and the polyfilter lists of
+// every level are prebuilt into flat tables that Mod points into directly.
+// Defined before Mod, so it outlives the Mod destructor.
+static struct {
+    bool isValid;
+    bool isCompiling;
+    FILETIME writeTime;
+    DWORD fileSize;
+    DWORD hash;
+    Document doc;
+    std::unordered_map<std::string, SizeType> levelIndex;
+    std::vector<MOD_LEVEL> levels;
+    std::vector<POLYFILTER_NODE> nodes;
+    std::vector<POLYINDEX> animtex;
+    MOD_FILTERS defaults;
+} ModCache;
+
+static bool IsCachedNode(const POLYFILTER_NODE* node) {
+    return !ModCache.nodes.empty() && node >= &ModCache.nodes.front() && node <= &ModCache.nodes.back();
+}
+
+static bool IsCachedAnimtex(const POLYINDEX* animtex) {
+    return !ModCache.animtex.empty() && animtex >= &ModCache.animtex.front() && animtex <= &ModCache.animtex.back();
+}
+
+static bool UpdateModConfigCache();
+static void ParseCachedConfiguration(LPCSTR currentLevel);
+#endif // FEATURE_MOD_CONFIG_CACHE
+
+typedef struct PolyfilterSlot_t {
+    int objID;
+    int meshIdx; // -1 for static meshes
+    POLYFILTER* filter; // NULL for free slots
+} POLYFILTER_SLOT;
+
+// Open addressed (objID, meshIdx) -> filter table of the reflect config, it's
+// rebuilt on each config load and probed for every mesh drawn.
+static std::vector<POLYFILTER_SLOT> ReflectIndex;
+
+static void BuildReflectIndex();
+
 ModConfig Mod;
 void ModConfig::Initialize() {
     ZeroMemory(&Mod, sizeof(Mod));
 }
 
 void ModConfig::Release() {
+#ifdef FEATURE_MOD_CONFIG_CACHE
+    if (Mod.semitrans.animtex != NULL && !IsCachedAnimtex(Mod.semitrans.animtex)) {
+#else // FEATURE_MOD_CONFIG_CACHE
     if (Mod.semitrans.animtex != NULL) {
+#endif // FEATURE_MOD_CONFIG_CACHE
         free(Mod.semitrans.animtex);
         Mod.semitrans.animtex = NULL;
     }
@@ -42,6 +103,7 @@ void ModConfig::Release() {
         FreePolyfilterNodes(&Mod.semitrans.objects[i]);
         FreePolyfilterNodes(&Mod.reflect.objects[i]);
     }
+    ReflectIndex.clear();
     ZeroMemory(&Mod, sizeof(Mod));
 }
 
@@ -51,6 +113,11 @@ bool ModConfig::LoadJson(LPCSTR filePath) {
         return false;
     }
 
+#ifdef FEATURE_MOD_CONFIG_CACHE
+    if (!UpdateModConfigCache()) {
+        return false;
+    }
+#else // FEATURE_MOD_CONFIG_CACHE
     std::ifstream file(MOD_CONFIG_NAME);
     std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     StringStream ss(json.c_str());
@@ -64,6 +131,7 @@ bool ModConfig::LoadJson(LPCSTR filePath) {
         ParseJsonError(MOD_CONFIG_NAME, lineID, doc.GetParseError());
         return false;
     }
+#endif // FEATURE_MOD_CONFIG_CACHE
 
     char levelName[256] = { 0 };
     strncpy(levelName, PathFindFileName(filePath), sizeof(levelName) - 1);
@@ -76,8 +144,13 @@ bool ModConfig::LoadJson(LPCSTR filePath) {
     for (size_t i = 0; i < strlen(levelName); i++)
         levelName[i] = std::toupper(levelName[i]);
 
+#ifdef FEATURE_MOD_CONFIG_CACHE
+    ParseCachedConfiguration(levelName);
+#else // FEATURE_MOD_CONFIG_CACHE
     if (doc.HasMember("default")) ParseDefaultConfiguration(doc["default"]);
     if (doc.HasMember("levels")) ParseLevelConfiguration(doc["levels"], levelName);
+#endif // FEATURE_MOD_CONFIG_CACHE
+    BuildReflectIndex();
     return Mod.isLoaded;
 }
 
@@ -298,6 +371,7 @@ void LoadLevelConfig(Value& data) {
     Mod.monkAttackBandit = GetValueByNameBool(data, "does_monk_attack_bandit", true);
     Mod.trexAttackWorker = GetValueByNameBool(data, "does_trex_attack_worker", false);
     Mod.workerAttackTRex = GetValueByNameBool(data, "does_worker_attack_trex", false);
+    Mod.creatureSlots = GetValueByNameShort(data, "creature_slots", MAX_CREATURES);
     Mod.enemyBarEnabled = GetValueByNameBool(data, "enable_enemy_bar", true);
     Mod.makeYetiExplodeOnDeath = GetValueByNameBool(data, "make_yeti_explode_on_death", false);
 
@@ -317,13 +391,25 @@ void LoadLevelConfig(Value& data) {
     Mod.isSnowOpaque = GetValueByNameBool(data, "is_snow_opaque", true);
 }
 
+static POLYINDEX* CreatePolyIndexList() {
+#ifdef FEATURE_MOD_CONFIG_CACHE
+    if (ModCache.isCompiling) {
+        size_t offset = ModCache.animtex.size();
+        if (offset + POLYFILTER_SIZE > ModCache.animtex.capacity()) return NULL;
+        ModCache.animtex.resize(offset + POLYFILTER_SIZE);
+        return &ModCache.animtex[offset];
+    }
+#endif // FEATURE_MOD_CONFIG_CACHE
+    return (POLYINDEX*)malloc(sizeof(POLYINDEX) * POLYFILTER_SIZE);
+}
+
 void LoadSemitransConfig(Value& data, SEMITRANS_CONFIG* semitrans) {
     if (data.HasMember("animtex"))
     {
         LPCSTR animTexStr = data["animtex"].GetString();
         if (strcasecmp(animTexStr, "auto"))
         {
-            semitrans->animtex = (POLYINDEX*)malloc(sizeof(POLYINDEX) * POLYFILTER_SIZE);
+            semitrans->animtex = CreatePolyIndexList();
             if (semitrans->animtex)
                 ParsePolyValue(animTexStr, semitrans->animtex, POLYFILTER_SIZE);
         }
@@ -677,7 +763,7 @@ void LoadUIConfigDefault()
     Mod.isUIColorLoaded = false;
 }
 
-void ParseDefaultConfiguration(Value& data) {
+void ParseDefaultConfiguration(Value& data, bool loadFilters) {
     SizeType a, b, c;
 
     Mod.pistolAtStart = GetValueByNameBool(data, "pistols_at_start", true);
@@ -708,12 +794,25 @@ void ParseDefaultConfiguration(Value& data) {
     LoadAirBarConfig(data["lara_air_bar"], &Mod.laraBar.air);
     LoadHealthBarConfig(data["enemy_health_bar"], &Mod.enemyBar);
 
-    if (data.HasMember("semi_transparent")) LoadSemitransConfig(data["semi_transparent"], &Mod.semitrans);
-    if (data.HasMember("reflective")) LoadReflectConfig(data["reflective"], &Mod.reflect);
+    if (loadFilters) {
+        if (data.HasMember("semi_transparent")) LoadSemitransConfig(data["semi_transparent"], &Mod.semitrans);
+        if (data.HasMember("reflective")) LoadReflectConfig(data["reflective"], &Mod.reflect);
+    }
     if (data.HasMember("ui_config")) LoadUIConfig(data["ui_config"], "ui_config");
     else if (!Mod.isUIColorLoaded) LoadUIConfigDefault();
 }
 
+static void LoadLevelEntry(Value& level, bool loadFilters) {
+    LoadLevelConfig(level);
+    if (loadFilters) {
+        if (level.HasMember("semitransparent")) LoadSemitransConfig(level["semitransparent"], &Mod.semitrans);
+        if (level.HasMember("reflective")) LoadReflectConfig(level["reflective"], &Mod.reflect);
+    }
+    if (level.HasMember("inventory_item_list")) LoadCustomInventoryItems(level["inventory_item_list"]);
+    if (level.HasMember("ui_config")) LoadUIConfig(level["ui_config"], "ui_config");
+    else if (!Mod.isUIColorLoaded) LoadUIConfigDefault();
+}
+
 void ParseLevelConfiguration(Value& data, LPCSTR currentLevel) {
     if (!data.IsArray()) {
         LogWarn("Failed to load level configuration (json), 'levels' is not an array !");
@@ -734,12 +833,7 @@ void ParseLevelConfiguration(Value& data, LPCSTR currentLevel) {
         if (level.HasMember("filename")) {
             // If the filename is equal then load it !
             if (strcasecmp(level["filename"].GetString(), currentLevel) == 0) {
-                LoadLevelConfig(level);
-                if (level.HasMember("semitransparent")) LoadSemitransConfig(level["semitransparent"], &Mod.semitrans);
-                if (level.HasMember("reflective")) LoadReflectConfig(level["reflective"], &Mod.reflect);
-                if (level.HasMember("inventory_item_list")) LoadCustomInventoryItems(level["inventory_item_list"]);
-                if (level.HasMember("ui_config")) LoadUIConfig(level["ui_config"], "ui_config");
-                else if (!Mod.isUIColorLoaded) LoadUIConfigDefault();
+                LoadLevelEntry(level, true);
                 break;
             }
             else
@@ -755,10 +849,249 @@ void ParseLevelConfiguration(Value& data, LPCSTR currentLevel) {
     }
 }
 
+#ifdef FEATURE_MOD_CONFIG_CACHE
+static DWORD HashModConfig(const std::string& json) {
+    DWORD hash = 2166136261; // FNV-1a
+    for (size_t i = 0; i < json.size(); ++i) {
+        hash = (hash ^ (BYTE)json[i]) * 16777619;
+    }
+    return hash;
+}
+
+static SizeType CountArrayMember(Value& data, LPCSTR name) {
+    return (data.HasMember(name) && data[name].IsArray()) ? data[name].Size() : 0;
+}
+
+// Upper bound of the polyfilter nodes and animtex lists a section can create
+static void CountFilterSection(Value& data, SizeType* nodeCount, SizeType* animtexCount) {
+    if (!data.IsObject()) return;
+    if (data.HasMember("animtex")) ++*animtexCount;
+    *nodeCount += CountArrayMember(data, "statics");
+    *nodeCount += CountArrayMember(data, "rooms");
+    if (data.HasMember("objects") && data["objects"].IsArray())
+    {
+        Value& objectList = data["objects"];
+        for (SizeType i = 0; i < objectList.Size(); i++)
+        {
+            if (objectList[i].IsObject()) *nodeCount += CountArrayMember(objectList[i], "meshes");
+        }
+    }
+}
+
+static void ResetModConfigCache() {
+    ModCache.isValid = false;
+    Document().Swap(ModCache.doc);
+    ModCache.levelIndex.clear();
+    ModCache.levels.clear();
+    std::vector<POLYFILTER_NODE>().swap(ModCache.nodes);
+    std::vector<POLYINDEX>().swap(ModCache.animtex);
+    ZeroMemory(&ModCache.defaults, sizeof(ModCache.defaults));
+}
+
+static void CompileModConfig() {
+    Document& doc = ModCache.doc;
+    Value* defaults = (doc.IsObject() && doc.HasMember("default")) ? &doc["default"] : NULL;
+    Value* levels = (doc.IsObject() && doc.HasMember("levels")) ? &doc["levels"] : NULL;
+    SizeType nodeCount = 0;
+    SizeType animtexCount = 0;
+
+    if (defaults != NULL) {
+        if (defaults->HasMember("semi_transparent")) CountFilterSection((*defaults)["semi_transparent"], &nodeCount, &animtexCount);
+        if (defaults->HasMember("reflective")) CountFilterSection((*defaults)["reflective"], &nodeCount, &animtexCount);
+    }
+
+    if (levels != NULL && !levels->IsArray()) {
+        LogWarn("Failed to load level configuration (json), 'levels' is not an array !");
+        levels = NULL;
+    }
+    else if (levels != NULL && levels->Size() <= 0) {
+        LogWarn("Failed to load level configuration (json), no level in the array !");
+    }
+
+    // Index the levels by filename, the first entry of a filename wins
+    for (SizeType i = 0; levels != NULL && i < levels->Size(); i++)
+    {
+        Value& level = (*levels)[i];
+        if (!level.HasMember("filename")) {
+            LogWarn("Failed to load level configuration (json), level entry %d not have a 'filename' entry !", i);
+            break;
+        }
+        std::string name = level["filename"].GetString();
+        for (size_t j = 0; j < name.size(); j++)
+            name[j] = std::toupper((BYTE)name[j]);
+        if (!ModCache.levelIndex.emplace(name, (SizeType)ModCache.levels.size()).second)
+            continue;
+
+        MOD_LEVEL entry = {};
+        entry.docIndex = i;
+        ModCache.levels.push_back(entry);
+        if (level.HasMember("semitransparent")) CountFilterSection(level["semitransparent"], &nodeCount, &animtexCount);
+        if (level.HasMember("reflective")) CountFilterSection(level["reflective"], &nodeCount, &animtexCount);
+    }
+
+    // Levels start from the default lists and replace only the lists they define,
+    // so the default nodes are built once and shared by every level
+    ModCache.nodes.reserve(nodeCount);
+    ModCache.animtex.reserve(animtexCount * POLYFILTER_SIZE);
+    ModCache.isCompiling = true;
+    if (defaults != NULL) {
+        if (defaults->HasMember("semi_transparent")) LoadSemitransConfig((*defaults)["semi_transparent"], &ModCache.defaults.semitrans);
+        if (defaults->HasMember("reflective")) LoadReflectConfig((*defaults)["reflective"], &ModCache.defaults.reflect);
+    }
+    for (size_t i = 0; i < ModCache.levels.size(); i++)
+    {
+        MOD_LEVEL* entry = &ModCache.levels[i];
+        Value& level = (*levels)[entry->docIndex];
+        entry->filters = ModCache.defaults;
+        if (level.HasMember("semitransparent")) LoadSemitransConfig(level["semitransparent"], &entry->filters.semitrans);
+        if (level.HasMember("reflective")) LoadReflectConfig(level["reflective"], &entry->filters.reflect);
+    }
+    ModCache.isCompiling = false;
+}
+
+static bool UpdateModConfigCache() {
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!GetFileAttributesEx(MOD_CONFIG_NAME, GetFileExInfoStandard, &attr)) {
+        LogWarn("Failed to load json: %s, does not exist !", MOD_CONFIG_NAME);
+        Mod.Release();
+        ResetModConfigCache();
+        return false;
+    }
+
+    // Nothing to do if the file is untouched since the last compilation
+    if (ModCache.isValid && attr.nFileSizeLow == ModCache.fileSize && !CompareFileTime(&attr.ftLastWriteTime, &ModCache.writeTime)) {
+        return true;
+    }
+
+    std::ifstream file(MOD_CONFIG_NAME);
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    DWORD hash = HashModConfig(json);
+    if (ModCache.isValid && hash == ModCache.hash) {
+        ModCache.writeTime = attr.ftLastWriteTime;
+        ModCache.fileSize = attr.nFileSizeLow;
+        return true;
+    }
+
+    // Mod must not point into the tables being dropped
+    Mod.Release();
+    ResetModConfigCache();
+
+    StringStream ss(json.c_str());
+    CursorStreamWrapper<StringStream> csw(ss);
+    Document doc;
+    doc.ParseStream(csw);
+    if (doc.HasParseError()) {
+        size_t lineID = csw.GetLine();
+        if (lineID > 0)
+            lineID--;
+        ParseJsonError(MOD_CONFIG_NAME, lineID, doc.GetParseError());
+        return false;
+    }
+
+    ModCache.doc.Swap(doc);
+    CompileModConfig();
+    ModCache.writeTime = attr.ftLastWriteTime;
+    ModCache.fileSize = attr.nFileSizeLow;
+    ModCache.hash = hash;
+    ModCache.isValid = true;
+    LogDebug("Mod configuration compiled: %d levels, %d polyfilters", (int)ModCache.levels.size(), (int)ModCache.nodes.size());
+    return true;
+}
+
+static void ParseCachedConfiguration(LPCSTR currentLevel) {
+    Document& doc = ModCache.doc;
+    MOD_FILTERS* filters = &ModCache.defaults;
+
+    if (doc.IsObject() && doc.HasMember("default")) ParseDefaultConfiguration(doc["default"], false);
+
+    auto it = ModCache.levelIndex.find(currentLevel);
+    if (it != ModCache.levelIndex.end()) {
+        MOD_LEVEL* level = &ModCache.levels[it->second];
+        LoadLevelEntry(doc["levels"][level->docIndex], false);
+        filters = &level->filters;
+    }
+    else if (!ModCache.levels.empty()) {
+        LogWarn("Failed to load level configuration, filename entry: %s not found !", currentLevel);
+    }
+
+    // The prebuilt lists are used in place, Release skips them
+    Mod.semitrans = filters->semitrans;
+    Mod.reflect = filters->reflect;
+}
+#endif // FEATURE_MOD_CONFIG_CACHE
+
+static DWORD HashPolyfilterKey(int objID, int meshIdx) {
+    DWORD hash = (DWORD)objID * 0x9E3779B1 + (DWORD)meshIdx * 0x85EBCA77;
+    return hash ^ (hash >> 16);
+}
+
+// objID is -1 for the statics list, its nodes are keyed by the static ID
+static void InsertReflectIndex(POLYFILTER_NODE* node, int objID) {
+    DWORD mask = ReflectIndex.size() - 1;
+    for (; node != NULL; node = node->next) {
+        int id = (objID < 0) ? node->id : objID;
+        int idx = (objID < 0) ? -1 : node->id;
+        DWORD i = HashPolyfilterKey(id, idx) & mask;
+        // On duplicates the first node of the list wins
+        while (ReflectIndex[i].filter != NULL && (ReflectIndex[i].objID != id || ReflectIndex[i].meshIdx != idx)) {
+            i = (i + 1) & mask;
+        }
+        if (ReflectIndex[i].filter == NULL) {
+            ReflectIndex[i].objID = id;
+            ReflectIndex[i].meshIdx = idx;
+            ReflectIndex[i].filter = &node->filter;
+        }
+    }
+}
+
+static void BuildReflectIndex() {
+    ReflectIndex.clear();
+    if (!Mod.reflect.isLoaded) return;
+
+    DWORD count = 0;
+    for (POLYFILTER_NODE* node = Mod.reflect.statics; node != NULL; node = node->next) ++count;
+    for (DWORD i = 0; i < ARRAY_SIZE(Mod.reflect.objects); ++i) {
+        for (POLYFILTER_NODE* node = Mod.reflect.objects[i]; node != NULL; node = node->next) ++count;
+    }
+    if (count == 0) return;
+
+    // Keep the load factor at 50% or below, so the probes stay short
+    DWORD size = 16;
+    while (size < count * 2) size <<= 1;
+    ReflectIndex.assign(size, POLYFILTER_SLOT());
+
+    InsertReflectIndex(Mod.reflect.statics, -1);
+    for (DWORD i = 0; i < ARRAY_SIZE(Mod.reflect.objects); ++i) {
+        InsertReflectIndex(Mod.reflect.objects[i], i);
+    }
+}
+
+POLYFILTER* FindReflectFilter(int objID, int meshIdx) {
+    if (ReflectIndex.empty()) return NULL;
+    if (meshIdx < 0) meshIdx = -1;
+    DWORD mask = ReflectIndex.size() - 1;
+    for (DWORD i = HashPolyfilterKey(objID, meshIdx) & mask; ReflectIndex[i].filter != NULL; i = (i + 1) & mask) {
+        if (ReflectIndex[i].objID == objID && ReflectIndex[i].meshIdx == meshIdx) {
+            return ReflectIndex[i].filter;
+        }
+    }
+    return NULL;
+}
+
 POLYFILTER* CreatePolyfilterNode(POLYFILTER_NODE** data, int id)
 {
     if (data == NULL) return NULL;
-    POLYFILTER_NODE* node = (POLYFILTER_NODE*)malloc(sizeof(POLYFILTER_NODE));
+    POLYFILTER_NODE* node = NULL;
+#ifdef FEATURE_MOD_CONFIG_CACHE
+    if (ModCache.isCompiling) {
+        // The table is reserved up front so the nodes never move
+        if (ModCache.nodes.size() >= ModCache.nodes.capacity()) return NULL;
+        ModCache.nodes.emplace_back();
+        node = &ModCache.nodes.back();
+    }
+    else
+#endif // FEATURE_MOD_CONFIG_CACHE
+    node = (POLYFILTER_NODE*)malloc(sizeof(POLYFILTER_NODE));
     if (node == NULL) return NULL;
     node->id = id;
     node->next = *data;
@@ -773,6 +1106,10 @@ void FreePolyfilterNodes(POLYFILTER_NODE** data)
     POLYFILTER_NODE* node = *data;
     while (node) {
         POLYFILTER_NODE* next = node->next;
+#ifdef FEATURE_MOD_CONFIG_CACHE
+        // Cached nodes are owned by the compiled tables
+        if (!IsCachedNode(node))
+#endif // FEATURE_MOD_CONFIG_CACHE
         free(node);
         node = next;
     }
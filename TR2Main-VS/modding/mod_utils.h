@@ -25,6 +25,7 @@ struct ModConfig
 	bool enableFourSecret = false;
 	bool workerAttackTRex = true;
 	bool trexAttackWorker = true;
+	short creatureSlots = MAX_CREATURES;
 
 	bool pistolAtStart = true;
 	bool shotgunAtStart = true;
@@ -107,11 +108,12 @@ extern void LoadReflectConfig(Value& data, REFLECT_CONFIG* reflect);
 extern void LoadUIConfig(Value& data, LPCSTR name);
 extern void LoadUIConfigDefault();
 
-extern void ParseDefaultConfiguration(Value& data);
+extern void ParseDefaultConfiguration(Value& data, bool loadFilters = true);
 extern void ParseLevelConfiguration(Value& data, LPCSTR currentLevel);
 
 extern POLYFILTER* CreatePolyfilterNode(POLYFILTER_NODE** root, int id);
 extern void FreePolyfilterNodes(POLYFILTER_NODE** root);
+extern POLYFILTER* FindReflectFilter(int objID, int meshIdx);
 extern bool IsCompatibleFilterObjects(short* ptrObj, POLYFILTER* filter);
 extern short* EnumeratePolysSpecificObjects(short* ptrObj, int vtxCount, bool colored, ENUM_POLYS_OBJECTS_CB callback, POLYINDEX* filter, LPVOID param);
 extern void EnumeratePolysSpecificRoomFace4(FACE4* ptrObj, int faceCount, bool colored, ENUM_POLYS_FACE4_CB callback, POLYINDEX* filter, LPVOID param);
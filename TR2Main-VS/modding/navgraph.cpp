@@ -0,0 +1,414 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/navgraph.h"
+#include "global/vars.h"
+
+#if defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
+
+// The box overlaps are packed into the CSR graph on the level load, with
+// the height change of every edge precomputed. A field is the finished box
+// search of one target box for one LOT profile: the exit box of every box
+// the search reaches. The search never leaves the zone of the target box,
+// so a field holds the zone boxes only. The fields are kept in a small LRU
+// cache, so the creatures with the same target share one search, and the
+// next target change to a cached box is a table lookup. The cache slots are
+// carved from one pool allocated with the graph, since a field never holds
+// more nodes than there are boxes.
+// The flood repeats SearchLOT exactly, so the exit boxes are the same.
+// A missing field is built by one pending flood that takes its expansions
+// from the shared path budget, so it may span several ticks.
+// The doors and windows toggle the blocked flag of their boxes, so the
+// blockable boxes are watched, and any change drops all fields. Until the field
+// is ready, the creatures continue with their own incremental searches.
+#define NAV_CACHE_SIZE (32)
+#define NAV_NONE ((UINT16)-1)
+#define NAV_BLOCKED (0x8000)
+
+typedef enum {
+	NAV_Unvisited,
+	NAV_Reached,
+	NAV_Blocked,
+} NAV_STATE;
+
+typedef struct NavNode_t {
+	UINT16 boxNumber; // NAV_BLOCKED is set if the box is blocked
+	UINT16 exitBox;
+} NAV_NODE;
+
+typedef struct NavField_t {
+	NAV_NODE* nodes;
+	DWORD count;
+	DWORD lastUse;
+	UINT16 targetBox;
+	UINT16 blockMask;
+	short step;
+	short drop;
+	short fly;
+	short flip;
+} NAV_FIELD;
+
+static DWORD NavBoxesCount = 0;
+static DWORD* NavOffsets = NULL;
+static UINT16* NavEdges = NULL;
+static short* NavRises = NULL;
+
+// the flood scratch data
+static BYTE* NavStates = NULL;
+static UINT16* NavExits = NULL;
+static UINT16* NavNext = NULL;
+static UINT16* NavVisited = NULL;
+static DWORD NavVisitedCount = 0;
+
+// the blockable boxes and their last seen blocked flags
+static UINT16* NavBlockable = NULL;
+static UINT16* NavBlockFlags = NULL;
+static DWORD NavBlockableCount = 0;
+
+// the pending flood of the missing field
+static struct {
+	bool isActive;
+	UINT16 targetBox;
+	UINT16 blockMask;
+	short step;
+	short drop;
+	short fly;
+	short flip;
+	UINT16 head;
+	UINT16 tail;
+	UINT16* zone;
+} NavBuild;
+
+static NAV_NODE* NavPool = NULL;
+static NAV_FIELD NavCache[NAV_CACHE_SIZE];
+static DWORD NavUseCounter = 0;
+
+static void NAV_ResetScratch() {
+	for (DWORD i = 0; i < NavVisitedCount; ++i) {
+		NavStates[NavVisited[i]] = NAV_Unvisited;
+		NavNext[NavVisited[i]] = NAV_NONE;
+	}
+	NavVisitedCount = 0;
+}
+
+static void NAV_ClearCache() {
+	for (int i = 0; i < NAV_CACHE_SIZE; ++i) {
+		NavCache[i].count = 0;
+		NavCache[i].lastUse = 0;
+	}
+	NavUseCounter = 0;
+	if (NavBuild.isActive) {
+		NAV_ResetScratch();
+		NavBuild.isActive = false;
+	}
+}
+
+void NAV_Invalidate() {
+	if (NavBoxesCount != 0) {
+		NAV_ClearCache();
+	}
+}
+
+void NAV_Release() {
+	NAV_ClearCache();
+	free(NavOffsets);
+	free(NavEdges);
+	free(NavRises);
+	free(NavStates);
+	free(NavExits);
+	free(NavNext);
+	free(NavVisited);
+	free(NavPool);
+	free(NavBlockable);
+	free(NavBlockFlags);
+	memset(NavCache, 0, sizeof(NavCache));
+	NavOffsets = NULL;
+	NavEdges = NULL;
+	NavRises = NULL;
+	NavStates = NULL;
+	NavExits = NULL;
+	NavNext = NULL;
+	NavVisited = NULL;
+	NavPool = NULL;
+	NavBlockable = NULL;
+	NavBlockFlags = NULL;
+	NavBlockableCount = 0;
+	NavVisitedCount = 0;
+	NavBoxesCount = 0;
+}
+
+void NAV_BuildGraph() {
+	DWORD edgeCount = 0;
+	DWORD blockableCount = 0;
+	NAV_Release();
+	if (BoxesCount == 0 || Boxes == NULL || Overlaps == NULL) {
+		return;
+	}
+
+	NavOffsets = (DWORD*)malloc(sizeof(DWORD) * (BoxesCount + 1));
+	if (NavOffsets == NULL) {
+		return;
+	}
+	// the same overlap walk as in SearchLOT: the list ends with END_BIT
+	for (DWORD i = 0; i < BoxesCount; ++i) {
+		int index = Boxes[i].overlapIndex & 0x3FFF;
+		NavOffsets[i] = edgeCount;
+		if (Boxes[i].overlapIndex & 0x8000) {
+			++blockableCount;
+		}
+		do {
+			++edgeCount;
+		} while (!(Overlaps[index++] & END_BIT));
+	}
+	NavOffsets[BoxesCount] = edgeCount;
+
+	NavEdges = (UINT16*)malloc(sizeof(UINT16) * edgeCount);
+	NavRises = (short*)malloc(sizeof(short) * edgeCount);
+	NavStates = (BYTE*)malloc(sizeof(BYTE) * BoxesCount);
+	NavExits = (UINT16*)malloc(sizeof(UINT16) * BoxesCount);
+	NavNext = (UINT16*)malloc(sizeof(UINT16) * BoxesCount);
+	NavVisited = (UINT16*)malloc(sizeof(UINT16) * BoxesCount);
+	NavPool = (NAV_NODE*)malloc(sizeof(NAV_NODE) * BoxesCount * NAV_CACHE_SIZE);
+	NavBlockable = (UINT16*)malloc(sizeof(UINT16) * (blockableCount + 1));
+	NavBlockFlags = (UINT16*)malloc(sizeof(UINT16) * (blockableCount + 1));
+	if (NavEdges == NULL || NavRises == NULL || NavStates == NULL
+		|| NavExits == NULL || NavNext == NULL || NavVisited == NULL || NavPool == NULL
+		|| NavBlockable == NULL || NavBlockFlags == NULL)
+	{
+		LogWarn("Failed to allocate the box graph for %d boxes", BoxesCount);
+		NAV_Release();
+		return;
+	}
+
+	for (DWORD i = 0; i < BoxesCount; ++i) {
+		int index = Boxes[i].overlapIndex & 0x3FFF;
+		for (DWORD j = NavOffsets[i]; j < NavOffsets[i + 1]; ++j) {
+			UINT16 boxNumber = Overlaps[index++] & ~END_BIT;
+			NavEdges[j] = boxNumber;
+			NavRises[j] = Boxes[boxNumber].height - Boxes[i].height;
+		}
+		if (Boxes[i].overlapIndex & 0x8000) {
+			NavBlockable[NavBlockableCount] = (UINT16)i;
+			NavBlockFlags[NavBlockableCount] = Boxes[i].overlapIndex & 0x4000;
+			++NavBlockableCount;
+		}
+	}
+	memset(NavStates, NAV_Unvisited, sizeof(BYTE) * BoxesCount);
+	memset(NavNext, 0xFF, sizeof(UINT16) * BoxesCount);
+	for (int i = 0; i < NAV_CACHE_SIZE; ++i) {
+		NavCache[i].nodes = &NavPool[i * BoxesCount];
+	}
+	NavVisitedCount = 0;
+	NavBoxesCount = BoxesCount;
+}
+
+// Returns true if any door or window changed the blocked flag of its box
+// since the last check, so the fields have to be invalidated.
+bool NAV_CheckBlockedBoxes() {
+	bool isChanged = false;
+	for (DWORD i = 0; i < NavBlockableCount; ++i) {
+		UINT16 flags = Boxes[NavBlockable[i]].overlapIndex & 0x4000;
+		if (flags != NavBlockFlags[i]) {
+			NavBlockFlags[i] = flags;
+			isChanged = true;
+		}
+	}
+	return isChanged;
+}
+
+static inline UINT16* NAV_GetZone(const LOT_INFO* LOT) {
+	return LOT->fly == 0 ? GroundZones[(2 * LOT->step >> 8) + FlipStatus] : FlyZones[FlipStatus];
+}
+
+static inline void NAV_Visit(UINT16 boxNumber) {
+	if (NavStates[boxNumber] == NAV_Unvisited) {
+		NavVisited[NavVisitedCount++] = boxNumber;
+	}
+}
+
+// Starts the flood of the scratch data from the target box like UpdateLOT
+// does for a LOT with the empty expansion queue
+static void NAV_StartBuild(const LOT_INFO* LOT) {
+	NAV_ResetScratch();
+	NavBuild.isActive = true;
+	NavBuild.targetBox = LOT->targetBox;
+	NavBuild.blockMask = LOT->blockMask;
+	NavBuild.step = LOT->step;
+	NavBuild.drop = LOT->drop;
+	NavBuild.fly = LOT->fly;
+	NavBuild.flip = FlipStatus;
+	NavBuild.head = LOT->targetBox;
+	NavBuild.tail = LOT->targetBox;
+	NavBuild.zone = NAV_GetZone(LOT);
+	NAV_Visit(LOT->targetBox);
+	NavStates[LOT->targetBox] = NAV_Reached;
+	NavExits[LOT->targetBox] = NAV_NONE;
+}
+
+// Continues the pending flood like SearchLOT does, but with the precomputed
+// edges. Returns the number of box expansions spent.
+static int NAV_Flood(int budget) {
+	UINT16* zone = NavBuild.zone;
+	UINT16 head = NavBuild.head;
+	UINT16 tail = NavBuild.tail;
+	int expansions = 0;
+
+	while (head != NAV_NONE && expansions < budget) {
+		BYTE state = NavStates[head];
+		++expansions;
+		for (DWORD i = NavOffsets[head]; i < NavOffsets[head + 1]; ++i) {
+			UINT16 boxNumber = NavEdges[i];
+			if (zone[head] != zone[boxNumber])
+				continue;
+			if (NavRises[i] > NavBuild.step || NavRises[i] < NavBuild.drop)
+				continue;
+
+			if (state == NAV_Blocked) {
+				if (NavStates[boxNumber] != NAV_Unvisited)
+					continue;
+				NAV_Visit(boxNumber);
+				NavStates[boxNumber] = NAV_Blocked;
+			} else {
+				if (NavStates[boxNumber] == NAV_Reached)
+					continue;
+				NAV_Visit(boxNumber);
+				if (Boxes[boxNumber].overlapIndex & NavBuild.blockMask) {
+					NavStates[boxNumber] = NAV_Blocked;
+				} else {
+					NavStates[boxNumber] = NAV_Reached;
+					NavExits[boxNumber] = head;
+				}
+			}
+
+			if (NavNext[boxNumber] == NAV_NONE && boxNumber != tail) {
+				NavNext[tail] = boxNumber;
+				tail = boxNumber;
+			}
+		}
+		UINT16 next = NavNext[head];
+		NavNext[head] = NAV_NONE;
+		head = next;
+	}
+	NavBuild.head = head;
+	NavBuild.tail = tail;
+	return expansions;
+}
+
+static NAV_FIELD* NAV_FindField(const LOT_INFO* LOT, UINT16 targetBox) {
+	for (int i = 0; i < NAV_CACHE_SIZE; ++i) {
+		NAV_FIELD* field = &NavCache[i];
+		if (field->count != 0 && field->targetBox == targetBox && field->flip == FlipStatus
+			&& field->step == LOT->step && field->drop == LOT->drop && field->fly == LOT->fly
+			&& field->blockMask == LOT->blockMask)
+		{
+			return field;
+		}
+	}
+	return NULL;
+}
+
+static NAV_FIELD* NAV_StoreField() {
+	NAV_FIELD* field = &NavCache[0];
+	for (int i = 1; i < NAV_CACHE_SIZE && field->count != 0; ++i) {
+		if (NavCache[i].count == 0 || NavCache[i].lastUse < field->lastUse) {
+			field = &NavCache[i];
+		}
+	}
+	for (DWORD i = 0; i < NavVisitedCount; ++i) {
+		UINT16 boxNumber = NavVisited[i];
+		NAV_NODE* node = &field->nodes[i];
+		node->boxNumber = boxNumber;
+		node->exitBox = NavExits[boxNumber];
+		if (NavStates[boxNumber] == NAV_Blocked) {
+			node->boxNumber |= NAV_BLOCKED;
+		}
+	}
+	field->count = NavVisitedCount;
+	field->lastUse = ++NavUseCounter;
+	field->targetBox = NavBuild.targetBox;
+	field->blockMask = NavBuild.blockMask;
+	field->step = NavBuild.step;
+	field->drop = NavBuild.drop;
+	field->fly = NavBuild.fly;
+	field->flip = NavBuild.flip;
+	return field;
+}
+
+static void NAV_CopyField(LOT_INFO* LOT, const NAV_FIELD* field) {
+	// the copied search is finished, so the expansion queue is dropped
+	for (UINT16 boxNumber = LOT->head; boxNumber != NAV_NONE; ) {
+		BOX_NODE* node = &LOT->node[boxNumber];
+		boxNumber = node->nextExpansion;
+		node->nextExpansion = NAV_NONE;
+	}
+	LOT->head = NAV_NONE;
+	LOT->tail = NAV_NONE;
+
+	for (DWORD i = 0; i < field->count; ++i) {
+		const NAV_NODE* nav = &field->nodes[i];
+		BOX_NODE* node = &LOT->node[nav->boxNumber & ~NAV_BLOCKED];
+		if (nav->boxNumber & NAV_BLOCKED) {
+			// SearchLOT doesn't change the exit box of the blocked boxes
+			node->searchNumber = LOT->searchNumber | 0x8000;
+		} else {
+			node->searchNumber = LOT->searchNumber;
+			node->exitBox = nav->exitBox;
+		}
+	}
+}
+
+// Advances the pending flood by the budget, and puts the finished field into
+// the cache. Returns the number of box expansions spent.
+int NAV_BuildField(int budget) {
+	if (!NavBuild.isActive || budget <= 0) {
+		return 0;
+	}
+	int expansions = NAV_Flood(budget);
+	if (NavBuild.head == NAV_NONE) {
+		NAV_StoreField();
+		NAV_ResetScratch();
+		NavBuild.isActive = false;
+	}
+	return expansions;
+}
+
+// Puts the field of the LOT target box into the LOT. If there is no such
+// field, its build is started unless another one is pending. Returns false
+// if the LOT has to continue with the incremental search.
+bool NAV_ApplyField(LOT_INFO* LOT) {
+	if (NavBoxesCount == 0 || NavBoxesCount != BoxesCount || LOT->targetBox >= NavBoxesCount) {
+		return false;
+	}
+
+	NAV_FIELD* field = NAV_FindField(LOT, LOT->targetBox);
+	if (field == NULL) {
+		if (!NavBuild.isActive) {
+			NAV_StartBuild(LOT);
+		}
+		return false;
+	}
+	field->lastUse = ++NavUseCounter;
+	NAV_CopyField(LOT, field);
+	return true;
+}
+
+#endif // defined(FEATURE_NAV_GRAPH) && defined(FEATURE_PATH_SCHEDULER)
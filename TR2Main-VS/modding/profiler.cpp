@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/profiler.h"
+#include "game/text.h"
+#include "global/vars.h"
+
+#ifdef FEATURE_FRAME_PACER
+#include "modding/frame_pacer.h"
+#endif // FEATURE_FRAME_PACER
+
+#ifdef FEATURE_PROFILER
+
+// Every frame the timings of all phases are pushed to the ring buffer. There
+// is only one producer (the game thread), so the entry is written before the
+// head index is published, and readers never see a half written entry.
+#define PROF_RING_SIZE (1024)
+#define PROF_OVERLAY_FRAMES (30)
+#define PROF_CSV_NAME "profile.csv"
+#define PROF_JSON_NAME "profile.json"
+
+typedef struct {
+	DWORD frame;
+	float ms[PROF_Count];
+	int counters[PROF_CountersCount];
+} PROF_FRAME;
+
+DWORD ProfilerMode = 0;
+
+static LPCTSTR ProfNames[PROF_Count] = {
+	"control",
+	"bounds",
+	"rooms",
+	"objects",
+	"sort",
+	"raster",
+	"present",
+	"wait",
+};
+
+static LPCTSTR ProfCounterNames[PROF_CountersCount] = {
+	"visibleRooms",
+	"portals",
+	"lateUs",
+	"voices",
+	"virtual",
+	"steals",
+};
+
+static PROF_FRAME ProfRing[PROF_RING_SIZE];
+static volatile LONG ProfRingHead = 0;
+static LONGLONG ProfStart[PROF_Count];
+static LONGLONG ProfAccum[PROF_Count];
+static int ProfCounters[PROF_CountersCount];
+static double ProfPeriodMs = 0.0;
+static TEXT_STR_INFO* ProfText[PROF_Count + 3];
+
+static inline LONGLONG PROF_Counter() {
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+void PROF_BeginPhase(PROF_PHASE phase) {
+	ProfStart[phase] = PROF_Counter();
+}
+
+void PROF_EndPhase(PROF_PHASE phase) {
+	ProfAccum[phase] += PROF_Counter() - ProfStart[phase];
+}
+
+void PROF_SetCounter(PROF_COUNTER counter, int value) {
+	ProfCounters[counter] = value;
+}
+
+static void PROF_UpdateOverlay(LONG head) {
+	char str[64];
+	float avg[PROF_Count + 1] = { 0 };
+	float peak[PROF_Count + 1] = { 0 };
+	int counters[PROF_CountersCount] = { 0 };
+	int count = MIN(head, PROF_OVERLAY_FRAMES);
+
+	if (count <= 0) return;
+	for (int i = 0; i < count; ++i) {
+		PROF_FRAME* frame = &ProfRing[(head - 1 - i) % PROF_RING_SIZE];
+		float total = 0.0;
+		for (int j = 0; j < PROF_Count; ++j) {
+			avg[j] += frame->ms[j];
+			CLAMPL(peak[j], frame->ms[j]);
+			total += frame->ms[j];
+		}
+		avg[PROF_Count] += total;
+		CLAMPL(peak[PROF_Count], total);
+		for (int j = 0; j < PROF_CountersCount; ++j) {
+			counters[j] += frame->counters[j];
+		}
+	}
+	for (int i = 0; i <= PROF_Count; ++i) {
+		snprintf(str, sizeof(str), "%s %.2f/%.2f", (i < PROF_Count) ? ProfNames[i] : "total", avg[i] / count, peak[i]);
+		T_ChangeText(ProfText[i], str);
+	}
+	// average visible rooms, portal tests and frame wait overshoot per frame
+	snprintf(str, sizeof(str), "%s %d %s %d %s %d", ProfCounterNames[PROF_VisibleRooms], counters[PROF_VisibleRooms] / count,
+		ProfCounterNames[PROF_PortalTests], counters[PROF_PortalTests] / count,
+		ProfCounterNames[PROF_WaitLate], counters[PROF_WaitLate] / count);
+	T_ChangeText(ProfText[PROF_Count + 1], str);
+	// average sound voices and total voice steals
+	snprintf(str, sizeof(str), "%s %d %s %d %s %d", ProfCounterNames[PROF_Voices], counters[PROF_Voices] / count,
+		ProfCounterNames[PROF_VirtualVoices], counters[PROF_VirtualVoices] / count,
+		ProfCounterNames[PROF_VoiceSteals], counters[PROF_VoiceSteals]);
+	T_ChangeText(ProfText[PROF_Count + 2], str);
+}
+
+void PROF_EndFrame() {
+	if (!ProfilerMode) return;
+
+	if (ProfPeriodMs == 0.0) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		ProfPeriodMs = 1000.0 / (double)frequency.QuadPart;
+	}
+
+	LONG head = ProfRingHead;
+	PROF_FRAME* frame = &ProfRing[head % PROF_RING_SIZE];
+	frame->frame = head;
+	for (int i = 0; i < PROF_Count; ++i) {
+		frame->ms[i] = (float)(ProfAccum[i] * ProfPeriodMs);
+		ProfAccum[i] = 0;
+	}
+	for (int i = 0; i < PROF_CountersCount; ++i) {
+		frame->counters[i] = ProfCounters[i];
+		ProfCounters[i] = 0;
+	}
+	InterlockedExchange(&ProfRingHead, head + 1);
+
+	if (ProfilerMode > 1 && (head % (PROF_OVERLAY_FRAMES / 2)) == 0) {
+		PROF_UpdateOverlay(head + 1);
+	}
+}
+
+void PROF_LevelStart() {
+	if (!ProfilerMode) return;
+
+	memset(ProfAccum, 0, sizeof(ProfAccum));
+	memset(ProfCounters, 0, sizeof(ProfCounters));
+	InterlockedExchange(&ProfRingHead, 0);
+#ifdef FEATURE_FRAME_PACER
+	PACER_ResetStats();
+#endif // FEATURE_FRAME_PACER
+	if (ProfilerMode > 1) {
+		// average/maximum frame times in milliseconds
+		for (int i = 0; i <= PROF_Count; ++i) {
+			ProfText[i] = T_Print(-8, 40 + i * 12, 0, (i < PROF_Count) ? ProfNames[i] : "total");
+			T_RightAlign(ProfText[i], true);
+			T_SetScale(ProfText[i], PHD_ONE / 2, PHD_ONE / 2);
+		}
+		ProfText[PROF_Count + 1] = T_Print(-8, 40 + (PROF_Count + 1) * 12, 0, ProfCounterNames[PROF_VisibleRooms]);
+		T_RightAlign(ProfText[PROF_Count + 1], true);
+		T_SetScale(ProfText[PROF_Count + 1], PHD_ONE / 2, PHD_ONE / 2);
+		ProfText[PROF_Count + 2] = T_Print(-8, 40 + (PROF_Count + 2) * 12, 0, ProfCounterNames[PROF_Voices]);
+		T_RightAlign(ProfText[PROF_Count + 2], true);
+		T_SetScale(ProfText[PROF_Count + 2], PHD_ONE / 2, PHD_ONE / 2);
+	}
+}
+
+void PROF_LevelEnd() {
+	if (!ProfilerMode) return;
+
+	for (int i = 0; i < PROF_Count + 3; ++i) {
+		if (ProfText[i] != NULL) {
+			T_RemovePrint(ProfText[i]);
+			ProfText[i] = NULL;
+		}
+	}
+	PROF_Dump(PROF_CSV_NAME, PROF_JSON_NAME);
+#ifdef FEATURE_FRAME_PACER
+	PACER_STATS stats;
+	PACER_GetStats(&stats);
+	LogDebug("Frame pacer: %u frames, interval %.3f ms (min %.3f, max %.3f, jitter %.3f), late %.3f ms (max %.3f)",
+		stats.frames, stats.avgMs, stats.minMs, stats.maxMs, stats.jitterMs, stats.avgLateMs, stats.maxLateMs);
+#endif // FEATURE_FRAME_PACER
+}
+
+static bool PROF_WriteText(LPCTSTR path, std::string& text) {
+	DWORD bytesWritten = 0;
+	HANDLE hFile = CreateFile(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		LogWarn("Failed to write the profiler data: %s", path);
+		return false;
+	}
+	WriteFile(hFile, text.c_str(), text.length(), &bytesWritten, NULL);
+	CloseHandle(hFile);
+	return (bytesWritten == text.length());
+}
+
+bool PROF_Dump(LPCTSTR csvPath, LPCTSTR jsonPath) {
+	char str[64];
+	std::string csv, json;
+	LONG head = ProfRingHead;
+	LONG first = MAX(0, head - PROF_RING_SIZE);
+
+	csv = "frame";
+	for (int i = 0; i < PROF_Count; ++i) {
+		csv += ",";
+		csv += ProfNames[i];
+	}
+	for (int i = 0; i < PROF_CountersCount; ++i) {
+		csv += ",";
+		csv += ProfCounterNames[i];
+	}
+	csv += "\r\n";
+	json = "[\r\n";
+
+	for (LONG i = first; i < head; ++i) {
+		PROF_FRAME* frame = &ProfRing[i % PROF_RING_SIZE];
+		snprintf(str, sizeof(str), "%u", frame->frame);
+		csv += str;
+		snprintf(str, sizeof(str), "  {\"frame\": %u", frame->frame);
+		json += str;
+		for (int j = 0; j < PROF_Count; ++j) {
+			snprintf(str, sizeof(str), ",%.3f", frame->ms[j]);
+			csv += str;
+			snprintf(str, sizeof(str), ", \"%s\": %.3f", ProfNames[j], frame->ms[j]);
+			json += str;
+		}
+		for (int j = 0; j < PROF_CountersCount; ++j) {
+			snprintf(str, sizeof(str), ",%d", frame->counters[j]);
+			csv += str;
+			snprintf(str, sizeof(str), ", \"%s\": %d", ProfCounterNames[j], frame->counters[j]);
+			json += str;
+		}
+		csv += "\r\n";
+		json += (i + 1 < head) ? "},\r\n" : "}\r\n";
+	}
+	json += "]\r\n";
+
+	bool result = true;
+	if (csvPath != NULL && !PROF_WriteText(csvPath, csv)) result = false;
+	if (jsonPath != NULL && !PROF_WriteText(jsonPath, json)) result = false;
+	return result;
+}
+#endif // FEATURE_PROFILER
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+
+#include "global/types.h"
+
+typedef enum {
+	PROF_Control,
+	PROF_RoomBounds,
+	PROF_Rooms,
+	PROF_Objects,
+	PROF_Sort,
+	PROF_Raster,
+	PROF_Present,
+	PROF_Wait,
+	PROF_Count,
+} PROF_PHASE;
+
+typedef enum {
+	PROF_VisibleRooms,
+	PROF_PortalTests,
+	PROF_WaitLate,
+	PROF_Voices,
+	PROF_VirtualVoices,
+	PROF_VoiceSteals,
+	PROF_CountersCount,
+} PROF_COUNTER;
+
+#ifdef FEATURE_PROFILER
+// 0 - disabled, 1 - record frames, 2 - record frames and show the overlay
+extern DWORD ProfilerMode;
+
+ /*
+  * Function list
+  */
+void PROF_BeginPhase(PROF_PHASE phase);
+void PROF_EndPhase(PROF_PHASE phase);
+void PROF_SetCounter(PROF_COUNTER counter, int value);
+void PROF_EndFrame();
+void PROF_LevelStart();
+void PROF_LevelEnd();
+bool PROF_Dump(LPCTSTR csvPath, LPCTSTR jsonPath);
+
+// The timers cost just one check when the profiler is disabled
+static inline void PROF_Begin(PROF_PHASE phase) {
+	if (ProfilerMode) PROF_BeginPhase(phase);
+}
+
+static inline void PROF_End(PROF_PHASE phase) {
+	if (ProfilerMode) PROF_EndPhase(phase);
+}
+
+struct PROF_SCOPE {
+	PROF_PHASE phase;
+	PROF_SCOPE(PROF_PHASE id) : phase(id) { PROF_Begin(phase); }
+	~PROF_SCOPE() { PROF_End(phase); }
+};
+
+#define PROF_BEGIN(phase) PROF_Begin(phase)
+#define PROF_END(phase) PROF_End(phase)
+#define PROF_SCOPE_TIMER(phase) PROF_SCOPE profScope##phase(phase)
+#else // FEATURE_PROFILER
+#define PROF_BEGIN(phase)
+#define PROF_END(phase)
+#define PROF_SCOPE_TIMER(phase)
+#endif // FEATURE_PROFILER
+
+#endif // PROFILER_H_INCLUDED
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/thread_utils.h"
+
+// Worker threads are created once and sleep on their start events between jobs.
+// A job is a set of indexed tasks, any thread (including the caller of JOB_Run)
+// takes the next free index until all of them are taken.
+#define MAX_JOB_WORKERS (15)
+
+static HANDLE JobThreads[MAX_JOB_WORKERS];
+static HANDLE JobStartEvents[MAX_JOB_WORKERS];
+static HANDLE JobIdleEvents[MAX_JOB_WORKERS];
+static int JobWorkersCount = 0;
+static volatile bool JobExit = false;
+static bool JobActive = false;
+
+static JOB_TASK JobTask = NULL;
+static LPVOID JobParam = NULL;
+static LONG JobCount = 0;
+static volatile LONG JobNext = 0;
+
+static void JOB_Execute() {
+	LONG index;
+	while ((index = InterlockedIncrement(&JobNext) - 1) < JobCount) {
+		JobTask(index, JobCount, JobParam);
+	}
+}
+
+static DWORD WINAPI JOB_WorkerTask(LPVOID lpParameter) {
+	int id = (int)(INT_PTR)lpParameter;
+	for (;;) {
+		WaitForSingleObject(JobStartEvents[id], INFINITE);
+		if (JobExit) break;
+		JOB_Execute();
+		SetEvent(JobIdleEvents[id]);
+	}
+	return 0;
+}
+
+bool JOB_Init() {
+	if (JobWorkersCount > 0) {
+		return true;
+	}
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	int count = (int)info.dwNumberOfProcessors - 1;
+	CLAMPG(count, MAX_JOB_WORKERS);
+
+	JobExit = false;
+	for (int i = 0; i < count; ++i) {
+		JobStartEvents[i] = CreateEvent(NULL, FALSE, FALSE, NULL);
+		JobIdleEvents[i] = CreateEvent(NULL, TRUE, TRUE, NULL);
+		if (JobStartEvents[i] == NULL || JobIdleEvents[i] == NULL) {
+			if (JobStartEvents[i] != NULL) CloseHandle(JobStartEvents[i]);
+			if (JobIdleEvents[i] != NULL) CloseHandle(JobIdleEvents[i]);
+			break;
+		}
+		JobThreads[i] = CreateThread(NULL, 0, JOB_WorkerTask, (LPVOID)(INT_PTR)i, 0, NULL);
+		if (JobThreads[i] == NULL) {
+			CloseHandle(JobStartEvents[i]);
+			CloseHandle(JobIdleEvents[i]);
+			break;
+		}
+		++JobWorkersCount;
+	}
+	LogDebug("Job system started with %d worker threads", JobWorkersCount);
+	return JobWorkersCount > 0;
+}
+
+void JOB_Cleanup() {
+	JOB_Wait();
+	JobExit = true;
+	for (int i = 0; i < JobWorkersCount; ++i) {
+		SetEvent(JobStartEvents[i]);
+	}
+	for (int i = 0; i < JobWorkersCount; ++i) {
+		WaitForSingleObject(JobThreads[i], INFINITE);
+		CloseHandle(JobThreads[i]);
+		CloseHandle(JobStartEvents[i]);
+		CloseHandle(JobIdleEvents[i]);
+	}
+	JobWorkersCount = 0;
+}
+
+int JOB_GetThreadsCount() {
+	return JobWorkersCount + 1;
+}
+
+void JOB_Start(JOB_TASK task, int count, LPVOID param) {
+	JOB_Wait();
+	if (task == NULL || count <= 0) {
+		return;
+	}
+	JobTask = task;
+	JobParam = param;
+	JobCount = count;
+	JobNext = 0;
+	if (JobWorkersCount == 0) {
+		// No workers, so the job is done right here
+		JOB_Execute();
+		return;
+	}
+	JobActive = true;
+	for (int i = 0; i < JobWorkersCount; ++i) {
+		ResetEvent(JobIdleEvents[i]);
+		SetEvent(JobStartEvents[i]);
+	}
+}
+
+void JOB_Wait() {
+	if (!JobActive) {
+		return;
+	}
+	WaitForMultipleObjects(JobWorkersCount, JobIdleEvents, TRUE, INFINITE);
+	JobActive = false;
+}
+
+void JOB_Run(JOB_TASK task, int count, LPVOID param) {
+	JOB_Start(task, count, param);
+	if (JobActive) {
+		JOB_Execute();
+		JOB_Wait();
+	}
+}
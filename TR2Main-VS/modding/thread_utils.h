@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_UTILS_H_INCLUDED
+#define THREAD_UTILS_H_INCLUDED
+
+#include "global/types.h"
+
+// The task is called once for each index in [0, count)
+typedef void (*JOB_TASK)(int index, int count, LPVOID param);
+
+ /*
+  * Function list
+  */
+bool JOB_Init();
+void JOB_Cleanup();
+int JOB_GetThreadsCount();
+void JOB_Start(JOB_TASK task, int count, LPVOID param);
+void JOB_Wait();
+void JOB_Run(JOB_TASK task, int count, LPVOID param);
+
+#endif // THREAD_UTILS_H_INCLUDED
@@ -21,6 +21,7 @@
 
 #include "precompiled.h"
 #include "specific/file.h"
+#include "3dsystem/3d_gen.h"
 #include "game/invfunc.h"
 #include "game/items.h"
 #include "game/setup.h"
@@ -257,7 +258,7 @@ static void LoadBareFootSFX(int* sampleIndexes, int sampleCount) {
 	LPCTSTR sfxFileName = GetFullPath("data\\barefoot.sfx");
 	if (!PathFileExists(sfxFileName)) return;
 
-	HANDLE hSfxFile = CreateFile(sfxFileName, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	HANDLE hSfxFile = OpenFileSync(sfxFileName);
 	if (hSfxFile == INVALID_HANDLE_VALUE) return;
 
 	int i, j;
@@ -270,7 +271,7 @@ static void LoadBareFootSFX(int* sampleIndexes, int sampleCount) {
 			waveHeader.dwFormat != 0x45564157 || // "WAVE"
 			waveHeader.dwDataSubchunkID != 0x61746164) // "data"
 		{
-			CloseHandle(hSfxFile);
+			CloseFileSync(hSfxFile);
 			return;
 		}
 
@@ -286,7 +287,7 @@ static void LoadBareFootSFX(int* sampleIndexes, int sampleCount) {
 			++i;
 		}
 		else {
-			SetFilePointer(hSfxFile, dataSize, NULL, FILE_CURRENT);
+			SeekFileSync(hSfxFile, dataSize, FILE_CURRENT);
 		}
 	}
 	for (i = 0; i < 4; ++i) { // there are no more than 4 barefoot step samples
@@ -296,7 +297,7 @@ static void LoadBareFootSFX(int* sampleIndexes, int sampleCount) {
 		SampleInfos[i].randomness = 0;
 		SampleInfos[i].flags = 0x6010;
 	}
-	CloseHandle(hSfxFile);
+	CloseFileSync(hSfxFile);
 }
 #endif // FEATURE_MOD_CONFIG
 
@@ -371,7 +372,7 @@ static int CreateBgndPatternTexture(HANDLE hFile) {
 	}
 	DWORD bytesRead;
 	int pageCount = 0;
-	SetFilePointer(hFile, LevelFileTexPagesOffset, NULL, FILE_BEGIN);
+	SeekFileSync(hFile, LevelFileTexPagesOffset, FILE_BEGIN);
 	ReadFileSync(hFile, &pageCount, sizeof(pageCount), &bytesRead, NULL);
 	if (BgndPattern.page >= pageCount) {
 		return -1;
@@ -383,13 +384,13 @@ static int CreateBgndPatternTexture(HANDLE hFile) {
 	DWORD pageSize = (TextureFormat.bpp < 16) ? 256 * 256 * 1 : 256 * 256 * 2;
 	BYTE* bitmap = (BYTE*)GlobalAlloc(GMEM_FIXED, pageSize);
 	if (TextureFormat.bpp < 16) {
-		SetFilePointer(hFile, BgndPattern.page * (256 * 256 * 1), NULL, FILE_CURRENT);
+		SeekFileSync(hFile, BgndPattern.page * (256 * 256 * 1), FILE_CURRENT);
 		ReadFileSync(hFile, bitmap, pageSize, &bytesRead, NULL);
 		pageIndex = MakeCustomTexture(BgndPattern.x, BgndPattern.y, BgndPattern.side, BgndPattern.side,
 			256, BgndPattern.side, 8, bitmap, GamePalette8, PaletteIndex, NULL, false);
 	}
 	else {
-		SetFilePointer(hFile, pageCount * (256 * 256 * 1) + BgndPattern.page * (256 * 256 * 2), NULL, FILE_CURRENT);
+		SeekFileSync(hFile, pageCount * (256 * 256 * 1) + BgndPattern.page * (256 * 256 * 2), FILE_CURRENT);
 		ReadFileSync(hFile, bitmap, pageSize, &bytesRead, NULL);
 		pageIndex = MakeCustomTexture(BgndPattern.x, BgndPattern.y, BgndPattern.side, BgndPattern.side,
 			256, BgndPattern.side, 16, bitmap, NULL, -1, NULL, false);
@@ -408,6 +409,298 @@ static int CreateBgndPatternTexture(HANDLE hFile) {
 
 static GF_LEVEL_TYPE LoadLevelType = GFL_NOLEVEL;
 
+// Big data files are mapped into memory once, so the loaders read them with
+// memcpy from the view instead of doing a syscall for every tiny field.
+// The view is bounds-checked: reading past the end gives zeroes and FALSE.
+#define MAX_FILE_VIEWS (4)
+
+typedef struct {
+	HANDLE hFile;
+	HANDLE hMapping;
+	BYTE* data;
+	DWORD size;
+	DWORD pos;
+} FILE_VIEW;
+
+static FILE_VIEW FileViews[MAX_FILE_VIEWS];
+
+static FILE_VIEW* GetFileView(HANDLE hFile) {
+	for (int i = 0; i < MAX_FILE_VIEWS; ++i) {
+		if (FileViews[i].hFile == hFile && FileViews[i].data != NULL) {
+			return &FileViews[i];
+		}
+	}
+	return NULL;
+}
+
+HANDLE OpenFileSync(LPCTSTR fileName) {
+	HANDLE hFile = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN | FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return INVALID_HANDLE_VALUE;
+	}
+
+	FILE_VIEW* view = NULL;
+	for (int i = 0; i < MAX_FILE_VIEWS && view == NULL; ++i) {
+		if (FileViews[i].data == NULL) view = &FileViews[i];
+	}
+	DWORD size = GetFileSize(hFile, NULL);
+	if (view == NULL || size == 0 || size == INVALID_FILE_SIZE) {
+		return hFile; // fall back to the regular file reading
+	}
+
+	view->hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (view->hMapping != NULL) {
+		view->data = (BYTE*)MapViewOfFile(view->hMapping, FILE_MAP_READ, 0, 0, 0);
+		if (view->data == NULL) {
+			CloseHandle(view->hMapping);
+			view->hMapping = NULL;
+		}
+	}
+	if (view->data != NULL) {
+		view->hFile = hFile;
+		view->size = size;
+		view->pos = 0;
+	}
+	else {
+		LogWarn("Failed to map %s into memory, error %d", fileName, GetLastError());
+	}
+	return hFile;
+}
+
+void CloseFileSync(HANDLE hFile) {
+	FILE_VIEW* view = GetFileView(hFile);
+	if (view != NULL) {
+		UnmapViewOfFile(view->data);
+		CloseHandle(view->hMapping);
+		memset(view, 0, sizeof(FILE_VIEW));
+	}
+	CloseHandle(hFile);
+}
+
+DWORD SeekFileSync(HANDLE hFile, LONG distance, DWORD moveMethod) {
+	FILE_VIEW* view = GetFileView(hFile);
+	if (view == NULL) {
+		return SetFilePointer(hFile, distance, NULL, moveMethod);
+	}
+
+	LONGLONG pos = distance;
+	if (moveMethod == FILE_CURRENT) {
+		pos += view->pos;
+	}
+	else if (moveMethod == FILE_END) {
+		pos += view->size;
+	}
+	CLAMP(pos, 0, (LONGLONG)view->size);
+	view->pos = (DWORD)pos;
+	return view->pos;
+}
+
+// The room parser reads either the level file on the main thread, or the
+// read ahead view on the loader thread. The loader thread allocates from the
+// staging arena, and it must not spin the message loop or set the error text.
+typedef struct {
+	HANDLE hFile;
+	FILE_VIEW* view; // the read ahead view, NULL for the file reading
+	DWORD pos;
+	bool isFailed;
+	bool useNewVersion;
+	int newVersion;
+} LEVEL_READER;
+
+typedef struct {
+	ROOM_INFO* rooms;
+	short roomCount;
+	short* floorData;
+	DWORD maxVertices;
+} LEVEL_ROOMS;
+
+// The rooms parsed by the loader thread into the staging arena
+typedef struct {
+	bool isReady;
+	DWORD startPos;
+	DWORD endPos;
+	bool useNewVersion;
+	int newVersion;
+	LEVEL_ROOMS rooms;
+} STAGED_ROOMS;
+
+static STAGED_ROOMS StagedRooms;
+
+static bool ParseRooms(LEVEL_READER* reader, LEVEL_ROOMS* out);
+
+static void LevelRead(LEVEL_READER* reader, LPVOID buffer, DWORD size) {
+	DWORD bytesRead;
+	if (reader->view == NULL) {
+		ReadFileSync(reader->hFile, buffer, size, &bytesRead, NULL);
+		return;
+	}
+	DWORD count = MIN(size, reader->view->size - reader->pos);
+	memcpy(buffer, reader->view->data + reader->pos, count);
+	reader->pos += count;
+	if (count < size) {
+		memset((BYTE*)buffer + count, 0, size - count);
+		reader->isFailed = true;
+	}
+}
+
+static void* LevelAlloc(LEVEL_READER* reader, DWORD size, DWORD bufIndex) {
+	if (reader->view == NULL) {
+		return game_malloc(size, bufIndex);
+	}
+	void* result = staging_malloc(size);
+	if (result == NULL) {
+		reader->isFailed = true;
+	}
+	return result;
+}
+
+static void LevelSkip(LEVEL_READER* reader, DWORD size) {
+	if (reader->view == NULL) {
+		SeekFileSync(reader->hFile, size, FILE_CURRENT);
+	}
+	else if (size > reader->view->size - reader->pos) {
+		reader->pos = reader->view->size;
+		reader->isFailed = true;
+	}
+	else {
+		reader->pos += size;
+	}
+}
+
+static void LevelError(LEVEL_READER* reader, LPCTSTR message) {
+	if (reader->view == NULL) {
+		lstrcpy(StringToShow, message);
+	}
+	reader->isFailed = true;
+}
+
+// The next level file is mapped and read ahead by a background thread while
+// the level statistics are shown. The thread also parses the rooms into the
+// staging arena, then LoadLevel swaps that arena in and takes the rooms as
+// they are. The rest of the level is still parsed in LoadLevel, since it
+// fills the game globals, the textures and the sound buffers that the main
+// thread owns.
+static HANDLE PreloadThread = NULL;
+static HANDLE PreloadFile = INVALID_HANDLE_VALUE;
+static char PreloadFileName[256];
+static volatile bool PreloadCancel = false;
+static bool PreloadStaging = false;
+
+// Skips the header, the palettes and the texture pages like LoadLevel does,
+// and parses the rooms that follow them
+static void StageRooms(FILE_VIEW* view) {
+	LEVEL_READER reader;
+	BYTE levelVersion[4];
+	DWORD pageCount = 0;
+
+	memset(&reader, 0, sizeof(reader));
+	reader.view = view;
+	LevelRead(&reader, levelVersion, sizeof(levelVersion));
+	if (levelVersion[0] != REQ_LEVEL_VERSION) {
+#if defined(FEATURE_MOD_CONFIG)
+		if (levelVersion[0] != 'T' || levelVersion[1] != 'R' || levelVersion[2] != '2') {
+			return;
+		}
+		reader.useNewVersion = true;
+		reader.newVersion = (int)levelVersion[3];
+#else // FEATURE_MOD_CONFIG
+		return;
+#endif // FEATURE_MOD_CONFIG
+	}
+	LevelSkip(&reader, 256 * sizeof(RGB888) + 256 * sizeof(PALETTEENTRY));
+	LevelRead(&reader, &pageCount, sizeof(pageCount));
+	if (reader.isFailed || pageCount > (view->size - reader.pos) / (256 * 256 * 3)) {
+		return;
+	}
+	LevelSkip(&reader, pageCount * (256 * 256 * 3) + sizeof(DWORD)); // 8 and 16 bit pages, reserved
+
+	DWORD startPos = reader.pos;
+	if (!reader.isFailed && ParseRooms(&reader, &StagedRooms.rooms)) {
+		StagedRooms.startPos = startPos;
+		StagedRooms.endPos = reader.pos;
+		StagedRooms.useNewVersion = reader.useNewVersion;
+		StagedRooms.newVersion = reader.newVersion;
+		StagedRooms.isReady = true;
+	}
+}
+
+static DWORD WINAPI PreloadTask(LPVOID lpParameter) {
+	FILE_VIEW* view = (FILE_VIEW*)lpParameter;
+	DWORD sum = 0;
+	// touch every page, so the system reads the file into memory
+	for (DWORD i = 0; i < view->size && !PreloadCancel; i += 0x1000) {
+		sum += ((volatile BYTE*)view->data)[i];
+	}
+	if (PreloadStaging && !PreloadCancel) {
+		StageRooms(view);
+	}
+	return sum;
+}
+
+static void WaitPreload(bool cancel) {
+	if (PreloadThread != NULL) {
+		PreloadCancel = cancel;
+		WaitForSingleObject(PreloadThread, INFINITE);
+		CloseHandle(PreloadThread);
+		PreloadThread = NULL;
+		PreloadCancel = false;
+	}
+}
+
+static void CancelPreload() {
+	WaitPreload(true);
+	if (PreloadFile != INVALID_HANDLE_VALUE) {
+		CloseFileSync(PreloadFile);
+		PreloadFile = INVALID_HANDLE_VALUE;
+	}
+	*PreloadFileName = 0;
+	StagedRooms.isReady = false;
+}
+
+void S_CancelLevelPreload() {
+	CancelPreload();
+}
+
+// The staged rooms are kept for LoadRooms if the file is the preloaded one
+static HANDLE TakePreloadedFile(LPCTSTR fullPath) {
+	HANDLE hFile = INVALID_HANDLE_VALUE;
+	if (PreloadFile != INVALID_HANDLE_VALUE && !lstrcmpi(PreloadFileName, fullPath)) {
+		WaitPreload(false);
+		hFile = PreloadFile;
+		PreloadFile = INVALID_HANDLE_VALUE;
+		*PreloadFileName = 0;
+		return hFile;
+	}
+	CancelPreload();
+	return hFile;
+}
+
+void S_PreloadLevelFile(LPCTSTR fileName) {
+	LPCTSTR fullPath = GetFullPath(fileName);
+	if (PreloadFile != INVALID_HANDLE_VALUE && !lstrcmpi(PreloadFileName, fullPath)) {
+		return;
+	}
+	CancelPreload();
+
+	HANDLE hFile = OpenFileSync(fullPath);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	FILE_VIEW* view = GetFileView(hFile);
+	if (view == NULL) {
+		CloseFileSync(hFile); // there is nothing to read ahead without the view
+		return;
+	}
+	PreloadFile = hFile;
+	lstrcpyn(PreloadFileName, fullPath, sizeof(PreloadFileName));
+	// the thread owns the staging arena until it's waited for
+	PreloadStaging = init_staging_malloc();
+	PreloadThread = CreateThread(NULL, 0, PreloadTask, view, 0, NULL);
+	if (PreloadThread != NULL) {
+		SetThreadPriority(PreloadThread, THREAD_PRIORITY_BELOW_NORMAL);
+	}
+}
+
 BOOL ReadFileSync(HANDLE hFile, LPVOID lpBuffer, DWORD nBytesToRead, LPDWORD lpnBytesRead, LPOVERLAPPED lpOverlapped) {
 	ReadFileBytesCounter += nBytesToRead;
 
@@ -415,9 +708,29 @@ BOOL ReadFileSync(HANDLE hFile, LPVOID lpBuffer, DWORD nBytesToRead, LPDWORD lpn
 		ReadFileBytesCounter = 0;
 		WinVidSpinMessageLoop(false);
 	}
-	return ReadFile(hFile, lpBuffer, nBytesToRead, lpnBytesRead, lpOverlapped);
+
+	FILE_VIEW* view = GetFileView(hFile);
+	if (view == NULL) {
+		return ReadFile(hFile, lpBuffer, nBytesToRead, lpnBytesRead, lpOverlapped);
+	}
+
+	DWORD count = MIN(nBytesToRead, view->size - view->pos);
+	memcpy(lpBuffer, view->data + view->pos, count);
+	view->pos += count;
+	if (lpnBytesRead != NULL) {
+		*lpnBytesRead = count;
+	}
+	if (count < nBytesToRead) {
+		memset((BYTE*)lpBuffer + count, 0, nBytesToRead - count);
+		LogWarn("ReadFileSync: %d bytes requested past the end of file", nBytesToRead - count);
+		return FALSE;
+	}
+	return TRUE;
 }
 
+// The vertex count of the largest room or mesh, the vertex buffer is sized for it
+static DWORD LevelMaxVertices = 0;
+
 BOOL LoadTexturePages(HANDLE hFile) {
 	int i, pageCount;
 	DWORD bytesRead;
@@ -435,7 +748,7 @@ BOOL LoadTexturePages(HANDLE hFile) {
 			}
 			ReadFileSync(hFile, TexturePageBuffer8[i], 256 * 256 * 1, &bytesRead, NULL);
 		}
-		SetFilePointer(hFile, pageCount * (256 * 256 * 2), NULL, FILE_CURRENT);
+		SeekFileSync(hFile, pageCount * (256 * 256 * 2), FILE_CURRENT);
 	}
 	else {
 		// for hardware renderer do BPP check and load 8 bit or 16 bit texture pages to GLOBAL allocated memory and skip others
@@ -453,12 +766,12 @@ BOOL LoadTexturePages(HANDLE hFile) {
 				ReadFileSync(hFile, texPagePtr, pageSize, &bytesRead, NULL);
 				texPagePtr += pageSize;
 			}
-			SetFilePointer(hFile, pageCount * (256 * 256 * 2), NULL, FILE_CURRENT);
+			SeekFileSync(hFile, pageCount * (256 * 256 * 2), FILE_CURRENT);
 			HWR_LoadTexturePages(pageCount, texPageBuffer, GamePalette8);
 		}
 		else {
 			// skip 8 bit texture pages and load 16 bit texture pages
-			SetFilePointer(hFile, pageCount * (256 * 256 * 1), NULL, FILE_CURRENT);
+			SeekFileSync(hFile, pageCount * (256 * 256 * 1), FILE_CURRENT);
 			for (i = 0; i < pageCount; ++i) {
 				ReadFileSync(hFile, texPagePtr, pageSize, &bytesRead, NULL);
 				texPagePtr += pageSize;
@@ -477,186 +790,223 @@ BOOL LoadTexturePages(HANDLE hFile) {
 	return TRUE;
 }
 
-BOOL LoadRooms(HANDLE hFile) {
-	DWORD bytesRead;
+static bool ParseRooms(LEVEL_READER* reader, LEVEL_ROOMS* out) {
 	DWORD reserved = 0;
 	DWORD dwCount, dwMeshSize = 0;
 	short wCount = 0;
 
+	memset(out, 0, sizeof(LEVEL_ROOMS));
 	// Get number of rooms
-	ReadFileSync(hFile, &RoomCount, sizeof(short), &bytesRead, NULL);
-	if (RoomCount < 0 || RoomCount > 1024) {
-		lstrcpy(StringToShow, "LoadRoom(): Too many rooms");
-		return FALSE;
+	LevelRead(reader, &out->roomCount, sizeof(short));
+	if (out->roomCount < 0 || out->roomCount > 1024) {
+		LevelError(reader, "LoadRoom(): Too many rooms");
+		return false;
 	}
 
 	// Allocate memory for room info
-	Rooms = (ROOM_INFO*)game_malloc(sizeof(ROOM_INFO) * RoomCount, GBUF_RoomInfos);
-	if (Rooms == NULL) {
-		lstrcpy(StringToShow, "LoadRoom(): Could not allocate memory for rooms");
-		return FALSE;
+	out->rooms = (ROOM_INFO*)LevelAlloc(reader, sizeof(ROOM_INFO) * out->roomCount, GBUF_RoomInfos);
+	if (out->rooms == NULL) {
+		LevelError(reader, "LoadRoom(): Could not allocate memory for rooms");
+		return false;
 	}
 
 	// For every room read info
-	for (int i = 0; i < RoomCount; ++i) {
-		ROOM_INFO* room = &Rooms[i];
+	for (int i = 0; i < out->roomCount; ++i) {
+		ROOM_INFO* room = &out->rooms[i];
 
 		// Room position
 		room->index = i;
-		ReadFileSync(hFile, &room->x, sizeof(int), &bytesRead, NULL);
-		ReadFileSync(hFile, &room->z, sizeof(int), &bytesRead, NULL);
+		LevelRead(reader, &room->x, sizeof(int));
+		LevelRead(reader, &room->z, sizeof(int));
 		room->y = 0;
 
 		// Room floor/ceiling
-		ReadFileSync(hFile, &room->minFloor, sizeof(int), &bytesRead, NULL);
-		ReadFileSync(hFile, &room->maxCeiling, sizeof(int), &bytesRead, NULL);
+		LevelRead(reader, &room->minFloor, sizeof(int));
+		LevelRead(reader, &room->maxCeiling, sizeof(int));
 
 		// Room mesh
-		ReadFileSync(hFile, &dwMeshSize, sizeof(DWORD), &bytesRead, NULL); // Dummy size, only used for load it fully on short* data, but that's the old way !
-		room->data = (ROOM_DATA*)game_malloc(sizeof(ROOM_DATA), GBUF_RoomMeshData);
+		LevelRead(reader, &dwMeshSize, sizeof(DWORD)); // Dummy size, only used for load it fully on short* data, but that's the old way !
+		room->data = (ROOM_DATA*)LevelAlloc(reader, sizeof(ROOM_DATA), GBUF_RoomMeshData);
+		if (room->data == NULL) return false;
 		
 		// Room vertices
-		ReadFileSync(hFile, &room->data->vtxSize, sizeof(USHORT), &bytesRead, NULL);
-		room->data->vertices = (ROOM_VERTEX*)game_malloc(sizeof(ROOM_VERTEX) * room->data->vtxSize, GBUF_RoomMeshData);
-		for (int j = 0; j < room->data->vtxSize; j++)
+		LevelRead(reader, &room->data->vtxSize, sizeof(USHORT));
+		CLAMPL(out->maxVertices, room->data->vtxSize);
+		room->data->vertices = (ROOM_VERTEX*)LevelAlloc(reader, sizeof(ROOM_VERTEX) * room->data->vtxSize, GBUF_RoomMeshData);
+		if (room->data->vertices == NULL) return false;
+		// NOTE: the room geometry structures have the same layout as in the file, so they are read at once
+		LevelRead(reader, room->data->vertices, sizeof(ROOM_VERTEX) * room->data->vtxSize);
+#ifdef FEATURE_VERTEX_SIMD
 		{
-			ROOM_VERTEX* vertice = &room->data->vertices[j];
-			ReadFileSync(hFile, &vertice->x, sizeof(short), &bytesRead, NULL); // posX
-			ReadFileSync(hFile, &vertice->y, sizeof(short), &bytesRead, NULL); // posY
-			ReadFileSync(hFile, &vertice->z, sizeof(short), &bytesRead, NULL); // posZ
-			ReadFileSync(hFile, &vertice->lightBase, sizeof(short), &bytesRead, NULL); // lightning1
-			ReadFileSync(hFile, &vertice->lightTableValue, sizeof(BYTE), &bytesRead, NULL); // attributes
-			ReadFileSync(hFile, &vertice->flags, sizeof(BYTE), &bytesRead, NULL); // attributes
-			ReadFileSync(hFile, &vertice->lightAdder, sizeof(short), &bytesRead, NULL); // lighting2
+			// Vertex positions for the batched transform, see calc_room_vertices()
+			DWORD blockSize = (room->data->vtxSize + 3) & ~3;
+			BYTE* soa = (BYTE*)LevelAlloc(reader, sizeof(int) * 3 * blockSize + 12, GBUF_RoomMeshData);
+			if (soa == NULL) return false;
+			room->data->vtxSoA = (int*)(((DWORD)soa + 15) & ~15);
+			for (int j = 0; j < room->data->vtxSize; ++j) {
+				room->data->vtxSoA[j] = room->data->vertices[j].x;
+				room->data->vtxSoA[blockSize + j] = room->data->vertices[j].y;
+				room->data->vtxSoA[blockSize * 2 + j] = room->data->vertices[j].z;
+			}
+			for (DWORD j = room->data->vtxSize; j < blockSize; ++j) {
+				room->data->vtxSoA[j] = room->data->vtxSoA[blockSize + j] = room->data->vtxSoA[blockSize * 2 + j] = 0;
+			}
 		}
+#endif // FEATURE_VERTEX_SIMD
 
 		// Room quads
-		ReadFileSync(hFile, &room->data->gt4Size, sizeof(USHORT), &bytesRead, NULL);
-		room->data->gt4 = (FACE4*)game_malloc(sizeof(FACE4) * room->data->gt4Size, GBUF_RoomMeshData);
-		for (int j = 0; j < room->data->gt4Size; j++)
-		{
-			FACE4* face = &room->data->gt4[j];
-			ReadFileSync(hFile, &face->vertices[0], sizeof(short), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->vertices[1], sizeof(short), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->vertices[2], sizeof(short), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->vertices[3], sizeof(short), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->texture, sizeof(short), &bytesRead, NULL);
-		}
+		LevelRead(reader, &room->data->gt4Size, sizeof(USHORT));
+		room->data->gt4 = (FACE4*)LevelAlloc(reader, sizeof(FACE4) * room->data->gt4Size, GBUF_RoomMeshData);
+		if (room->data->gt4 == NULL) return false;
+		LevelRead(reader, room->data->gt4, sizeof(FACE4) * room->data->gt4Size);
 
 		// Room triangles
-		ReadFileSync(hFile, &room->data->gt3Size, sizeof(USHORT), &bytesRead, NULL);
-		room->data->gt3 = (FACE3*)game_malloc(sizeof(FACE3) * room->data->gt3Size, GBUF_RoomMeshData);
-		for (int j = 0; j < room->data->gt3Size; j++)
-		{
-			FACE3* face = &room->data->gt3[j];
-			ReadFileSync(hFile, &face->vertices[0], sizeof(USHORT), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->vertices[1], sizeof(USHORT), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->vertices[2], sizeof(USHORT), &bytesRead, NULL);
-			ReadFileSync(hFile, &face->texture, sizeof(USHORT), &bytesRead, NULL);
-		}
+		LevelRead(reader, &room->data->gt3Size, sizeof(USHORT));
+		room->data->gt3 = (FACE3*)LevelAlloc(reader, sizeof(FACE3) * room->data->gt3Size, GBUF_RoomMeshData);
+		if (room->data->gt3 == NULL) return false;
+		LevelRead(reader, room->data->gt3, sizeof(FACE3) * room->data->gt3Size);
 
 		// Room sprites
-		ReadFileSync(hFile, &room->data->spriteSize, sizeof(USHORT), &bytesRead, NULL);
-		room->data->sprites = (ROOM_SPRITE*)game_malloc(sizeof(ROOM_SPRITE) * room->data->spriteSize, GBUF_RoomMeshData);
-		for (int j = 0; j < room->data->spriteSize; j++)
-		{
-			ROOM_SPRITE* sprite = &room->data->sprites[j];
-			ReadFileSync(hFile, &sprite->vertex, sizeof(short), &bytesRead, NULL);
-			ReadFileSync(hFile, &sprite->spriteIndex, sizeof(short), &bytesRead, NULL);
-		}
+		LevelRead(reader, &room->data->spriteSize, sizeof(USHORT));
+		room->data->sprites = (ROOM_SPRITE*)LevelAlloc(reader, sizeof(ROOM_SPRITE) * room->data->spriteSize, GBUF_RoomMeshData);
+		if (room->data->sprites == NULL) return false;
+		LevelRead(reader, room->data->sprites, sizeof(ROOM_SPRITE) * room->data->spriteSize);
 
 		// Doors (Portals)
-		ReadFileSync(hFile, &wCount, sizeof(short), &bytesRead, NULL);
+		LevelRead(reader, &wCount, sizeof(short));
 		if (wCount == 0) {
 			room->doors = NULL;
 		}
 		else {
-			room->doors = (DOOR_INFOS*)game_malloc(sizeof(short) + sizeof(DOOR_INFO) * wCount, GBUF_RoomDoor);
+			room->doors = (DOOR_INFOS*)LevelAlloc(reader, sizeof(short) + sizeof(DOOR_INFO) * wCount, GBUF_RoomDoor);
+			if (room->doors == NULL) return false;
 			room->doors->wCount = wCount;
-			ReadFileSync(hFile, &room->doors->door, sizeof(DOOR_INFO) * wCount, &bytesRead, NULL);
+			LevelRead(reader, &room->doors->door, sizeof(DOOR_INFO) * wCount);
 		}
 
 		// Room floor
-		ReadFileSync(hFile, &room->zSize, sizeof(short), &bytesRead, NULL);
-		ReadFileSync(hFile, &room->xSize, sizeof(short), &bytesRead, NULL);
+		LevelRead(reader, &room->zSize, sizeof(short));
+		LevelRead(reader, &room->xSize, sizeof(short));
 		dwCount = room->zSize * room->xSize;
-		room->floor = (FLOOR_INFO*)game_malloc(sizeof(FLOOR_INFO) * dwCount, GBUF_RoomFloor);
-		ReadFileSync(hFile, room->floor, sizeof(FLOOR_INFO) * dwCount, &bytesRead, NULL);
+		room->floor = (FLOOR_INFO*)LevelAlloc(reader, sizeof(FLOOR_INFO) * dwCount, GBUF_RoomFloor);
+		if (room->floor == NULL) return false;
+		LevelRead(reader, room->floor, sizeof(FLOOR_INFO) * dwCount);
 
 		// Room lights
-		ReadFileSync(hFile, &room->ambient, sizeof(short), &bytesRead, NULL);
+		LevelRead(reader, &room->ambient, sizeof(short));
 #if defined(FEATURE_MOD_CONFIG)
-		if (!Mod.useNewVersion)
-			ReadFileSync(hFile, &reserved, sizeof(short), &bytesRead, NULL); // ambient2
+		if (!reader->useNewVersion)
+			LevelRead(reader, &reserved, sizeof(short)); // ambient2
 #endif
-		ReadFileSync(hFile, &room->lightMode, sizeof(short), &bytesRead, NULL);
-		ReadFileSync(hFile, &room->numLights, sizeof(short), &bytesRead, NULL);
+		LevelRead(reader, &room->lightMode, sizeof(short));
+		LevelRead(reader, &room->numLights, sizeof(short));
 
 		if (room->numLights == 0) {
 			room->light = NULL;
 		}
 		else {
-			room->light = (LIGHT_INFO*)game_malloc(sizeof(LIGHT_INFO) * room->numLights, GBUF_RoomLights);
+			room->light = (LIGHT_INFO*)LevelAlloc(reader, sizeof(LIGHT_INFO) * room->numLights, GBUF_RoomLights);
+			if (room->light == NULL) return false;
 			for (int i = 0; i < room->numLights; ++i) {
 				LIGHT_INFO* light = &room->light[i];
-				ReadFileSync(hFile, &light->x, sizeof(int), &bytesRead, NULL);
-				ReadFileSync(hFile, &light->y, sizeof(int), &bytesRead, NULL);
-				ReadFileSync(hFile, &light->z, sizeof(int), &bytesRead, NULL);
+				LevelRead(reader, &light->x, sizeof(int));
+				LevelRead(reader, &light->y, sizeof(int));
+				LevelRead(reader, &light->z, sizeof(int));
 #if defined(FEATURE_MOD_CONFIG)
-				if (Mod.useNewVersion && Mod.newVersion >= 1)
+				if (reader->useNewVersion && reader->newVersion >= 1)
 				{
-					ReadFileSync(hFile, &light->intensity, sizeof(short), &bytesRead, NULL);
-					ReadFileSync(hFile, &light->fallOff, sizeof(int), &bytesRead, NULL);
+					LevelRead(reader, &light->intensity, sizeof(short));
+					LevelRead(reader, &light->fallOff, sizeof(int));
 				}
 				else
 				{
-					ReadFileSync(hFile, &light->intensity, sizeof(short), &bytesRead, NULL);
-					ReadFileSync(hFile, &reserved, sizeof(short), &bytesRead, NULL); // intensity2
-					ReadFileSync(hFile, &light->fallOff, sizeof(int), &bytesRead, NULL);
-					ReadFileSync(hFile, &reserved, sizeof(int), &bytesRead, NULL); // fallOff2
+					LevelRead(reader, &light->intensity, sizeof(short));
+					LevelRead(reader, &reserved, sizeof(short)); // intensity2
+					LevelRead(reader, &light->fallOff, sizeof(int));
+					LevelRead(reader, &reserved, sizeof(int)); // fallOff2
 				}
 #else
-				ReadFileSync(hFile, &light->intensity, sizeof(short), &bytesRead, NULL);
-				ReadFileSync(hFile, &reserved, sizeof(short), &bytesRead, NULL); // intensity2
-				ReadFileSync(hFile, &light->fallOff, sizeof(int), &bytesRead, NULL);
-				ReadFileSync(hFile, &reserved, sizeof(int), &bytesRead, NULL); // fallOff2
+				LevelRead(reader, &light->intensity, sizeof(short));
+				LevelRead(reader, &reserved, sizeof(short)); // intensity2
+				LevelRead(reader, &light->fallOff, sizeof(int));
+				LevelRead(reader, &reserved, sizeof(int)); // fallOff2
 #endif
 			}
 			//ReadFileSync(hFile, room->light, sizeof(LIGHT_INFO) * room->numLights, &bytesRead, NULL);
 		}
 
 		// Static mesh infos
-		ReadFileSync(hFile, &room->numMeshes, sizeof(short), &bytesRead, NULL);
+		LevelRead(reader, &room->numMeshes, sizeof(short));
 		if (room->numMeshes == 0) {
 			room->meshList = NULL;
 		}
 		else {
-			room->meshList = (MESH_INFO*)game_malloc(sizeof(MESH_INFO) * room->numMeshes, GBUF_RoomStaticMeshInfos);
-			ReadFileSync(hFile, room->meshList, sizeof(MESH_INFO) * room->numMeshes, &bytesRead, NULL);
+			room->meshList = (MESH_INFO*)LevelAlloc(reader, sizeof(MESH_INFO) * room->numMeshes, GBUF_RoomStaticMeshInfos);
+			if (room->meshList == NULL) return false;
+			LevelRead(reader, room->meshList, sizeof(MESH_INFO) * room->numMeshes);
 		}
 
 		// Flipped (alternative) room
-		ReadFileSync(hFile, &room->flippedRoom, sizeof(short), &bytesRead, NULL);
-		ReadFileSync(hFile, &room->flags, sizeof(short), &bytesRead, NULL);
+		LevelRead(reader, &room->flippedRoom, sizeof(short));
+		LevelRead(reader, &room->flags, sizeof(short));
 #if defined(FEATURE_MOD_CONFIG)
-		if (Mod.useNewVersion && Mod.newVersion >= 1)
-			ReadFileSync(hFile, &room->reverbType, sizeof(BYTE), &bytesRead, NULL);
+		if (reader->useNewVersion && reader->newVersion >= 1)
+			LevelRead(reader, &room->reverbType, sizeof(BYTE));
 #endif
 
 		// Initialise some variables
+		room->itemNumber = -1;
+		room->fxNumber = -1;
+	}
+
+	// Read floor data
+	LevelRead(reader, &dwCount, sizeof(DWORD));
+	out->floorData = (short*)LevelAlloc(reader, sizeof(short) * dwCount, GBUF_FloorData);
+	if (out->floorData == NULL) return false;
+	LevelRead(reader, out->floorData, sizeof(short) * dwCount);
+	return !reader->isFailed;
+}
+
+BOOL LoadRooms(HANDLE hFile) {
+	LEVEL_ROOMS rooms;
+	DWORD pos = SeekFileSync(hFile, 0, FILE_CURRENT);
+
+	if (StagedRooms.isReady && StagedRooms.startPos == pos
+#if defined(FEATURE_MOD_CONFIG)
+		&& StagedRooms.useNewVersion == Mod.useNewVersion && StagedRooms.newVersion == Mod.newVersion
+#endif // FEATURE_MOD_CONFIG
+		)
+	{
+		// the staging arena is already swapped in by LoadLevel
+		rooms = StagedRooms.rooms;
+		SeekFileSync(hFile, StagedRooms.endPos, FILE_BEGIN);
+	}
+	else {
+		LEVEL_READER reader;
+		memset(&reader, 0, sizeof(reader));
+		reader.hFile = hFile;
+#if defined(FEATURE_MOD_CONFIG)
+		reader.useNewVersion = Mod.useNewVersion;
+		reader.newVersion = Mod.newVersion;
+#endif // FEATURE_MOD_CONFIG
+		if (!ParseRooms(&reader, &rooms)) {
+			return FALSE;
+		}
+	}
+	StagedRooms.isReady = false;
+
+	RoomCount = rooms.roomCount;
+	Rooms = rooms.rooms;
+	FloorData = rooms.floorData;
+	CLAMPL(LevelMaxVertices, rooms.maxVertices);
+	for (int i = 0; i < RoomCount; ++i) {
+		ROOM_INFO* room = &Rooms[i];
 		room->boundActive = 0;
 		room->boundLeft = PhdWinMaxX;
 		room->boundTop = PhdWinMaxY;
 		room->boundRight = 0;
 		room->boundBottom = 0;
-		room->itemNumber = -1;
-		room->fxNumber = -1;
 	}
-
-	// Read floor data
-	ReadFileSync(hFile, &dwCount, sizeof(DWORD), &bytesRead, NULL);
-	FloorData = (short*)game_malloc(sizeof(short) * dwCount, GBUF_FloorData);
-	ReadFileSync(hFile, FloorData, sizeof(short) * dwCount, &bytesRead, NULL);
 	return TRUE;
 }
 
@@ -740,8 +1090,11 @@ BOOL LoadObjects(HANDLE hFile) {
 	ReadFileSync(hFile, MeshPtr, sizeof(short*) * dwCount, &bytesRead, NULL);
 
 	// Remap mesh pointers
-	for (i = 0; i < dwCount; ++i)
+	for (i = 0; i < dwCount; ++i) {
 		MeshPtr[i] = (short*)((DWORD)Meshes + (DWORD)MeshPtr[i]);
+		// the vertex count follows x, y, z and the 32 bit radius
+		CLAMPL(LevelMaxVertices, (DWORD)MAX(MeshPtr[i][5], 0));
+	}
 
 	// Load anims
 	ReadFileSync(hFile, &animCount, sizeof(DWORD), &bytesRead, NULL);
@@ -857,7 +1210,7 @@ BOOL LoadSprites(HANDLE hFile) {
 		}
 		else {
 			objNumber -= ID_NUMBER_OBJECTS;
-			SetFilePointer(hFile, sizeof(short), NULL, FILE_CURRENT); // StaticObjects don't have nMeshes (just one mesh)
+			SeekFileSync(hFile, sizeof(short), FILE_CURRENT); // StaticObjects don't have nMeshes (just one mesh)
 			ReadFileSync(hFile, &StaticObjects[objNumber].meshIndex, sizeof(short), &bytesRead, NULL);
 		}
 	}
@@ -1089,6 +1442,138 @@ void LoadDemoExternal(LPCTSTR levelName) {
 	}
 }
 
+#ifdef FEATURE_SAMPLE_BANK
+// The SFX files are mapped into memory once, and all their RIFF chunks are
+// indexed when a file is used for the first time. The voices play the level
+// samples straight from the mapping, so a level load only picks the indexed
+// samples for its lookup table, without reading or copying the file again.
+// There are two banks at most: main.sfx and maing.sfx for the Gold levels.
+// The mappings are kept until the game exits, as the voices refer to them.
+#define MAX_SAMPLE_BANKS (2)
+
+typedef struct {
+	WAVEFORMATEX format;
+	BYTE* data;
+	DWORD size;
+} SAMPLE_BANK_ENTRY;
+
+typedef struct {
+	char fileName[256];
+	HANDLE hFile;
+	HANDLE hMapping;
+	BYTE* data;
+	DWORD size;
+	std::vector<SAMPLE_BANK_ENTRY> entries;
+} SAMPLE_BANK;
+
+static SAMPLE_BANK SampleBanks[MAX_SAMPLE_BANKS];
+
+static void ReleaseSampleBank(SAMPLE_BANK* bank) {
+	if (bank->data != NULL) {
+		UnmapViewOfFile(bank->data);
+	}
+	if (bank->hMapping != NULL) {
+		CloseHandle(bank->hMapping);
+	}
+	if (bank->hFile != NULL && bank->hFile != INVALID_HANDLE_VALUE) {
+		CloseHandle(bank->hFile);
+	}
+	bank->hFile = NULL;
+	bank->hMapping = NULL;
+	bank->data = NULL;
+	bank->size = 0;
+	bank->entries.clear();
+	*bank->fileName = 0;
+}
+
+static bool IndexSampleBank(SAMPLE_BANK* bank) {
+	WAVEPCM_HEADER waveHeader;
+	DWORD pos = 0;
+
+	while (bank->size - pos >= sizeof(WAVEPCM_HEADER)) {
+		memcpy(&waveHeader, bank->data + pos, sizeof(WAVEPCM_HEADER));
+		if (waveHeader.dwRiffChunkID != 0x46464952 || // "RIFF"
+			waveHeader.dwFormat != 0x45564157 || // "WAVE"
+			waveHeader.dwDataSubchunkID != 0x61746164) // "data"
+		{
+			break;
+		}
+		pos += sizeof(WAVEPCM_HEADER);
+
+		SAMPLE_BANK_ENTRY entry;
+		memcpy(&entry.format, &waveHeader.wFormatTag, sizeof(PCMWAVEFORMAT));
+		entry.format.cbSize = 0;
+		entry.data = bank->data + pos;
+		entry.size = (waveHeader.dwDataSubchunkSize + 1) & ~1; // aligned data size
+		if (entry.size > bank->size - pos) {
+			break;
+		}
+		bank->entries.push_back(entry);
+		pos += entry.size;
+	}
+	return !bank->entries.empty();
+}
+
+static SAMPLE_BANK* GetSampleBank(LPCTSTR fileName) {
+	SAMPLE_BANK* bank = NULL;
+
+	for (int i = 0; i < MAX_SAMPLE_BANKS; ++i) {
+		if (SampleBanks[i].data != NULL && !lstrcmpi(SampleBanks[i].fileName, fileName)) {
+			return &SampleBanks[i];
+		}
+		if (bank == NULL && SampleBanks[i].data == NULL) {
+			bank = &SampleBanks[i];
+		}
+	}
+	if (bank == NULL) {
+		return NULL;
+	}
+
+	bank->hFile = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (bank->hFile == INVALID_HANDLE_VALUE) {
+		ReleaseSampleBank(bank);
+		return NULL;
+	}
+	bank->size = GetFileSize(bank->hFile, NULL);
+	if (bank->size != 0 && bank->size != INVALID_FILE_SIZE) {
+		bank->hMapping = CreateFileMapping(bank->hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (bank->hMapping != NULL) {
+			bank->data = (BYTE*)MapViewOfFile(bank->hMapping, FILE_MAP_READ, 0, 0, 0);
+		}
+	}
+	if (bank->data == NULL || !IndexSampleBank(bank)) {
+		LogWarn("Failed to map the sample bank %s", fileName);
+		ReleaseSampleBank(bank);
+		return NULL;
+	}
+	lstrcpyn(bank->fileName, fileName, sizeof(bank->fileName));
+	return bank;
+}
+
+static bool LoadBankSamples(LPCTSTR fileName, int* sampleIndexes, int sampleCount) {
+	SAMPLE_BANK* bank = GetSampleBank(fileName);
+	if (bank == NULL) {
+		return false;
+	}
+	for (int i = 0; i < sampleCount; ++i) {
+		if (sampleIndexes[i] < 0 || sampleIndexes[i] >= (int)bank->entries.size()) {
+			return false;
+		}
+		SAMPLE_BANK_ENTRY* entry = &bank->entries[sampleIndexes[i]];
+		if (!WinSndMakeSharedSample(i, &entry->format, entry->data, entry->size)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void S_ReleaseSampleBanks() {
+	for (int i = 0; i < MAX_SAMPLE_BANKS; ++i) {
+		ReleaseSampleBank(&SampleBanks[i]);
+	}
+}
+#endif // FEATURE_SAMPLE_BANK
+
 BOOL LoadSamples(HANDLE hFile) {
 	int i, j;
 	DWORD bytesRead;
@@ -1180,7 +1665,18 @@ BOOL LoadSamples(HANDLE hFile) {
 	}
 #endif // FEATURE_GOLD
 	sfxFileName = GetFullPath(sfxFileName);
-	hSfxFile = CreateFile(sfxFileName, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#ifdef FEATURE_SAMPLE_BANK
+	if (LoadBankSamples(sfxFileName, sampleIndexes, sampleCount)) {
+		SoundIsActive = TRUE;
+#if defined(FEATURE_MOD_CONFIG)
+		LoadBareFootSFX(sampleIndexes, sampleCount);
+#endif // FEATURE_MOD_CONFIG
+		return TRUE;
+	}
+	// if the bank is not available, the file is read as usual
+	WinSndFreeAllSamples();
+#endif // FEATURE_SAMPLE_BANK
+	hSfxFile = OpenFileSync(sfxFileName);
 	if (hSfxFile == INVALID_HANDLE_VALUE) {
 		wsprintf(StringToShow, "Could not open MAIN.SFX file");
 		return FALSE;
@@ -1193,7 +1689,7 @@ BOOL LoadSamples(HANDLE hFile) {
 			waveHeader.dwFormat != 0x45564157 || // "WAVE"
 			waveHeader.dwDataSubchunkID != 0x61746164) // "data"
 		{
-			CloseHandle(hSfxFile);
+			CloseFileSync(hSfxFile);
 			return FALSE;
 		}
 
@@ -1205,18 +1701,18 @@ BOOL LoadSamples(HANDLE hFile) {
 			waveData = game_malloc(dataSize, GBUF_Samples);
 			ReadFileSync(hSfxFile, waveData, dataSize, &bytesRead, NULL);
 			if (!WinSndMakeSample(i, waveFormat, waveData, dataSize)) {
-				CloseHandle(hSfxFile);
+				CloseFileSync(hSfxFile);
 				return FALSE;
 			}
 			game_free(dataSize);
 			++i;
 		}
 		else {
-			SetFilePointer(hSfxFile, dataSize, NULL, FILE_CURRENT);
+			SeekFileSync(hSfxFile, dataSize, FILE_CURRENT);
 		}
 	}
 
-	CloseHandle(hSfxFile);
+	CloseFileSync(hSfxFile);
 	SoundIsActive = TRUE;
 
 #if defined(FEATURE_MOD_CONFIG)
@@ -1282,12 +1778,32 @@ BOOL LoadLevel(LPCTSTR fileName, int levelID) {
 	DWORD reserved = 0;
 	DWORD bytesRead;
 	unsigned char levelVersion[4] = {};
+	bool isPreloaded = false;
+	bool isStaged = false;
+	LARGE_INTEGER loadStart, loadEnd, frequency;
 
+	QueryPerformanceCounter(&loadStart);
 	fullPath = GetFullPath(fileName);
 	strcpy(LevelFileName, fullPath);
-	init_game_malloc();
+	hFile = TakePreloadedFile(fullPath);
+	isPreloaded = (hFile != INVALID_HANDLE_VALUE);
+	if (isPreloaded && StagedRooms.isReady) {
+		// the staging arena already has the rooms, the rest is added to it
+		swap_game_malloc();
+		isStaged = true;
+	}
+	else {
+		StagedRooms.isReady = false;
+		init_game_malloc();
+	}
+	LevelMaxVertices = 0;
+#ifdef FEATURE_EXTENDED_LIMITS
+	phd_InitVertexBuffer(0);
+#endif // FEATURE_EXTENDED_LIMITS
 
-	hFile = CreateFile(fullPath, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN | FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		hFile = OpenFileSync(fullPath);
+	}
 	if (hFile == INVALID_HANDLE_VALUE) {
 		wsprintf(StringToShow, "LoadLevel(): Could not open %s (level %d)", fullPath, levelID);
 		return FALSE;
@@ -1329,12 +1845,12 @@ BOOL LoadLevel(LPCTSTR fileName, int levelID) {
 		LoadTexPagesConfiguration(LevelFileName);
 	}
 
-	LevelFilePalettesOffset = SetFilePointer(hFile, 0, NULL, FILE_CURRENT);
+	LevelFilePalettesOffset = SeekFileSync(hFile, 0, FILE_CURRENT);
 	if (!LoadPalettes(hFile)) {
 		goto EXIT;
 	}
 
-	LevelFileTexPagesOffset = SetFilePointer(hFile, 0, NULL, FILE_CURRENT);
+	LevelFileTexPagesOffset = SeekFileSync(hFile, 0, FILE_CURRENT);
 	if (!LoadTexturePages(hFile)) {
 		goto EXIT;
 	}
@@ -1352,7 +1868,7 @@ BOOL LoadLevel(LPCTSTR fileName, int levelID) {
 		goto EXIT;
 	}
 
-	LevelFileDepthQOffset = SetFilePointer(hFile, 0, NULL, FILE_CURRENT);
+	LevelFileDepthQOffset = SeekFileSync(hFile, 0, FILE_CURRENT);
 	if (!LoadDepthQ(hFile) ||
 		!LoadCinematic(hFile) ||
 		!LoadDemo(hFile) ||
@@ -1361,6 +1877,15 @@ BOOL LoadLevel(LPCTSTR fileName, int levelID) {
 		goto EXIT;
 	}
 
+#ifdef FEATURE_EXTENDED_LIMITS
+	phd_InitVertexBuffer(LevelMaxVertices);
+#else // FEATURE_EXTENDED_LIMITS
+	if (LevelMaxVertices > ARRAY_SIZE(PhdVBuf)) {
+		wsprintf(StringToShow, "LoadLevel(): Too many vertices in a room or mesh (%d, the limit is %d)", LevelMaxVertices, ARRAY_SIZE(PhdVBuf));
+		goto EXIT;
+	}
+#endif // FEATURE_EXTENDED_LIMITS
+
 	LoadDemoExternal(fullPath);
 #ifdef FEATURE_VIDEOFX_IMPROVED
 	MarkSemitransObjects();
@@ -1372,7 +1897,14 @@ BOOL LoadLevel(LPCTSTR fileName, int levelID) {
 	result = TRUE;
 
 EXIT:
-	CloseHandle(hFile);
+	CloseFileSync(hFile);
+	StagedRooms.isReady = false;
+	// the load time shows what the read ahead saves
+	QueryPerformanceCounter(&loadEnd);
+	QueryPerformanceFrequency(&frequency);
+	LogDebug("Level %s loaded in %.3f ms (%s)", fileName,
+		(double)(loadEnd.QuadPart - loadStart.QuadPart) * 1000.0 / (double)frequency.QuadPart,
+		isStaged ? "rooms staged" : isPreloaded ? "read ahead" : "no read ahead");
 	return result;
 }
 
@@ -1425,7 +1957,7 @@ BOOL S_ReloadLevelGraphics(BOOL reloadPalettes, BOOL reloadTexPages) {
 	HANDLE hFile;
 
 	if (*LevelFileName) {
-		hFile = CreateFile(LevelFileName, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		hFile = OpenFileSync(LevelFileName);
 		if (hFile == INVALID_HANDLE_VALUE)
 			return FALSE;
 
@@ -1434,23 +1966,23 @@ BOOL S_ReloadLevelGraphics(BOOL reloadPalettes, BOOL reloadTexPages) {
 		}
 
 		if (reloadPalettes && SavedAppSettings.RenderMode == RM_Software) {
-			SetFilePointer(hFile, LevelFilePalettesOffset, NULL, FILE_BEGIN);
+			SeekFileSync(hFile, LevelFilePalettesOffset, FILE_BEGIN);
 			LoadPalettes(hFile);
-			SetFilePointer(hFile, LevelFileDepthQOffset, NULL, FILE_BEGIN);
+			SeekFileSync(hFile, LevelFileDepthQOffset, FILE_BEGIN);
 			LoadDepthQ(hFile);
 		}
 
 		if (reloadTexPages) {
 			if (SavedAppSettings.RenderMode == RM_Hardware)
 				HWR_FreeTexturePages();
-			SetFilePointer(hFile, LevelFileTexPagesOffset, NULL, FILE_BEGIN);
+			SeekFileSync(hFile, LevelFileTexPagesOffset, FILE_BEGIN);
 			LoadTexturePages(hFile);
 
 #if defined(FEATURE_BACKGROUND_IMPROVED)
 			PatternTexPage = CreateBgndPatternTexture(hFile);
 #endif // FEATURE_BACKGROUND_IMPROVED
 		}
-		CloseHandle(hFile);
+		CloseFileSync(hFile);
 	}
 
 	if (reloadPalettes)
@@ -55,4 +55,11 @@ BOOL S_ReloadLevelGraphics(BOOL reloadPalettes, BOOL reloadTexPages); // 0x0044B
 BOOL Read_Strings(DWORD dwCount, char** stringTable, char** stringBuffer, LPDWORD lpBufferSize, HANDLE hFile); // 0x0044B6A0
 BOOL S_LoadGameFlow(LPCTSTR fileName); // 0x0044B770
 
+HANDLE OpenFileSync(LPCTSTR fileName);
+void CloseFileSync(HANDLE hFile);
+DWORD SeekFileSync(HANDLE hFile, LONG distance, DWORD moveMethod);
+void S_PreloadLevelFile(LPCTSTR fileName);
+void S_CancelLevelPreload();
+void S_ReleaseSampleBanks();
+
 #endif // FILE_H_INCLUDED
@@ -24,6 +24,7 @@
 #include "game/camera.h"
 #include "game/control.h"
 #include "game/draw.h"
+#include "game/interp.h"
 #include "game/inventory.h"
 #include "game/invtext.h"
 #include "game/savegame.h"
@@ -41,12 +42,7 @@
 #include "specific/winvid.h"
 #include "specific/texture.h"
 #include "global/vars.h"
-#include <random>
-
-std::random_device rd;  // Seed source (hardware-based if available)
-std::mt19937 gen(rd()); // Mersenne Twister random engine
-std::uniform_int_distribution<> randShort(SHRT_MIN, SHRT_MAX);
-std::uniform_int_distribution<> randInt(INT_MIN, INT_MAX);
+#include "modding/profiler.h"
 
 #ifdef FEATURE_BACKGROUND_IMPROVED
 #include "modding/background_new.h"
@@ -174,6 +170,12 @@ int GameLoop(BOOL demoMode) {
 	OverlayStatus = 1;
 	InitialiseCamera();
 	NoInputCounter = 0;
+#ifdef FEATURE_RENDER_INTERPOLATION
+	INTERP_Reset();
+#endif // FEATURE_RENDER_INTERPOLATION
+#ifdef FEATURE_PROFILER
+	PROF_LevelStart();
+#endif // FEATURE_PROFILER
 
 	result = ControlPhase(1, demoMode);
 	while (result == 0) {
@@ -182,6 +184,9 @@ int GameLoop(BOOL demoMode) {
 	}
 
 	S_SoundStopAllSamples();
+#ifdef FEATURE_PROFILER
+	PROF_LevelEnd();
+#endif // FEATURE_PROFILER
 
 #ifdef FEATURE_BACKGROUND_IMPROVED
 	// this fixes issue when the final "bath" cut scene is cut off
@@ -342,8 +347,16 @@ int GameStats(int levelID) {
 	return 0;
 }
 
+// The control and draw streams are separate linear congruential generators,
+// as in the original game. Only the control stream affects the gameplay,
+// so it stays reproducible (demos, savegames) whatever the frame rate is.
+static inline int NextRandom(int* seed) {
+	*seed = 0x41C64E6D * (*seed) + 0x3039;
+	return *seed;
+}
+
 int GetRandomControl() {
-	return randInt(gen) & SHRT_MAX;
+	return (NextRandom(&RandomControl) >> 10) & SHRT_MAX;
 }
 
 void SeedRandomControl(int seed) {
@@ -351,23 +364,29 @@ void SeedRandomControl(int seed) {
 }
 
 int GetRandomDraw() {
-	return randInt(gen) & SHRT_MAX;
+	return (NextRandom(&RandomDraw) >> 10) & SHRT_MAX;
 	// NOTE: the shift value should be 0x10, but the original game has 10,
 	// it left "as is" to save consistency with the original game.
 }
 
 int GetRandomDrawWithNeg() {
-	return randShort(gen);
+	return (short)(NextRandom(&RandomDraw) >> 10);
 }
 
 int GetRandomDrawWithNegInt() {
-	return randInt(gen);
+	DWORD hi = (DWORD)GetRandomDraw();
+	DWORD mid = (DWORD)GetRandomDraw();
+	DWORD lo = (DWORD)GetRandomDraw();
+	return (int)((hi << 17) | (mid << 2) | (lo & 3));
 }
 
 int GetRandom(int min, int max)
 {
-	std::uniform_int_distribution<> randInt(min, max);
-	return randInt(gen);
+	if (max <= min)
+		return min;
+	DWORD range = (DWORD)(max - min) + 1;
+	DWORD value = ((DWORD)GetRandomDraw() << 15) | (DWORD)GetRandomDraw();
+	return min + (int)(range ? value % range : value);
 }
 
 void SeedRandomDraw(int seed) {
@@ -22,6 +22,7 @@
 #include "precompiled.h"
 #include "specific/init.h"
 #include "3dsystem/phd_math.h"
+#include "specific/file.h"
 #include "specific/game.h"
 #include "specific/winmain.h"
 #include "global/vars.h"
@@ -94,11 +95,24 @@ BOOL S_InitialiseSystem() {
 	return TRUE;
 }
 
+// The staging arena is the second block of the game memory. The level loader
+// thread fills it while the level statistics are shown, then LoadLevel swaps
+// it with the active arena, so the staged data is taken over without a copy.
+static BYTE* StagingMemoryPointer = NULL;
+static BYTE* StagingAllocMemPointer = NULL;
+static DWORD StagingAllocMemUsed = 0;
+static DWORD StagingAllocMemFree = 0;
+
 void ShutdownGame() {
 	if (GameMemoryPointer != NULL) {
 		GlobalFree(GameMemoryPointer);
 		GameMemoryPointer = NULL;
 	}
+	if (StagingMemoryPointer != NULL) {
+		S_CancelLevelPreload(); // the loader thread may still fill the staging arena
+		GlobalFree(StagingMemoryPointer);
+		StagingMemoryPointer = NULL;
+	}
 }
 
 void init_game_malloc() {
@@ -129,6 +143,53 @@ void game_free(DWORD freeSize) {
 	GameAllocMemUsed -= alignedSize;
 }
 
+// The staging block is allocated on the first use. Returns false if there is
+// no memory for it, then the level is loaded the usual way.
+bool init_staging_malloc() {
+	if (StagingMemoryPointer == NULL) {
+		StagingMemoryPointer = (BYTE*)GlobalAlloc(GMEM_FIXED, GameMemorySize);
+		if (StagingMemoryPointer == NULL) {
+			return false;
+		}
+	}
+	StagingAllocMemPointer = StagingMemoryPointer;
+	StagingAllocMemFree = GameMemorySize;
+	StagingAllocMemUsed = 0;
+	return true;
+}
+
+// Unlike game_malloc, it returns NULL if the arena is full, and the loader
+// thread just gives the staging up
+void* staging_malloc(DWORD allocSize) {
+	DWORD alignedSize = (allocSize + 3) & ~3;
+	if (allocSize > StagingAllocMemFree || alignedSize > StagingAllocMemFree) {
+		return NULL;
+	}
+	void* result = StagingAllocMemPointer;
+	StagingAllocMemFree -= alignedSize;
+	StagingAllocMemUsed += alignedSize;
+	StagingAllocMemPointer += alignedSize;
+	return result;
+}
+
+// The staged arena becomes the active one with its allocations, and the
+// previous active arena is free for the next staging
+void swap_game_malloc() {
+	BYTE* memoryPointer = GameMemoryPointer;
+	BYTE* allocMemPointer = GameAllocMemPointer;
+	DWORD allocMemUsed = GameAllocMemUsed;
+	DWORD allocMemFree = GameAllocMemFree;
+
+	GameMemoryPointer = StagingMemoryPointer;
+	GameAllocMemPointer = StagingAllocMemPointer;
+	GameAllocMemUsed = StagingAllocMemUsed;
+	GameAllocMemFree = StagingAllocMemFree;
+	StagingMemoryPointer = memoryPointer;
+	StagingAllocMemPointer = allocMemPointer;
+	StagingAllocMemUsed = allocMemUsed;
+	StagingAllocMemFree = allocMemFree;
+}
+
 void CalculateWibbleTable() {
 	// This function calculates water effect tables
 	for (int i = 0; i < WIBBLE_SIZE; ++i) {
@@ -32,6 +32,9 @@ void ShutdownGame(); // 0x0044D730
 void init_game_malloc(); // 0x0044D750
 void* game_malloc(DWORD allocSize, DWORD bufIndex); // 0x0044D780
 void game_free(DWORD freeSize); // 0x0044D800
+bool init_staging_malloc();
+void* staging_malloc(DWORD allocSize);
+void swap_game_malloc();
 void CalculateWibbleTable(); // 0x0044D840
 void S_SeedRandom(); // 0x0044D930
 
@@ -138,6 +138,7 @@ static int CreateCaptureBuffer() {
 
 void CreateRenderBuffer() {
 	SWRBufferFree(&RenderBuffer);
+	FreePaletteStaging();
 	if (!SWRBufferCreate(&RenderBuffer, GameVidWidth, GameVidHeight))
 		throw ERR_CreateRenderBuffer;
 }
@@ -277,6 +278,7 @@ void RenderFinish(bool needToClearTextures) {
 	CleanupTextures();
 	SWRBufferFree(&PictureBuffer);
 	SWRBufferFree(&RenderBuffer);
+	FreePaletteStaging();
 	FreeCaptureBuffer();
 	Direct3DRelease();
 }
@@ -53,6 +53,12 @@ bool WinSndMakeSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data,
 	return DXCreateSample(sampleIdx, format, data, dataSize);
 }
 
+#ifdef FEATURE_SAMPLE_BANK
+bool WinSndMakeSharedSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, DWORD dataSize) {
+	return DXCreateSharedSample(sampleIdx, format, data, dataSize);
+}
+#endif // FEATURE_SAMPLE_BANK
+
 bool WinSndIsChannelPlaying(DWORD channel) {
 	return DSIsChannelPlaying(channel);
 }
@@ -32,6 +32,9 @@
 SOUND_ADAPTER_NODE* GetSoundAdapter(GUID* lpGuid); // 0x00447C70
 void WinSndFreeAllSamples(); // 0x00447CC0
 bool WinSndMakeSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, DWORD dataSize); // 0x00447CF0
+#ifdef FEATURE_SAMPLE_BANK
+bool WinSndMakeSharedSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, DWORD dataSize); // NOTE: this function is not presented in the original game
+#endif // FEATURE_SAMPLE_BANK
 bool WinSndIsChannelPlaying(DWORD channel); // 0x00447E00
 int WinSndPlaySample(DWORD sampleIdx, int volume, DWORD pitch, int pan, DWORD flags); // 0x00447E50
 int WinSndGetFreeChannelIndex(); // 0x00447F40
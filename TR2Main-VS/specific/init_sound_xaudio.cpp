@@ -3,6 +3,14 @@
 #include "global/types.h"
 #include "global/vars.h"
 
+#ifdef FEATURE_VOICE_MANAGER
+#include "game/voice.h"
+#endif // FEATURE_VOICE_MANAGER
+
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+#include "modding/mixer.h"
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+
 #define XAUDIO2_HELPER_FUNCTIONS
 #pragma comment(lib, "xaudio2")
 #include <xaudio2.h>
@@ -20,6 +28,9 @@ static IUnknown* XA_ReverbEffect = NULL;
 static IXAudio2SourceVoice* XA_Voices[32] = {}; // Channels
 static IXAudio2SubmixVoice* XA_SoundFXVoice = NULL;
 static XAUDIO2_BUFFER XA_Buffers[370] = { NULL }; // Loaded samples.
+#ifdef FEATURE_SAMPLE_BANK
+static bool XA_SharedBuffers[370] = {}; // The sample data belongs to the sample bank.
+#endif // FEATURE_SAMPLE_BANK
 static ReverbInfo XA_ReverbPreset[REVERB_MAX] = {
 	{XAUDIO2FX_I3DL2_PRESET_DEFAULT, 0.0F},
 	{XAUDIO2FX_I3DL2_PRESET_GENERIC, 5.0F},
@@ -55,6 +66,249 @@ static WAVEFORMATEX XA_PCMFormat;
 static AUDIO_REVERB_TYPE XA_CurrentReverb = REVERB_NONE;
 static AUDIO_REVERB_TYPE XA_ForcedReverb = REVERB_NONE;
 
+static void XA_GetPanMatrix(int pan, float* matrix)
+{
+	if (pan < 0)
+	{
+		if (pan < -0x4000)
+			pan = -0x4000 - pan;
+	}
+	else if (pan > 0 && pan > 0x4000)
+	{
+		pan = 0x8000 - pan;
+	}
+
+	pan >>= 4;
+	if (pan == 0)
+	{
+		matrix[0] = 1.0F;
+		matrix[1] = 1.0F;
+	}
+	else if (pan < 0)
+	{
+		matrix[0] = 1.0F;
+		matrix[1] = XAudio2DecibelsToAmplitudeRatio(pan / 100.0F);
+	}
+	else
+	{
+		matrix[0] = XAudio2DecibelsToAmplitudeRatio(-pan / 100.0F);
+		matrix[1] = 1.0F;
+	}
+}
+
+#ifdef FEATURE_VOICE_MANAGER
+static bool XA_VoiceStart(int channel, int sample, int volume, int pitch, int pan, bool looped)
+{
+	return DXStartSampleOnChannel(channel, sample, CalcVolume(volume), pitch, pan, looped ? XAUDIO2_LOOP_INFINITE : 0);
+}
+
+static void XA_VoiceStop(int channel)
+{
+	DXStopSample(channel);
+}
+
+static bool XA_VoiceIsPlaying(int channel)
+{
+	return DSIsChannelPlaying(channel);
+}
+
+static void XA_VoiceUpdate(int channel, int volume, int pitch, int pan)
+{
+	S_SoundSetPanAndVolume(channel, pan, volume);
+	S_SoundSetPitch(channel, pitch);
+}
+
+static const VOICE_BACKEND XA_VoiceBackend = {
+	_countof(XA_Voices),
+	XA_VoiceStart,
+	XA_VoiceStop,
+	XA_VoiceIsPlaying,
+	XA_VoiceUpdate,
+	NULL,
+};
+#endif // FEATURE_VOICE_MANAGER
+
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+// The mixer renders all the sound effects into one stereo stream on its own
+// thread. The thread keeps XA_MIXER_BUFFERS buffers queued and wakes up when
+// the voice ends one of them.
+#define XA_MIXER_RATE (22050)
+#define XA_MIXER_FRAMES (512)
+#define XA_MIXER_BUFFERS (3)
+
+DWORD MixerMode = 0;
+
+struct XA_MixerCallback : public IXAudio2VoiceCallback
+{
+	HANDLE event = NULL;
+	void STDMETHODCALLTYPE OnBufferEnd(void* context) override { SetEvent(event); }
+	void STDMETHODCALLTYPE OnBufferStart(void* context) override {}
+	void STDMETHODCALLTYPE OnLoopEnd(void* context) override {}
+	void STDMETHODCALLTYPE OnStreamEnd() override {}
+	void STDMETHODCALLTYPE OnVoiceError(void* context, HRESULT error) override {}
+	void STDMETHODCALLTYPE OnVoiceProcessingPassEnd() override {}
+	void STDMETHODCALLTYPE OnVoiceProcessingPassStart(UINT32 bytesRequired) override {}
+};
+
+static IXAudio2SourceVoice* XA_MixerVoice = NULL;
+static XA_MixerCallback XA_MixerNotify;
+static HANDLE XA_MixerThread = NULL;
+static volatile LONG XA_MixerQuit = 0;
+static short XA_MixerData[XA_MIXER_BUFFERS][XA_MIXER_FRAMES * 2];
+
+static DWORD WINAPI XA_MixerProc(LPVOID param)
+{
+	DWORD next = 0;
+	while (!XA_MixerQuit)
+	{
+		XAUDIO2_VOICE_STATE state;
+		XA_MixerVoice->GetState(&state, XAUDIO2_VOICE_NOSAMPLESPLAYED);
+		// the oldest buffer is always the one to fill, the voice plays them in order
+		for (; state.BuffersQueued < XA_MIXER_BUFFERS; ++state.BuffersQueued)
+		{
+			XAUDIO2_BUFFER buffer = {};
+			MIXER_Render(XA_MixerData[next], XA_MIXER_FRAMES);
+			buffer.AudioBytes = sizeof(XA_MixerData[next]);
+			buffer.pAudioData = (const BYTE*)XA_MixerData[next];
+			XA_MixerVoice->SubmitSourceBuffer(&buffer);
+			next = (next + 1) % XA_MIXER_BUFFERS;
+		}
+		WaitForSingleObject(XA_MixerNotify.event, 100);
+	}
+	return 0;
+}
+
+static void XA_StopMixer()
+{
+	if (XA_MixerThread != NULL)
+	{
+		InterlockedExchange(&XA_MixerQuit, 1);
+		SetEvent(XA_MixerNotify.event);
+		WaitForSingleObject(XA_MixerThread, INFINITE);
+		CloseHandle(XA_MixerThread);
+		XA_MixerThread = NULL;
+	}
+	if (XA_MixerVoice != NULL)
+	{
+		XA_MixerVoice->Stop(0, XAUDIO2_COMMIT_NOW);
+		XA_MixerVoice->DestroyVoice();
+		XA_MixerVoice = NULL;
+	}
+	if (XA_MixerNotify.event != NULL)
+	{
+		CloseHandle(XA_MixerNotify.event);
+		XA_MixerNotify.event = NULL;
+	}
+}
+
+static bool XA_StartMixer(bool cubic)
+{
+	WAVEFORMATEX format = {};
+	format.wFormatTag = WAVE_FORMAT_PCM;
+	format.nChannels = 2;
+	format.nSamplesPerSec = XA_MIXER_RATE;
+	format.nAvgBytesPerSec = XA_MIXER_RATE * 4;
+	format.nBlockAlign = 4;
+	format.wBitsPerSample = 16;
+
+	MIXER_Init(XA_MIXER_RATE, cubic);
+	XA_MixerNotify.event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if (XA_MixerNotify.event == NULL
+		|| FAILED(XA_Engine->CreateSourceVoice(&XA_MixerVoice, &format, 0, XAUDIO2_DEFAULT_FREQ_RATIO, &XA_MixerNotify)))
+	{
+		LogWarn("Failed to create the mixer voice, using the XAudio voices...");
+		XA_StopMixer();
+		return false;
+	}
+
+	InterlockedExchange(&XA_MixerQuit, 0);
+	XA_MixerThread = CreateThread(NULL, 0, XA_MixerProc, NULL, 0, NULL);
+	if (XA_MixerThread == NULL)
+	{
+		LogWarn("Failed to create the mixer thread, using the XAudio voices...");
+		XA_StopMixer();
+		return false;
+	}
+	SetThreadPriority(XA_MixerThread, THREAD_PRIORITY_ABOVE_NORMAL);
+	XA_MixerVoice->Start(0, XAUDIO2_COMMIT_NOW);
+	return true;
+}
+
+// Waits until the mixer takes all the commands, so it doesn't use the sample
+// data anymore after MIXER_StopAll. The mixer thread drains the queue on every
+// render, so there is no timeout: the sample data must not be freed before.
+static void XA_SyncMixer()
+{
+	while (XA_MixerThread != NULL && !MIXER_IsIdle())
+		Sleep(1);
+}
+
+static void XA_SetMixerReverb(AUDIO_REVERB_TYPE reverb)
+{
+	if (XA_MixerVoice == NULL)
+		return;
+	if (reverb <= REVERB_NONE || reverb >= REVERB_MAX)
+		MIXER_SetReverb(0.0F, 0.0F);
+	else
+		MIXER_SetReverb(XA_ReverbPreset[reverb].Parameters.DecayTime, XAudio2DecibelsToAmplitudeRatio(XA_ReverbPreset[reverb].Parameters.Room / 100.0F));
+}
+
+static void XA_GetMixerGains(int volume, int pan, float* left, float* right)
+{
+	float matrix[2];
+	float gain = XAudio2DecibelsToAmplitudeRatio(CalcVolume(volume) / 100.0F);
+	XA_GetPanMatrix(pan, matrix);
+	*left = gain * matrix[0];
+	*right = gain * matrix[1];
+}
+
+static bool XA_MixerStart(int channel, int sample, int volume, int pitch, int pan, bool looped)
+{
+	float left, right;
+	if (sample < 0 || sample >= _countof(XA_Buffers) || XA_Buffers[sample].pAudioData == NULL)
+		return false;
+	XA_GetMixerGains(volume, pan, &left, &right);
+	return MIXER_Start(channel, (const short*)XA_Buffers[sample].pAudioData, XA_Buffers[sample].AudioBytes / sizeof(short), pitch, left, right, looped);
+}
+
+// A dropped stop command would leave a looped voice playing forever, so the
+// push is retried like for XA_MixerStopAll.
+static void XA_MixerStop(int channel)
+{
+	while (!MIXER_Stop(channel) && XA_MixerThread != NULL)
+		Sleep(1);
+}
+
+static bool XA_MixerIsPlaying(int channel)
+{
+	return MIXER_IsPlaying(channel);
+}
+
+static void XA_MixerUpdate(int channel, int volume, int pitch, int pan)
+{
+	float left, right;
+	XA_GetMixerGains(volume, pan, &left, &right);
+	MIXER_Update(channel, pitch, left, right);
+}
+
+// One command stops all the voices. It must not be dropped, so the push is
+// retried until the mixer thread frees some room in the queue.
+static void XA_MixerStopAll()
+{
+	while (!MIXER_StopAll() && XA_MixerThread != NULL)
+		Sleep(1);
+}
+
+static const VOICE_BACKEND XA_MixerBackend = {
+	MIXER_MAX_VOICES,
+	XA_MixerStart,
+	XA_MixerStop,
+	XA_MixerIsPlaying,
+	XA_MixerUpdate,
+	XA_MixerStopAll,
+};
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+
 void DSInitialize()
 {
 	CoInitializeEx(NULL, COINIT_MULTITHREADED);
@@ -99,6 +353,9 @@ void DSInitialize()
 
 	IsSoundEnabled = true;
 	S_DisableReverb();
+#ifdef FEATURE_VOICE_MANAGER
+	VOICE_SetBackend(&XA_VoiceBackend);
+#endif // FEATURE_VOICE_MANAGER
 }
 
 void DSRelease()
@@ -106,6 +363,12 @@ void DSRelease()
 	if (!IsSoundEnabled)
 		return;
 
+#ifdef FEATURE_VOICE_MANAGER
+	VOICE_SetBackend(NULL);
+#endif // FEATURE_VOICE_MANAGER
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+	XA_StopMixer();
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
 	for (int i = 0; i < _countof(XA_Voices); i++)
 	{
 		if (XA_Voices[i] != NULL)
@@ -170,33 +433,7 @@ void DSAdjustPan(DWORD channel, int pan)
 
 	if (XA_Voices[channel] != NULL)
 	{
-		if (pan < 0)
-		{
-			if (pan < -0x4000)
-				pan = -0x4000 - pan;
-		}
-		else if (pan > 0 && pan > 0x4000)
-		{
-			pan = 0x8000 - pan;
-		}
-
-		pan >>= 4;
-		if (pan == 0)
-		{
-			matrix[0] = 1.0F;
-			matrix[1] = 1.0F;
-		}
-		else if (pan < 0)
-		{
-			matrix[0] = 1.0F;
-			matrix[1] = XAudio2DecibelsToAmplitudeRatio(pan / 100.0F);
-		}
-		else
-		{
-			matrix[0] = XAudio2DecibelsToAmplitudeRatio(-pan / 100.0F);
-			matrix[1] = 1.0F;
-		}
-
+		XA_GetPanMatrix(pan, matrix);
 		XA_Voices[channel]->SetOutputMatrix(0, 1, 2, matrix, XAUDIO2_COMMIT_NOW);
 	}
 }
@@ -232,6 +469,11 @@ bool DXCreateSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, D
 	if (format->nSamplesPerSec != 11025)
 		LogWarn("Incorrect SamplesPerSec for SampleID: %d, Found: %d", sampleIdx, format->nSamplesPerSec);
 	auto* buffer = &XA_Buffers[sampleIdx];
+#ifdef FEATURE_SAMPLE_BANK
+	if (buffer->pAudioData != NULL && !XA_SharedBuffers[sampleIdx])
+		free((void*)buffer->pAudioData);
+	XA_SharedBuffers[sampleIdx] = false;
+#endif // FEATURE_SAMPLE_BANK
 	buffer->pAudioData = (BYTE*)malloc(dataSize);
 	if (buffer->pAudioData == NULL)
 		return false;
@@ -240,6 +482,23 @@ bool DXCreateSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, D
 	return 1;
 }
 
+#ifdef FEATURE_SAMPLE_BANK
+// The data is not copied, so it must stay valid until DXFreeSounds is called.
+bool DXCreateSharedSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, DWORD dataSize)
+{
+	if (DSound == NULL) return 0;
+	if (format->nSamplesPerSec != 11025)
+		LogWarn("Incorrect SamplesPerSec for SampleID: %d, Found: %d", sampleIdx, format->nSamplesPerSec);
+	auto* buffer = &XA_Buffers[sampleIdx];
+	if (buffer->pAudioData != NULL && !XA_SharedBuffers[sampleIdx])
+		free((void*)buffer->pAudioData);
+	buffer->pAudioData = (const BYTE*)data;
+	buffer->AudioBytes = dataSize;
+	XA_SharedBuffers[sampleIdx] = true;
+	return 1;
+}
+#endif // FEATURE_SAMPLE_BANK
+
 int DSGetFreeChannel()
 {
 	for (int i = 0; i < _countof(XA_Voices); i++)
@@ -250,12 +509,10 @@ int DSGetFreeChannel()
 	return -1;
 }
 
-int DXStartSample(DWORD sampleIdx, int volume, int pitch, int pan, DWORD flags)
+bool DXStartSampleOnChannel(DWORD channel, DWORD sampleIdx, int volume, int pitch, int pan, DWORD flags)
 {
-	int channel = DSGetFreeChannel();
-	if (channel < 0)
-		return -1;
-	auto& voice = XA_Voices[channel];
+	if (channel >= _countof(XA_Voices) || XA_Voices[channel] == NULL)
+		return false;
 	DSAdjustVolume(channel, volume);
 	DSAdjustPitch(channel, pitch);
 	DSAdjustPan(channel, pan);
@@ -263,6 +520,14 @@ int DXStartSample(DWORD sampleIdx, int volume, int pitch, int pan, DWORD flags)
 	buffer->LoopCount = flags;
 	XA_Voices[channel]->SubmitSourceBuffer(buffer, 0);
 	XA_Voices[channel]->Start(0, XAUDIO2_COMMIT_NOW);
+	return true;
+}
+
+int DXStartSample(DWORD sampleIdx, int volume, int pitch, int pan, DWORD flags)
+{
+	int channel = DSGetFreeChannel();
+	if (channel < 0 || !DXStartSampleOnChannel(channel, sampleIdx, volume, pitch, pan, flags))
+		return -1;
 	return channel;
 }
 
@@ -295,12 +560,25 @@ int S_SoundPlaySampleLooped(DWORD sampleIdx, int volume, int pitch, short pan)
 void DXFreeSounds()
 {
 	S_SoundStopAllSamples();
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+	if (XA_MixerThread != NULL)
+	{
+		VOICE_StopAll();
+		XA_SyncMixer();
+	}
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
 
 	for (int i = 0; i < _countof(XA_Buffers); i++)
 	{
 		if (XA_Buffers[i].pAudioData != NULL)
 		{
+#ifdef FEATURE_SAMPLE_BANK
+			if (!XA_SharedBuffers[i])
+				free((void*)XA_Buffers[i].pAudioData);
+			XA_SharedBuffers[i] = false;
+#else // FEATURE_SAMPLE_BANK
 			free((void*)XA_Buffers[i].pAudioData);
+#endif // FEATURE_SAMPLE_BANK
 			XA_Buffers[i].pAudioData = 0;
 		}
 	}
@@ -326,6 +604,9 @@ void S_DisableReverb()
 {
 	XA_SoundFXVoice->DisableEffect(0, XAUDIO2_COMMIT_NOW);
 	XA_SoundFXVoice->SetVolume(1.0F, XAUDIO2_COMMIT_NOW);
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+	XA_SetMixerReverb(REVERB_NONE);
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
 }
 
 void S_SetReverbType(AUDIO_REVERB_TYPE reverb)
@@ -354,6 +635,30 @@ void S_SetReverbType(AUDIO_REVERB_TYPE reverb)
 			XA_SoundFXVoice->DisableEffect(0, XAUDIO2_COMMIT_NOW);
 			XA_SoundFXVoice->SetVolume(1.0F, XAUDIO2_COMMIT_NOW);
 		}
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+		XA_SetMixerReverb(reverb);
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
 		XA_CurrentReverb = reverb;
 	}
 }
+
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+void S_SoundSetMixerMode(DWORD mode)
+{
+	if (!IsSoundEnabled || XA_Engine == NULL)
+		return;
+
+	VOICE_StopAll();
+	XA_SyncMixer();
+	XA_StopMixer();
+	if (mode != 0 && XA_StartMixer(mode > 1))
+	{
+		VOICE_SetBackend(&XA_MixerBackend);
+		XA_SetMixerReverb(XA_CurrentReverb);
+	}
+	else
+	{
+		VOICE_SetBackend(&XA_VoiceBackend);
+	}
+}
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
@@ -44,6 +44,10 @@ extern bool DSIsChannelPlaying(DWORD channel);
 extern void DXStopSample(DWORD channel);
 extern int DSGetFreeChannel();
 extern bool DXCreateSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, DWORD dataSize);
+#ifdef FEATURE_SAMPLE_BANK
+extern bool DXCreateSharedSample(DWORD sampleIdx, LPWAVEFORMATEX format, const LPVOID data, DWORD dataSize);
+#endif // FEATURE_SAMPLE_BANK
+extern bool DXStartSampleOnChannel(DWORD channel, DWORD sampleIdx, int volume, int pitch, int pan, DWORD flags);
 extern int DXStartSample(DWORD sampleIdx, int volume, int pitch, int pan, DWORD flags);
 extern int CalcVolume(int volume);
 extern void DXFreeSounds();
@@ -57,3 +61,8 @@ extern void S_SoundSetPanAndVolume(DWORD channel, short pan, int volume);
 extern void S_SoundSetPitch(DWORD channel, int pitch);
 extern void S_DisableReverb();
 extern void S_SetReverbType(AUDIO_REVERB_TYPE reverb);
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+// 0 - XAudio voices, 1 - mixer with linear interpolation, 2 - mixer with cubic interpolation
+extern DWORD MixerMode;
+extern void S_SoundSetMixerMode(DWORD mode);
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
@@ -22,6 +22,7 @@
 #include "precompiled.h"
 #include "specific/output.h"
 #include "3dsystem/3d_gen.h"
+#include "3dsystem/3d_out.h"
 #include "3dsystem/phd_math.h"
 #include "game/gameflow.h"
 #include "specific/background.h"
@@ -37,11 +38,19 @@
 #include "specific/utils.h"
 #include "specific/winvid.h"
 #include "global/vars.h"
+#include <immintrin.h>
 
 #if defined(FEATURE_MOD_CONFIG)
 #include "modding/mod_utils.h"
 #endif
 
+#include "modding/profiler.h"
+#include "modding/thread_utils.h"
+
+#ifdef FEATURE_FRAME_PACER
+#include "modding/frame_pacer.h"
+#endif // FEATURE_FRAME_PACER
+
 #if defined(FEATURE_HUD_IMPROVED)
 #include "modding/psx_bar.h"
 
@@ -297,8 +306,19 @@ void S_InitialisePolyList(BOOL clearBackBuffer) {
 }
 
 DWORD S_DumpScreen() {
+	PROF_BEGIN(PROF_Wait);
 	DWORD ticks = SyncTicks(TICKS_PER_FRAME); // NOTE: there was another code in the original game
+	PROF_END(PROF_Wait);
+#if defined(FEATURE_FRAME_PACER) && defined(FEATURE_PROFILER)
+	if (ProfilerMode) {
+		PACER_STATS stats;
+		PACER_GetStats(&stats);
+		PROF_SetCounter(PROF_WaitLate, (int)(stats.lastLateMs * 1000.0));
+	}
+#endif // defined(FEATURE_FRAME_PACER) && defined(FEATURE_PROFILER)
+	PROF_BEGIN(PROF_Present);
 	ScreenPartialDump();
+	PROF_END(PROF_Present);
 	return ticks;
 }
 
@@ -325,12 +345,91 @@ void S_InitialiseScreen(GF_LEVEL_TYPE levelType) {
 	}
 }
 
+typedef struct PaletteConvertParams_t {
+	DWORD lut[256];
+	BYTE* src;
+	BYTE* dst;
+	int dstPitch;
+	DWORD width;
+	DWORD height;
+} PALETTE_CONVERT_PARAMS;
+
+// The surface is converted into while it's busy, then the rows are copied
+static DWORD* PaletteStagingBuffer = NULL;
+static DWORD PaletteStagingSize = 0;
+static const bool PaletteAVX2 = IsAVX2Supported();
+
+static bool PreparePaletteStaging(DWORD width, DWORD height) {
+	DWORD size = width * height;
+	if (PaletteStagingBuffer == NULL || PaletteStagingSize < size) {
+		FreePaletteStaging();
+		PaletteStagingBuffer = (DWORD*)malloc(sizeof(DWORD) * size);
+		PaletteStagingSize = (PaletteStagingBuffer != NULL) ? size : 0;
+	}
+	return PaletteStagingBuffer != NULL;
+}
+
+void FreePaletteStaging() {
+	free(PaletteStagingBuffer);
+	PaletteStagingBuffer = NULL;
+	PaletteStagingSize = 0;
+}
+
+static void BuildPaletteLUT(DWORD* lut) {
+	lut[0] = 0; // the colour key is always black
+	for (int i = 1; i < 256; ++i) {
+		lut[i] = RGB_MAKE(WinVidPalette[i].peRed, WinVidPalette[i].peGreen, WinVidPalette[i].peBlue);
+	}
+}
+
+static int PaletteConvertJobs(DWORD height) {
+	// a few jobs per thread, so the threads that started late are not the bottleneck
+	int jobs = JOB_GetThreadsCount() * 4;
+	CLAMPG(jobs, (int)height);
+	return jobs;
+}
+
+// AVX2 path: 8 palette indices are widened to dwords and looked up by one
+// gather. Without AVX2 there are no gathers, and the lookups are scalar.
+static void ConvertPaletteRowAVX2(const BYTE* src, DWORD* dst, DWORD width, const DWORD* lut) {
+	DWORD j = 0;
+	for (; j + 8 <= width; j += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(src + j)));
+		_mm256_storeu_si256((__m256i*)(dst + j), _mm256_i32gather_epi32((const int*)lut, idx, 4));
+	}
+	for (; j < width; ++j) {
+		dst[j] = lut[src[j]];
+	}
+}
+
+static void ConvertPaletteRows(int index, int count, LPVOID param) {
+	PALETTE_CONVERT_PARAMS* params = (PALETTE_CONVERT_PARAMS*)param;
+	DWORD y0 = params->height * index / count;
+	DWORD y1 = params->height * (index + 1) / count;
+	const DWORD* lut = params->lut;
+
+	for (DWORD i = y0; i < y1; ++i) {
+		BYTE* src = params->src + params->width * i;
+		DWORD* dst = (DWORD*)(params->dst + params->dstPitch * i);
+		if (PaletteAVX2) {
+			ConvertPaletteRowAVX2(src, dst, params->width, lut);
+			continue;
+		}
+		for (DWORD j = 0; j < params->width; ++j) {
+			dst[j] = lut[src[j]];
+		}
+	}
+}
+
 void S_OutputPolyList() {
 	DDSDESC desc;
 
 	if (SavedAppSettings.RenderMode == RM_Software) {
 		// Software renderer
+		PROF_BEGIN(PROF_Sort);
 		phd_SortPolyList();
+		PROF_END(PROF_Sort);
+		PROF_SCOPE_TIMER(PROF_Raster);
 		// prefetch surface lock
 		extern LPDDS CaptureBufferSurface;
 		HRESULT rc = CaptureBufferSurface->LockRect(&desc, NULL, D3DLOCK_DONOTWAIT);
@@ -338,29 +437,36 @@ void S_OutputPolyList() {
 			return;
 		}
 		// do software rendering
-		extern void PrepareSWR(int pitch, int height);
 		PrepareSWR(RenderBuffer.width, RenderBuffer.height);
 		phd_PrintPolyList(RenderBuffer.bitmap);
-		// finish surface lock
-		if (rc == D3DERR_WASSTILLDRAWING && FAILED(CaptureBufferSurface->LockRect(&desc, NULL, 0))) {
-			return;
+		// convert bitmap to 32 bit pixels
+		PALETTE_CONVERT_PARAMS params;
+		params.src = RenderBuffer.bitmap;
+		params.width = RenderBuffer.width;
+		params.height = RenderBuffer.height;
+		BuildPaletteLUT(params.lut);
+		if (rc == D3DERR_WASSTILLDRAWING && PreparePaletteStaging(params.width, params.height)) {
+			// the workers convert into the staging buffer while the lock waits for the surface
+			params.dst = (BYTE*)PaletteStagingBuffer;
+			params.dstPitch = params.width * sizeof(DWORD);
+			JOB_Start(ConvertPaletteRows, PaletteConvertJobs(params.height), &params);
+			rc = CaptureBufferSurface->LockRect(&desc, NULL, 0);
+			JOB_Wait();
+			if (FAILED(rc)) {
+				return;
+			}
+			for (DWORD i = 0; i < params.height; ++i) {
+				memcpy((BYTE*)desc.pBits + desc.Pitch * i, params.dst + params.dstPitch * i, params.dstPitch);
+			}
 		}
-		// copy bitmap to surface
-		BYTE* src = RenderBuffer.bitmap;
-		for (DWORD i = 0; i < RenderBuffer.height; ++i) {
-			DWORD* dst = (DWORD*)((BYTE*)desc.pBits + desc.Pitch * i);
-			for (DWORD j = 0; j < RenderBuffer.width; ++j) {
-				if (*src) {
-					BYTE r = WinVidPalette[*src].peRed;
-					BYTE g = WinVidPalette[*src].peGreen;
-					BYTE b = WinVidPalette[*src].peBlue;
-					*dst++ = RGB_MAKE(r, g, b);
-				}
-				else {
-					*dst++ = 0;
-				}
-				++src;
+		else {
+			// finish surface lock, and convert right in the surface rows
+			if (rc == D3DERR_WASSTILLDRAWING && FAILED(CaptureBufferSurface->LockRect(&desc, NULL, 0))) {
+				return;
 			}
+			params.dst = (BYTE*)desc.pBits;
+			params.dstPitch = desc.Pitch;
+			JOB_Run(ConvertPaletteRows, PaletteConvertJobs(params.height), &params);
 		}
 		// unlock surface
 		CaptureBufferSurface->UnlockRect();
@@ -368,10 +474,14 @@ void S_OutputPolyList() {
 	else {
 		// Hardware renderer
 		if (!SavedAppSettings.ZBuffer || !SavedAppSettings.DontSortPrimitives) {
+			PROF_BEGIN(PROF_Sort);
 			phd_SortPolyList();
+			PROF_END(PROF_Sort);
 		}
+		PROF_BEGIN(PROF_Raster);
 		HWR_DrawPolyList();
 		D3DDev->EndScene();
+		PROF_END(PROF_Raster);
 	}
 }
 
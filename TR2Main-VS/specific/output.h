@@ -39,6 +39,7 @@ DWORD S_DumpScreen(); // 0x00450CB0
 void S_ClearScreen(); // 0x00450CF0
 void S_InitialiseScreen(GF_LEVEL_TYPE levelType); // 0x00450D00
 void S_OutputPolyList(); // 0x00450D40
+void FreePaletteStaging();
 int S_GetObjectBounds(short* bPtr); // 0x00450D80
 void S_InsertBackPolygon(int x0, int y0, int x1, int y1); // 0x00450FF0
 void S_PrintShadow(short radius, short* bPtr, ITEM_INFO* item); // 0x00451040
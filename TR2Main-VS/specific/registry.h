@@ -67,6 +67,10 @@
 #define REG_SCREENSHOT_FORMAT	"ScreenshotFormat"
 #define REG_JOYSTICK_BTN_STYLE	"JoystickButtonStyle"
 #define REG_PAUSEBGND_MODE		"PauseBackgroundMode"
+#define REG_POLYSORT_MODE		"PolySortMode"
+#define REG_PROFILER_MODE		"ProfilerMode"
+#define REG_SOFTWARE_MIXER		"SoftwareMixer"
+#define REG_RENDER_FRAME_LIMIT	"RenderFrameLimit"
 
 // BOOL value names
 #define REG_PERSPECTIVE			"PerspectiveCorrect"
@@ -93,6 +97,7 @@
 #define REG_AVOID_INTERLACED	"AvoidInterlacedVideoModes"
 #define REG_RUNNING_M16_FIX		"RunningM16fix"
 #define REG_LOWCEILING_JUMP_FIX	"LowCeilingJumpFix"
+#define REG_RENDER_INTERPOLATION	"RenderInterpolation"
 
 // FLOAT value names
 #define REG_GAME_SIZER		"Sizer"
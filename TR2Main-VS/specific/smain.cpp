@@ -50,6 +50,22 @@
 #include "modding/mod_utils.h"
 #endif
 
+#ifdef FEATURE_BENCHMARK
+#include "modding/benchmark.h"
+#endif // FEATURE_BENCHMARK
+
+#ifdef FEATURE_PROFILER
+#include "modding/profiler.h"
+#endif // FEATURE_PROFILER
+
+#ifdef FEATURE_RENDER_INTERPOLATION
+#include "game/interp.h"
+#endif // FEATURE_RENDER_INTERPOLATION
+
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+#include "specific/init_sound_xaudio.h"
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+
 #ifdef FEATURE_HUD_IMPROVED
 extern DWORD DemoTextMode;
 extern DWORD JoystickButtonStyle;
@@ -103,6 +119,7 @@ extern double UnderwaterMusicMute;
 
 #ifdef FEATURE_VIEW_IMPROVED
 extern bool PsxFovEnabled;
+extern DWORD PolySortMode;
 extern double ViewDistanceFactor;
 extern double FogBeginFactor;
 extern double FogEndFactor;
@@ -168,6 +185,14 @@ BOOL GameMain() {
 		return FALSE;
 	}
 
+#ifdef FEATURE_BENCHMARK
+	if (BENCH_IsRequested()) {
+		BENCH_RunDemo(-1, 0);
+		ShutdownGame();
+		return TRUE;
+	}
+#endif // FEATURE_BENCHMARK
+
 	HiRes = 0;
 	TempVideoAdjust(1, 1.0);
 	S_UpdateInput();
@@ -551,6 +576,7 @@ void S_SaveSettings() {
 	SetRegistryFloatValue(REG_FOG_END, FogEndFactor);
 	SetRegistryFloatValue(REG_UW_FOG_BEGIN, WaterFogBeginFactor);
 	SetRegistryFloatValue(REG_UW_FOG_END, WaterFogEndFactor);
+	SetRegistryDwordValue(REG_POLYSORT_MODE, PolySortMode);
 	CloseGameRegistryKey();
 #endif // FEATURE_VIEW_IMPROVED
 }
@@ -656,6 +682,22 @@ void S_LoadSettings() {
 	GetRegistryBoolValue(REG_BAREFOOT_SFX_ENABLE, &BarefootSfxEnabled, true);
 #endif // FEATURE_MOD_CONFIG
 
+#ifdef FEATURE_PROFILER
+	GetRegistryDwordValue(REG_PROFILER_MODE, &ProfilerMode, 0);
+	CLAMPG(ProfilerMode, 2);
+#endif // FEATURE_PROFILER
+
+#ifdef FEATURE_RENDER_INTERPOLATION
+	GetRegistryBoolValue(REG_RENDER_INTERPOLATION, &RenderInterpolation, false);
+	GetRegistryDwordValue(REG_RENDER_FRAME_LIMIT, &RenderFrameLimit, 0);
+#endif // FEATURE_RENDER_INTERPOLATION
+
+#if defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+	GetRegistryDwordValue(REG_SOFTWARE_MIXER, &MixerMode, 0);
+	CLAMPG(MixerMode, 2);
+	S_SoundSetMixerMode(MixerMode);
+#endif // defined(FEATURE_SOFTWARE_MIXER) && defined(FEATURE_VOICE_MANAGER)
+
 #ifdef FEATURE_GOLD
 	if (IsGold()) {
 		// This RJF check is presented in "The Golden Mask" only
@@ -700,6 +742,7 @@ void S_LoadSettings() {
 	GetRegistryFloatValue(REG_FOG_END, &FogEndFactor, 6.0);
 	GetRegistryFloatValue(REG_UW_FOG_BEGIN, &WaterFogBeginFactor, 0.6);
 	GetRegistryFloatValue(REG_UW_FOG_END, &WaterFogEndFactor, 1.0);
+	GetRegistryDwordValue(REG_POLYSORT_MODE, &PolySortMode, POLYSORT_Radix);
 	CloseGameRegistryKey();
 
 	CLAMP(ViewDistanceFactor, 1.0, 6.0);
@@ -707,6 +750,7 @@ void S_LoadSettings() {
 	CLAMP(FogBeginFactor, 0.0, FogEndFactor);
 	CLAMP(WaterFogEndFactor, 0.0, FogEndFactor);
 	CLAMP(WaterFogBeginFactor, 0.0, FogBeginFactor);
+	CLAMPG(PolySortMode, POLYSORT_Radix);
 
 	setup_screen_size();
 #endif // FEATURE_VIEW_IMPROVED
@@ -23,10 +23,70 @@
 #include "specific/utils.h"
 #include "global/vars.h"
 
+#ifdef FEATURE_FRAME_PACER
+#include "modding/frame_pacer.h"
+#include <math.h>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION (0x00000002)
+#endif // CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#endif // FEATURE_FRAME_PACER
+
 static LONGLONG TIME_Ticks, TIME_Start_us;
 static double TIME_Frequency, TIME_Period_us;
 
+#ifdef FEATURE_FRAME_PACER
+static HANDLE TIME_Timer = NULL;
+static bool TIME_IsPeriodSet = false;
+static LONGLONG TIME_CounterFrequency = 0;
+
+static LONGLONG TIME_GetCounter(LPVOID param) {
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+static void TIME_Sleep(LPVOID param, LONGLONG ticks) {
+	if (TIME_Timer != NULL) {
+		LARGE_INTEGER dueTime;
+		// negative due time is relative, in 100 nanosecond intervals
+		dueTime.QuadPart = -(ticks * 10000000 / TIME_CounterFrequency);
+		if (dueTime.QuadPart < 0 && SetWaitableTimer(TIME_Timer, &dueTime, 0, NULL, NULL, FALSE)) {
+			WaitForSingleObject(TIME_Timer, INFINITE);
+		}
+	}
+	else {
+		DWORD ms = (DWORD)(ticks * 1000 / TIME_CounterFrequency);
+		if (ms > 0) {
+			Sleep(ms);
+		}
+	}
+}
+
+static void TIME_InitPacer(LONGLONG frequency) {
+	PACER_CLOCK clock = { TIME_GetCounter, TIME_Sleep, frequency, NULL };
+
+	TIME_CounterFrequency = frequency;
+	if (TIME_Timer == NULL) {
+		// the high resolution timer is available since Windows 10 1803
+		TIME_Timer = CreateWaitableTimerEx(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (TIME_Timer == NULL) {
+			TIME_IsPeriodSet = (timeBeginPeriod(1) == TIMERR_NOERROR);
+			TIME_Timer = CreateWaitableTimer(NULL, TRUE, NULL);
+		}
+	}
+	PACER_Init(&clock);
+}
+#endif // FEATURE_FRAME_PACER
+
 DWORD SyncTicks(DWORD skip) {
+#ifdef FEATURE_FRAME_PACER
+	// NOTE: the original busy wait is replaced by the sleeping pacer
+	LONGLONG lastTicks = TIME_Ticks;
+	TIME_Ticks = PACER_WaitUntil(lastTicks + (LONGLONG)ceil(TIME_Frequency * (double)skip));
+	return (DWORD)((double)(TIME_Ticks - lastTicks) / TIME_Frequency);
+#else // FEATURE_FRAME_PACER
 	double target = (double)skip;
 	double elapsed = 0.0;
 	LONGLONG lastTicks = TIME_Ticks;
@@ -35,7 +95,22 @@ DWORD SyncTicks(DWORD skip) {
 		elapsed = (double)(TIME_Ticks - lastTicks) / TIME_Frequency;
 	} while (elapsed < target);
 	return (DWORD)elapsed;
+#endif // FEATURE_FRAME_PACER
+}
+
+double PeekTicks() {
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+	return (double)(counter.QuadPart - TIME_Ticks) / TIME_Frequency;
+}
+
+#ifdef FEATURE_FRAME_PACER
+double SyncFrameTicks(double ticks) {
+	LONGLONG counter = PACER_WaitUntil(TIME_Ticks + (LONGLONG)ceil(TIME_Frequency * ticks));
+	return (double)(counter - TIME_Ticks) / TIME_Frequency;
 }
+#endif // FEATURE_FRAME_PACER
 
 // NOTE: redesigned to make it more accurate
 void UpdateTicks() {
@@ -52,10 +127,26 @@ bool TIME_Init() {
 		return false;
 
 	TIME_Frequency = (double)frequency.QuadPart / (double)TICKS_PER_SECOND;
+#ifdef FEATURE_FRAME_PACER
+	TIME_InitPacer(frequency.QuadPart);
+#endif // FEATURE_FRAME_PACER
 	UpdateTicks();
 	return true;
 }
 
+#ifdef FEATURE_FRAME_PACER
+void TIME_Cleanup() {
+	if (TIME_Timer != NULL) {
+		CloseHandle(TIME_Timer);
+		TIME_Timer = NULL;
+	}
+	if (TIME_IsPeriodSet) {
+		timeEndPeriod(1);
+		TIME_IsPeriodSet = false;
+	}
+}
+#endif // FEATURE_FRAME_PACER
+
 // NOTE: redesigned to make it more accurate
 DWORD Sync() {
 	LONGLONG lastTicks = TIME_Ticks;
@@ -28,8 +28,15 @@
   * Function list
   */
 DWORD SyncTicks(DWORD skip); // NOTE: this function is not presented in the original game
+double PeekTicks(); // NOTE: this function is not presented in the original game
+#ifdef FEATURE_FRAME_PACER
+double SyncFrameTicks(double ticks); // NOTE: this function is not presented in the original game
+#endif // FEATURE_FRAME_PACER
 void UpdateTicks(); // 0x00456680
 bool TIME_Init(); // 0x004566C0
+#ifdef FEATURE_FRAME_PACER
+void TIME_Cleanup(); // NOTE: this function is not presented in the original game
+#endif // FEATURE_FRAME_PACER
 DWORD Sync(); // 0x00456720
 LPVOID UT_LoadResource(LPCTSTR lpName, LPCTSTR lpType); // 0x00456780
 void UT_InitAccurateTimer(); // 0x004567C0
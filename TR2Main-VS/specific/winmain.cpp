@@ -22,6 +22,7 @@
 #include "precompiled.h"
 #include "specific/winmain.h"
 #include "specific/background.h"
+#include "specific/file.h"
 #include "specific/fmv.h"
 #include "specific/hwr.h"
 #include "specific/init.h"
@@ -44,6 +45,7 @@
 #endif // defined(FEATURE_SCREENSHOT_IMPROVED) || defined(FEATURE_BACKGROUND_IMPROVED)
 
 #ifdef FEATURE_NOLEGACY_OPTIONS
+#include "modding/thread_utils.h"
 extern bool AvoidInterlacedVideoModes;
 #endif // FEATURE_NOLEGACY_OPTIONS
 
@@ -143,6 +145,9 @@ int Init(bool skipCDInit) {
 		return 2;
 
 	UT_InitAccurateTimer();
+#ifdef FEATURE_NOLEGACY_OPTIONS
+	JOB_Init(); // Worker threads are not critical, the jobs are done in the main thread without them
+#endif // FEATURE_NOLEGACY_OPTIONS
 
 #ifdef FEATURE_NOLEGACY_OPTIONS
 	if (OpenGameRegistryKey(REG_SYSTEM_KEY)) {
@@ -172,6 +177,12 @@ int Init(bool skipCDInit) {
 }
 
 void WinCleanup() {
+#ifdef FEATURE_NOLEGACY_OPTIONS
+	JOB_Cleanup();
+#endif // FEATURE_NOLEGACY_OPTIONS
+#ifdef FEATURE_FRAME_PACER
+	TIME_Cleanup();
+#endif // FEATURE_FRAME_PACER
 	WinVidFreeWindow();
 	CD_Cleanup();
 	FMV_Cleanup();
@@ -196,6 +207,9 @@ int WinGameStart() {
 void WinGameFinish() {
 	WinInFinish();
 	WinSndFinish();
+#ifdef FEATURE_SAMPLE_BANK
+	S_ReleaseSampleBanks();
+#endif // FEATURE_SAMPLE_BANK
 	RenderFinish(true);
 	WinVidFinish();
 	WinVidHideGameWindow();
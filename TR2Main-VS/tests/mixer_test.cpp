@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/mixer.h"
+#include <math.h>
+
+// The mixer renders into the wave files of the build folder, and the test
+// reads them back. The source is a sine wave at the sample bank rate, so the
+// output level, the pan and the pitch are known.
+#define TEST_RATE (22050)
+#define TEST_TONE (441)
+#define TEST_AMPLITUDE (16000)
+#define TEST_QUEUE_SIZE (1024) // MIXER_QUEUE_SIZE
+
+#define CHECK(cond) { \
+	if (!(cond)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++Failures; \
+	} \
+}
+
+typedef struct {
+	DWORD riff;
+	DWORD riffSize;
+	DWORD wave;
+	DWORD fmt;
+	DWORD fmtSize;
+	WORD format;
+	WORD channels;
+	DWORD rate;
+	DWORD byteRate;
+	WORD blockAlign;
+	WORD bits;
+	DWORD data;
+	DWORD dataSize;
+} WAVE_HEADER;
+
+static int Failures = 0;
+static short Tone[MIXER_SOURCE_RATE];
+static short Output[TEST_RATE * 2 * 2];
+
+static void MakeTone() {
+	for (int i = 0; i < MIXER_SOURCE_RATE; ++i) {
+		Tone[i] = (short)(sin(2.0 * M_PI * TEST_TONE * i / MIXER_SOURCE_RATE) * TEST_AMPLITUDE);
+	}
+}
+
+static short* ReadWave(const char* path, DWORD* frames) {
+	WAVE_HEADER header;
+	short* samples = NULL;
+	FILE* file = fopen(path, "rb");
+	*frames = 0;
+	if (file == NULL) return NULL;
+	if (fread(&header, sizeof(header), 1, file) == 1
+		&& header.riff == 0x46464952 && header.wave == 0x45564157 && header.fmt == 0x20746D66
+		&& header.data == 0x61746164 && header.riffSize == 36 + header.dataSize
+		&& header.format == 1 && header.channels == 2 && header.bits == 16
+		&& header.rate == TEST_RATE && header.byteRate == TEST_RATE * 4 && header.blockAlign == 4)
+	{
+		samples = (short*)malloc(header.dataSize);
+		if (samples != NULL && fread(samples, header.dataSize, 1, file) == 1) {
+			*frames = header.dataSize / 4;
+		}
+	}
+	fclose(file);
+	return samples;
+}
+
+static int GetPeak(const short* samples, DWORD start, DWORD end, int channel) {
+	int peak = 0;
+	for (DWORD i = start; i < end; ++i) {
+		CLAMPL(peak, ABS(samples[i * 2 + channel]));
+	}
+	return peak;
+}
+
+static int GetCrossings(const short* samples, DWORD start, DWORD end) {
+	int crossings = 0;
+	for (DWORD i = start + 1; i < end; ++i) {
+		if ((samples[i * 2 - 2] < 0) != (samples[i * 2] < 0)) ++crossings;
+	}
+	return crossings;
+}
+
+// One second of the tone at the normal pitch lasts one second of the output,
+// then the voice ends and the output is silent.
+static void TestWave(bool cubic, const char* path) {
+	DWORD frames = 0;
+	MIXER_STATS stats;
+
+	MIXER_Init(TEST_RATE, cubic);
+	CHECK(MIXER_Start(0, Tone, MIXER_SOURCE_RATE, 0x10000, 1.0F, 0.5F, false));
+	CHECK(MIXER_WriteWave(path, TEST_RATE * 5 / 4));
+	CHECK(!MIXER_IsPlaying(0));
+	MIXER_GetStats(&stats);
+	CHECK(stats.rendered == TEST_RATE * 5 / 4);
+	CHECK(stats.commands == 1);
+	CHECK(stats.peakVoices == 1);
+
+	short* samples = ReadWave(path, &frames);
+	CHECK(samples != NULL && frames == TEST_RATE * 5 / 4);
+	if (samples == NULL || frames != TEST_RATE * 5 / 4) {
+		free(samples);
+		return;
+	}
+	int left = GetPeak(samples, 0, TEST_RATE, 0);
+	int right = GetPeak(samples, 0, TEST_RATE, 1);
+	int crossings = GetCrossings(samples, 0, TEST_RATE);
+	printf("  %s: left peak %d, right peak %d, crossings %d\n", path, left, right, crossings);
+	CHECK(left > TEST_AMPLITUDE * 98 / 100 && left <= TEST_AMPLITUDE + 1);
+	CHECK(ABS(right - left / 2) <= 1);
+	// two zero crossings per period
+	CHECK(ABS(crossings - TEST_TONE * 2) <= 2);
+	CHECK(GetPeak(samples, TEST_RATE - TEST_RATE / 10, TEST_RATE - 4, 0) > TEST_AMPLITUDE * 9 / 10);
+	CHECK(GetPeak(samples, TEST_RATE + 4, frames, 0) == 0);
+	CHECK(GetPeak(samples, TEST_RATE + 4, frames, 1) == 0);
+	free(samples);
+}
+
+static void TestLoopAndStop() {
+	MIXER_Init(TEST_RATE, false);
+	CHECK(MIXER_Start(3, Tone, MIXER_SOURCE_RATE, 0x10000, 0.5F, 0.5F, true));
+	MIXER_Render(Output, TEST_RATE * 2);
+	MIXER_Render(Output, TEST_RATE);
+	CHECK(MIXER_IsPlaying(3));
+	CHECK(GetPeak(Output, 0, TEST_RATE, 0) > TEST_AMPLITUDE / 2 - 100);
+
+	CHECK(MIXER_Stop(3));
+	CHECK(!MIXER_IsPlaying(3));
+	MIXER_Render(Output, TEST_RATE);
+	CHECK(GetPeak(Output, 0, TEST_RATE, 0) == 0);
+
+	// the update after the end doesn't start the voice again
+	CHECK(MIXER_Update(3, 0x10000, 1.0F, 1.0F));
+	MIXER_Render(Output, TEST_RATE);
+	CHECK(GetPeak(Output, 0, TEST_RATE, 0) == 0);
+}
+
+static void TestReverb() {
+	MIXER_Init(TEST_RATE, false);
+	CHECK(MIXER_SetReverb(2.0F, 0.5F));
+	CHECK(MIXER_Start(0, Tone, MIXER_SOURCE_RATE / 10, 0x10000, 1.0F, 1.0F, false));
+	MIXER_Render(Output, TEST_RATE);
+	// the voice is over after 0.1 seconds, the rest is the reverb tail
+	CHECK(!MIXER_IsPlaying(0));
+	CHECK(GetPeak(Output, TEST_RATE / 2, TEST_RATE, 0) > 0);
+	CHECK(GetPeak(Output, TEST_RATE / 2, TEST_RATE, 1) > 0);
+
+	CHECK(MIXER_SetReverb(0.0F, 0.0F));
+	MIXER_Render(Output, TEST_RATE);
+	CHECK(GetPeak(Output, 0, TEST_RATE, 0) == 0);
+}
+
+static void TestVoices() {
+	MIXER_STATS stats;
+
+	MIXER_Init(TEST_RATE, true);
+	for (int i = 0; i < MIXER_MAX_VOICES; ++i) {
+		CHECK(MIXER_Start(i, Tone, MIXER_SOURCE_RATE, 0x8000 + i * 0x100, 0.01F, 0.01F, true));
+	}
+	MIXER_Render(Output, TEST_RATE);
+	MIXER_GetStats(&stats);
+	CHECK(stats.voices == MIXER_MAX_VOICES);
+	CHECK(stats.peakVoices == MIXER_MAX_VOICES);
+
+	CHECK(MIXER_StopAll());
+	MIXER_Render(Output, TEST_RATE / 10);
+	MIXER_GetStats(&stats);
+	CHECK(stats.voices == 0);
+	CHECK(GetPeak(Output, 0, TEST_RATE / 10, 0) == 0);
+}
+
+// Nothing renders, so the queue fills up and the commands are dropped
+static void TestQueue() {
+	MIXER_STATS stats;
+
+	MIXER_Init(TEST_RATE, false);
+	CHECK(MIXER_Start(0, Tone, MIXER_SOURCE_RATE, 0x10000, 1.0F, 1.0F, true));
+	for (int i = 1; i < TEST_QUEUE_SIZE; ++i) {
+		CHECK(MIXER_Update(0, 0x10000, 1.0F, 1.0F));
+	}
+	CHECK(!MIXER_IsIdle());
+	CHECK(!MIXER_Update(0, 0x10000, 1.0F, 1.0F));
+	MIXER_GetStats(&stats);
+	CHECK(stats.dropped == 1);
+
+	// the dropped stop commands don't mark the voice stopped
+	CHECK(!MIXER_Stop(0));
+	CHECK(!MIXER_StopAll());
+	CHECK(MIXER_IsPlaying(0));
+
+	MIXER_Render(Output, MIXER_SOURCE_RATE);
+	CHECK(MIXER_IsIdle());
+	CHECK(MIXER_IsPlaying(0));
+	MIXER_GetStats(&stats);
+	CHECK(stats.commands == TEST_QUEUE_SIZE);
+	CHECK(stats.dropped == 3);
+
+	CHECK(MIXER_Stop(0));
+	CHECK(!MIXER_IsPlaying(0));
+	MIXER_Render(Output, MIXER_SOURCE_RATE);
+	CHECK(GetPeak(Output, 0, MIXER_SOURCE_RATE, 0) == 0);
+}
+
+int main() {
+	printf("mixer\n");
+	MakeTone();
+	TestWave(false, "build/mixer_linear.wav");
+	TestWave(true, "build/mixer_cubic.wav");
+	TestLoopAndStop();
+	TestReverb();
+	TestVoices();
+	TestQueue();
+	printf("%s\n", Failures ? "FAILED" : "passed");
+	return Failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "modding/frame_pacer.h"
+
+// The pacer runs on a fake clock, so the test takes no real time and its
+// result doesn't depend on the system load. The clock sleeps with the
+// granularity of the system timer (1 ms after timeBeginPeriod, or the legacy
+// 64 Hz), and each read costs a bit of time like a real spin. Every frame does
+// some work before it waits, and every 16th frame overruns the interval. The
+// pacer must never return before the deadline, and once the spin margin has
+// adapted to the clock, it must not be late by more than FAKE_LATE.
+#define FAKE_FREQUENCY (1000000)
+#define FAKE_FRAMES (2000)
+#define FAKE_WARMUP (32)
+#define FAKE_INTERVAL (FAKE_FREQUENCY / 60)
+#define FAKE_LATE (FAKE_FREQUENCY / 10000)
+#define FAKE_READ_COST (2)
+
+#define CHECK(cond) { \
+	if (!(cond)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++Failures; \
+	} \
+}
+
+typedef struct {
+	LONGLONG now;
+	LONGLONG granularity;
+	LONGLONG readCost;
+	int sleeps;
+} FAKE_CLOCK;
+
+static int Failures = 0;
+
+static LONGLONG FakeGetTime(LPVOID param) {
+	FAKE_CLOCK* fake = (FAKE_CLOCK*)param;
+	fake->now += fake->readCost;
+	return fake->now;
+}
+
+static void FakeSleep(LPVOID param, LONGLONG ticks) {
+	FAKE_CLOCK* fake = (FAKE_CLOCK*)param;
+	fake->now += (ticks + fake->granularity - 1) / fake->granularity * fake->granularity;
+	++fake->sleeps;
+}
+
+static void TestTimerGranularity(LONGLONG granularity, int minSleeps) {
+	FAKE_CLOCK fake = { 1, granularity, FAKE_READ_COST, 0 };
+	PACER_CLOCK clock = { FakeGetTime, FakeSleep, FAKE_FREQUENCY, &fake };
+	PACER_STATS stats;
+	DWORD seed = 1;
+	int early = 0;
+	int late = 0;
+
+	PACER_Init(&clock);
+	// like SyncTicks, the next deadline is counted from the time the wait returned
+	LONGLONG last = PACER_GetTime();
+	for (int i = 0; i < FAKE_FRAMES; ++i) {
+		if (i == FAKE_WARMUP) {
+			PACER_ResetStats();
+		}
+		seed = seed * 1103515245 + 12345;
+		LONGLONG work = (seed >> 16) % (FAKE_INTERVAL * 3 / 4);
+		if ((i & 15) == 15) work += FAKE_INTERVAL;
+		fake.now += work;
+		LONGLONG ready = fake.now;
+		LONGLONG deadline = last + FAKE_INTERVAL;
+		last = PACER_WaitUntil(deadline);
+		// the frames that overran the deadline by their work are not checked
+		if (ready < deadline) {
+			if (last < deadline) {
+				++early;
+			}
+			else if (i >= FAKE_WARMUP && last - deadline > FAKE_LATE) {
+				++late;
+			}
+		}
+	}
+	PACER_GetStats(&stats);
+	printf("  granularity %lld us: sleeps: %d, early: %d, late: %d, max late: %.3f ms\n",
+		(long long)granularity, fake.sleeps, early, late, stats.maxLateMs);
+	CHECK(early == 0);
+	CHECK(late == 0);
+	// the pacer must sleep, not spin through the whole interval
+	CHECK(fake.sleeps >= minSleeps);
+}
+
+// Without the sleep function the pacer spins, and it returns exactly at the
+// deadline, so the statistics are known. The overrun frames are not late.
+static void TestStats() {
+	FAKE_CLOCK fake = { 1, 1, 1, 0 };
+	PACER_CLOCK clock = { FakeGetTime, NULL, FAKE_FREQUENCY, &fake };
+	PACER_STATS stats;
+
+	PACER_Init(&clock);
+	LONGLONG last = PACER_GetTime();
+	for (int i = 0; i < 100; ++i) {
+		fake.now += (i == 50) ? FAKE_FREQUENCY / 100 : FAKE_FREQUENCY / 2000;
+		last = PACER_WaitUntil(last + FAKE_FREQUENCY / 1000);
+	}
+	PACER_GetStats(&stats);
+	CHECK(stats.frames == 99);
+	CHECK(stats.minMs == 1.0);
+	CHECK(stats.maxMs > 10.0 && stats.maxMs < 10.1);
+	CHECK(stats.jitterMs > 0.0);
+	CHECK(stats.maxLateMs == 0.0);
+	CHECK(fake.sleeps == 0);
+
+	PACER_ResetStats();
+	PACER_GetStats(&stats);
+	CHECK(stats.frames == 0);
+	CHECK(stats.avgMs == 0.0);
+}
+
+int main() {
+	printf("frame pacer\n");
+	TestTimerGranularity(FAKE_FREQUENCY / 1000, FAKE_FRAMES * 3 / 4);
+	// the legacy timer tick is almost as long as the frame, few frames may sleep
+	TestTimerGranularity(FAKE_FREQUENCY / 64, FAKE_FRAMES / 20);
+	TestStats();
+	printf("%s\n", Failures ? "FAILED" : "passed");
+	return Failures ? 1 : 0;
+}
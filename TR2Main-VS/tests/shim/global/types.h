@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This header stands for global/types.h in the tests. It has just the Windows
+// types, the game structures and the macros the tested modules use, with the
+// same meaning.
+
+#ifndef GLOBAL_TYPES_H_INCLUDED
+#define GLOBAL_TYPES_H_INCLUDED
+
+#include <stdint.h>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef int32_t BOOL;
+typedef int64_t LONGLONG;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+typedef void* LPVOID;
+typedef const char* LPCTSTR;
+
+#define TRUE (1)
+#define FALSE (0)
+
+// Math macros
+#define MIN(a,b)			      (((a)<(b))?(a):(b))
+#define MAX(a,b)			      (((a)>(b))?(a):(b))
+#define ABS(a)				      (((a)<0)?-(a):(a))
+#define CLAMPL(a,b)			      {if((a)<(b)) (a)=(b);}
+#define CLAMPG(a,b)			      {if((a)>(b)) (a)=(b);}
+#define CLAMP(a,b,c)		      {if((a)<(b)) (a)=(b); else if((a)>(c)) (a)=(c);}
+
+typedef struct PhdVector_t {
+	int x;
+	int y;
+	int z;
+} PHD_VECTOR;
+
+typedef struct SoundSlot_t {
+	PHD_VECTOR pos;
+	int volume;
+	int originalVolume;
+	int pan;
+	int sampleIdx;
+	int pitch;
+	int distance;
+} SOUND_SLOT;
+
+#endif // GLOBAL_TYPES_H_INCLUDED
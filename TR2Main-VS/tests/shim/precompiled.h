@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The tests build the platform independent modules without the Windows SDK
+// and without the game, so they run on any system. This header stands for
+// global/precompiled.h, it enables just the features under the test.
+
+#ifndef TR2MAIN_PRECOMPILED_HEADER
+#define TR2MAIN_PRECOMPILED_HEADER
+
+#define FEATURE_FRAME_PACER
+#define FEATURE_SOFTWARE_MIXER
+#define FEATURE_VOICE_MANAGER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// The tests define the log functions themselves
+extern void LogWarn(const char* message, ...);
+
+#endif // !TR2MAIN_PRECOMPILED_HEADER
@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2017-2024 Michael Chaban. All rights reserved.
+ * Original game is created by Core Design Ltd. in 1997.
+ * Lara Croft and Tomb Raider are trademarks of Embracer Group AB.
+ *
+ * This file is part of TR2Main.
+ *
+ * TR2Main is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * TR2Main is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with TR2Main.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "precompiled.h"
+#include "game/voice.h"
+
+// The voice manager runs on the null backend, or on its copy with a few
+// channels that counts the IsPlaying polls. The null one-shots end at once,
+// so a one-shot keeps its channel only until the end of the scene.
+#define TEST_VOICES (VOICE_MAX_CHANNELS * 2) // VOICE_MAX
+#define TEST_AUDIBLE (0x100) // VOICE_AUDIBLE_VOLUME
+#define TEST_CHANNELS (4)
+
+#define CHECK(cond) { \
+	if (!(cond)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		++Failures; \
+	} \
+}
+
+static int Failures = 0;
+static int Warnings = 0;
+static int IsPlayingCalls = 0;
+static VOICE_BACKEND CountBackend;
+
+void LogWarn(const char* message, ...) {
+	++Warnings;
+}
+
+static bool CountIsPlaying(int channel) {
+	++IsPlayingCalls;
+	return VoiceNullBackend.IsPlaying(channel);
+}
+
+static void SetCountBackend() {
+	CountBackend = VoiceNullBackend;
+	CountBackend.channelCount = TEST_CHANNELS;
+	CountBackend.IsPlaying = CountIsPlaying;
+	VOICE_SetBackend(&CountBackend);
+	IsPlayingCalls = 0;
+}
+
+static SOUND_SLOT MakeSlot(int lut, int volume) {
+	SOUND_SLOT slot;
+	memset(&slot, 0, sizeof(slot));
+	slot.sampleIdx = lut;
+	slot.volume = volume;
+	slot.originalVolume = volume;
+	slot.pitch = 100;
+	return slot;
+}
+
+static bool Play(int lut, int volume, bool looped) {
+	SOUND_SLOT slot = MakeSlot(lut, volume);
+	return VOICE_Play(&slot, lut, looped);
+}
+
+static int UpdateLoop(int lut, int volume) {
+	SOUND_SLOT slot = MakeSlot(lut, volume);
+	return VOICE_UpdateLoop(lut, &slot);
+}
+
+// The emitters don't move in the tests
+static void KeepPanVolume(SOUND_SLOT* slot) {
+}
+
+static void TestNullBackend() {
+	VOICE_SetBackend(&VoiceNullBackend);
+	CHECK(Warnings == 0);
+
+	// every channel plays a loop, and a louder loop takes the quietest one
+	for (int i = 0; i < VOICE_MAX_CHANNELS; ++i) {
+		CHECK(Play(i, 0x1000 + i, true));
+	}
+	CHECK(Play(VOICE_MAX_CHANNELS, 0x2000, true));
+	CHECK(Play(VOICE_MAX_CHANNELS + 1, 0x100, false) == false);
+	CHECK(VOICE_IsSamplePlaying(0));
+	VOICE_EndScene(KeepPanVolume);
+	const VOICE_STATS* stats = VOICE_GetStats();
+	CHECK(stats->realVoices == VOICE_MAX_CHANNELS);
+	CHECK(stats->virtualVoices == 1);
+	CHECK(stats->steals == 1);
+	CHECK(stats->virtualized == 1);
+	CHECK(stats->rejected == 1);
+
+	// the loops nobody played during the scene are stopped
+	VOICE_EndScene(KeepPanVolume);
+	CHECK(stats->realVoices == 0);
+	CHECK(stats->virtualVoices == 0);
+	CHECK(!VOICE_IsSamplePlaying(0));
+
+	// the null one-shots end at once
+	CHECK(Play(1, 0x1000, false));
+	CHECK(!VOICE_IsSamplePlaying(1));
+	CHECK(Play(1, 0x1000, false));
+	CHECK(Play(2, 0x1000, false));
+	VOICE_EndScene(KeepPanVolume);
+	CHECK(stats->realVoices == 0);
+
+	VOICE_StopAll();
+	CountBackend = VoiceNullBackend;
+	CountBackend.channelCount = VOICE_MAX_CHANNELS + 1;
+	VOICE_SetBackend(&CountBackend);
+	CHECK(Warnings == 1);
+	VOICE_SetBackend(NULL);
+	CHECK(!Play(1, 0x1000, false));
+}
+
+// The channels of the finished one-shots are freed by VOICE_EndScene only,
+// the channel allocation never polls the backend
+static void TestReap() {
+	SetCountBackend();
+	for (int i = 0; i < TEST_CHANNELS; ++i) {
+		CHECK(Play(i, 0x1000, false));
+	}
+	CHECK(Play(TEST_CHANNELS, 0x1000, false));
+	CHECK(!Play(TEST_CHANNELS + 1, 0x800, false));
+	CHECK(IsPlayingCalls == 0);
+
+	VOICE_EndScene(KeepPanVolume);
+	const VOICE_STATS* stats = VOICE_GetStats();
+	CHECK(IsPlayingCalls == TEST_CHANNELS);
+	CHECK(stats->steals == 1);
+	CHECK(stats->rejected == 1);
+	CHECK(stats->realVoices == 0);
+	CHECK(Play(TEST_CHANNELS + 1, 0x800, false));
+	VOICE_StopAll();
+}
+
+static void TestLoops() {
+	SetCountBackend();
+	for (int i = 0; i < TEST_CHANNELS; ++i) {
+		CHECK(Play(10 + i, 0x400 + i * 0x100, true));
+	}
+	// a quiet loop is virtual from the start, a louder one takes a channel
+	CHECK(Play(20, TEST_AUDIBLE - 1, true));
+	CHECK(Play(30, 0x1000, true));
+	CHECK(UpdateLoop(30, 0x800) == 0);
+	CHECK(UpdateLoop(40, 0x800) == -1);
+	VOICE_EndScene(KeepPanVolume);
+	const VOICE_STATS* stats = VOICE_GetStats();
+	CHECK(stats->realVoices == TEST_CHANNELS);
+	CHECK(stats->virtualVoices == 2);
+	CHECK(stats->steals == 1);
+	CHECK(stats->virtualized == 1);
+	CHECK(stats->restored == 0);
+	CHECK(VOICE_IsSamplePlaying(10));
+
+	// the loop 11 is over, so the virtual loop 10 gets its channel back
+	CHECK(UpdateLoop(10, 0x400) == 1);
+	CHECK(UpdateLoop(12, 0x600) == 1);
+	CHECK(UpdateLoop(13, 0x700) == 1);
+	CHECK(UpdateLoop(20, TEST_AUDIBLE - 1) == 1);
+	CHECK(UpdateLoop(30, 0x1000) == 1);
+	VOICE_EndScene(KeepPanVolume);
+	CHECK(stats->realVoices == TEST_CHANNELS);
+	CHECK(stats->virtualVoices == 1);
+	CHECK(stats->restored == 1);
+	CHECK(!VOICE_IsSamplePlaying(11));
+
+	// a loop that gets quiet gives its channel up
+	CHECK(UpdateLoop(10, TEST_AUDIBLE - 1) == 1);
+	CHECK(UpdateLoop(12, 0x600) == 1);
+	CHECK(UpdateLoop(13, 0x700) == 1);
+	CHECK(UpdateLoop(20, TEST_AUDIBLE - 1) == 1);
+	CHECK(UpdateLoop(30, 0x1000) == 1);
+	VOICE_EndScene(KeepPanVolume);
+	CHECK(stats->realVoices == TEST_CHANNELS - 1);
+	CHECK(stats->virtualVoices == 2);
+	CHECK(stats->virtualized == 1);
+
+	VOICE_StopSample(30);
+	CHECK(!VOICE_IsSamplePlaying(30));
+	VOICE_StopSamples(10, 21);
+	for (int lut = 10; lut < 21; ++lut) {
+		CHECK(!VOICE_IsSamplePlaying(lut));
+	}
+	VOICE_EndScene(KeepPanVolume);
+	CHECK(stats->realVoices == 0);
+	CHECK(stats->virtualVoices == 0);
+	VOICE_StopAll();
+}
+
+// The loops are kept as virtual voices until all the voices are used
+static void TestVoiceLimit() {
+	SetCountBackend();
+	for (int i = 0; i < TEST_VOICES; ++i) {
+		CHECK(Play(i, TEST_AUDIBLE - 1, true));
+	}
+	CHECK(!Play(TEST_VOICES, 0x1000, true));
+	CHECK(!Play(TEST_VOICES, 0x1000, false));
+	VOICE_EndScene(KeepPanVolume);
+	const VOICE_STATS* stats = VOICE_GetStats();
+	CHECK(stats->realVoices == 0);
+	CHECK(stats->virtualVoices == TEST_VOICES);
+	CHECK(stats->rejected == 2);
+
+	VOICE_StopAll();
+	CHECK(!VOICE_IsSamplePlaying(0));
+	CHECK(Play(TEST_VOICES, 0x1000, true));
+	CHECK(VOICE_IsSamplePlaying(TEST_VOICES));
+	VOICE_StopAll();
+}
+
+int main() {
+	printf("voice\n");
+	TestNullBackend();
+	TestReap();
+	TestLoops();
+	TestVoiceLimit();
+	printf("%s\n", Failures ? "FAILED" : "passed");
+	return Failures ? 1 : 0;
+}